@@ -0,0 +1,244 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+/*
+ * FileBenchmark - serves a big file the way the FileServer example does,
+ * with Response::AddFile() that sends the file with sendfile(), and for comparison
+ * as a response body read into memory, and measures the download throughput.
+*/
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include "common_webcpp.h"
+#include "HttpServer.h"
+#include "File.h"
+#include "FileSystem.h"
+#include "StringUtil.h"
+#include "example_common.h"
+#include "benchmark_common.h"
+
+#define DEFAULT_FILE_SIZE 256 // Mb
+#define DEFAULT_DOWNLOADS 5
+#define DEFAULT_BENCHMARK_PORT 8092
+#define BENCHMARK_FILE "/tmp/webcpp_file_benchmark.bin"
+
+
+static bool CreateFile(const std::string &path, size_t size)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+        return false;
+    }
+
+    std::vector<char> chunk(1_Mb);
+    for(size_t i = 0;i < chunk.size();i ++)
+    {
+        chunk[i] = static_cast<char>('a' + i % 26);
+    }
+    for(size_t written = 0;written < size;written += chunk.size())
+    {
+        file.write(chunk.data(), std::min(chunk.size(), size - written));
+    }
+
+    return static_cast<bool>(file);
+}
+
+// downloads the path several times over one connection, returns the throughput in Mb/s or (-1) on error
+static double Run(int port, const std::string &path, size_t expected, int downloads)
+{
+    int fd = ConnectClient(port);
+    if(fd == ERROR)
+    {
+        std::cout << "failed to connect: " << strerror(errno) << std::endl;
+        return (-1);
+    }
+
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    std::vector<char> buffer(256_Kb);
+    size_t total = 0;
+    bool failed = false;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0;i < downloads && failed == false;i ++)
+    {
+        if(send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size()))
+        {
+            failed = true;
+            break;
+        }
+
+        std::string header;
+        size_t body = 0;
+        size_t length = 0;
+        bool headerDone = false;
+        while(headerDone == false || body < length)
+        {
+            ssize_t read = recv(fd, buffer.data(), buffer.size(), 0);
+            if(read <= 0)
+            {
+                failed = true;
+                break;
+            }
+
+            if(headerDone)
+            {
+                body += static_cast<size_t>(read);
+                continue;
+            }
+
+            header.append(buffer.data(), static_cast<size_t>(read));
+            size_t end = header.find("\r\n\r\n");
+            if(end != std::string::npos)
+            {
+                size_t field = header.find("Content-Length:");
+                if(field == std::string::npos || field > end)
+                {
+                    failed = true;
+                    break;
+                }
+                length = std::strtoul(header.c_str() + field + 15, nullptr, 10);
+                body = header.size() - end - 4;
+                headerDone = true;
+            }
+        }
+
+        if(length != expected)
+        {
+            failed = true;
+        }
+        total += body;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    close(fd);
+
+    if(failed)
+    {
+        return (-1);
+    }
+
+    double seconds = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / 1000000.0;
+    return static_cast<double>(total) / 1_Mb / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-s: file size, Mb, default: " + std::to_string(DEFAULT_FILE_SIZE));
+        adds.push_back("-n: count of downloads, default: " + std::to_string(DEFAULT_DOWNLOADS));
+        adds.push_back("-p: port, default: " + std::to_string(DEFAULT_BENCHMARK_PORT));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    size_t fileSize = DEFAULT_FILE_SIZE;
+    int downloads = DEFAULT_DOWNLOADS;
+    int port = DEFAULT_BENCHMARK_PORT;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-s"), v) && v > 0)
+    {
+        fileSize = static_cast<size_t>(v);
+    }
+    if(StringUtil::String2int(cmdline.Get("-n"), v) && v > 0)
+    {
+        downloads = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-p"), v))
+    {
+        port = v;
+    }
+
+    fileSize *= 1_Mb;
+    if(CreateFile(BENCHMARK_FILE, fileSize) == false)
+    {
+        std::cout << "failed to create " << BENCHMARK_FILE << std::endl;
+        return 1;
+    }
+
+    WebCpp::HttpServer httpServer;
+    WebCpp::HttpConfig &config = WebCpp::HttpConfig::Instance();
+    config.SetHttpProtocol(WebCpp::Http::Protocol::HTTP);
+    config.SetHttpServerAddress("127.0.0.1");
+    config.SetHttpServerPort(port);
+
+    if(httpServer.Init() == false)
+    {
+        std::cout << "HTTP server Init() failed: " << httpServer.GetLastError() << std::endl;
+        return 1;
+    }
+
+    // the file is sent by the connection with sendfile()
+    httpServer.OnGet("/file", [](const WebCpp::Request &, WebCpp::Response &response) -> bool
+    {
+        response.AddFile(BENCHMARK_FILE);
+        return true;
+    });
+
+    // the file is read into the response body and sent from there
+    httpServer.OnGet("/body", [](const WebCpp::Request &, WebCpp::Response &response) -> bool
+    {
+        ByteArray data(WebCpp::FileSystem::GetFileSize(BENCHMARK_FILE));
+        WebCpp::File file(BENCHMARK_FILE, WebCpp::File::Mode::Read);
+        size_t pos = 0;
+        while(pos < data.size())
+        {
+            size_t bytes = file.Read(reinterpret_cast<char *>(data.data() + pos), data.size() - pos);
+            if(bytes == static_cast<size_t>(ERROR) || bytes == 0)
+            {
+                break;
+            }
+            pos += bytes;
+        }
+        response.Write(data);
+        return true;
+    });
+
+    if(httpServer.Run() == false)
+    {
+        std::cout << "HTTP server Run() failed: " << httpServer.GetLastError() << std::endl;
+        return 1;
+    }
+
+    std::stringstream stream;
+    stream << "|   response |   Mb/s |\n";
+    stream << "|  AddFile() |" << std::setw(7) << std::right << std::fixed << std::setprecision(0) << Run(port, "/file", fileSize, downloads) << " |\n";
+    stream << "|  Write()   |" << std::setw(7) << std::right << std::fixed << std::setprecision(0) << Run(port, "/body", fileSize, downloads) << " |\n";
+    std::cout << stream.str();
+
+    httpServer.Close();
+    std::remove(BENCHMARK_FILE);
+
+    return 0;
+}
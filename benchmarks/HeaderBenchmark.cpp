@@ -0,0 +1,311 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+/*
+ * HeaderBenchmark - parses the headers of requests sent by real browsers
+ * and curl, compares the header parser with the string based parsing it
+ * replaced, the SIMD block scanner with two memchr() calls per line and
+ * checks that the lowercase names of HTTP/2-style clients are classified
+ * the same way as the canonical ones.
+*/
+
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include "common_webcpp.h"
+#include "HttpHeader.h"
+#include "StringUtil.h"
+#include "example_common.h"
+
+#define DEFAULT_ITERATIONS 100000
+
+
+static std::vector<std::string> Corpus()
+{
+    std::vector<std::string> corpus;
+    // Chrome
+    corpus.push_back("Host: www.example.com\r\n"
+                     "Connection: keep-alive\r\n"
+                     "Cache-Control: max-age=0\r\n"
+                     "sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+                     "sec-ch-ua-mobile: ?0\r\n"
+                     "sec-ch-ua-platform: \"Linux\"\r\n"
+                     "Upgrade-Insecure-Requests: 1\r\n"
+                     "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+                     "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+                     "Sec-Fetch-Site: none\r\n"
+                     "Sec-Fetch-Mode: navigate\r\n"
+                     "Sec-Fetch-User: ?1\r\n"
+                     "Sec-Fetch-Dest: document\r\n"
+                     "Accept-Encoding: gzip, deflate, br\r\n"
+                     "Accept-Language: en-US,en;q=0.9\r\n"
+                     "Cookie: session=3f2a9c1b7e; theme=dark; _ga=GA1.2.1234567890.1697000000\r\n"
+                     "\r\n");
+    // Firefox
+    corpus.push_back("Host: www.example.com\r\n"
+                     "User-Agent: Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:118.0) Gecko/20100101 Firefox/118.0\r\n"
+                     "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+                     "Accept-Language: en-US,en;q=0.5\r\n"
+                     "Accept-Encoding: gzip, deflate, br\r\n"
+                     "Referer: https://www.example.com/index.html\r\n"
+                     "Connection: keep-alive\r\n"
+                     "Cookie: session=3f2a9c1b7e; theme=dark\r\n"
+                     "Upgrade-Insecure-Requests: 1\r\n"
+                     "Sec-Fetch-Dest: document\r\n"
+                     "Sec-Fetch-Mode: navigate\r\n"
+                     "Sec-Fetch-Site: same-origin\r\n"
+                     "If-Modified-Since: Tue, 10 Oct 2023 08:00:00 GMT\r\n"
+                     "If-None-Match: \"5f3c-60765a3e1c2c0\"\r\n"
+                     "\r\n");
+    // Safari
+    corpus.push_back("Host: www.example.com\r\n"
+                     "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                     "Sec-Fetch-Site: none\r\n"
+                     "Cookie: session=3f2a9c1b7e\r\n"
+                     "Sec-Fetch-Dest: document\r\n"
+                     "Accept-Language: en-GB,en;q=0.9\r\n"
+                     "Sec-Fetch-Mode: navigate\r\n"
+                     "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.0 Safari/605.1.15\r\n"
+                     "Accept-Encoding: gzip, deflate, br\r\n"
+                     "Connection: keep-alive\r\n"
+                     "\r\n");
+    // curl, a GET and an upload
+    corpus.push_back("Host: 127.0.0.1:8080\r\n"
+                     "User-Agent: curl/8.4.0\r\n"
+                     "Accept: */*\r\n"
+                     "\r\n");
+    corpus.push_back("Host: 127.0.0.1:8080\r\n"
+                     "User-Agent: curl/8.4.0\r\n"
+                     "Accept: */*\r\n"
+                     "Content-Length: 1048576\r\n"
+                     "Content-Type: multipart/form-data; boundary=------------------------d74496d66958873e\r\n"
+                     "Expect: 100-continue\r\n"
+                     "\r\n");
+    return corpus;
+}
+
+// the parsing as it was done with the separate strings for every name and value
+static size_t ParseStrings(const ByteArray &data)
+{
+    std::vector<WebCpp::HttpHeader::Header> headers;
+    auto lines = StringUtil::Split(data, { CRLF }, 0, data.size() - 1);
+    for(auto &line: lines)
+    {
+        auto delimiter = StringUtil::SearchPosition(data, { ':' }, line.start, line.end);
+        if(delimiter == SIZE_MAX)
+        {
+            continue;
+        }
+        std::string name(data.begin() + line.start, data.begin() + delimiter);
+        std::string value(data.begin() + delimiter + 1, data.begin() + line.end + 1);
+        StringUtil::Trim(name);
+        StringUtil::Trim(value);
+        bool found = false;
+        for(auto &header: headers)
+        {
+            if(header.name == name)
+            {
+                header.value = value;
+                found = true;
+            }
+        }
+        if(found == false)
+        {
+            WebCpp::HttpHeader::Header header;
+            header.type = WebCpp::HttpHeader::String2HeaderType(name);
+            header.name = name;
+            header.value = value;
+            headers.push_back(std::move(header));
+        }
+    }
+
+    return headers.size();
+}
+
+static size_t ParseHeader(const ByteArray &data)
+{
+    WebCpp::HttpHeader header(WebCpp::HttpHeader::HeaderRole::Request);
+    header.ParseHeader(data);
+    return static_cast<size_t>(header.GetCount());
+}
+
+static size_t ScanMemchr(const ByteArray &data)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    while(pos < data.size())
+    {
+        const uint8_t *lf = static_cast<const uint8_t *>(memchr(data.data() + pos, LF, data.size() - pos));
+        size_t end = (lf == nullptr) ? data.size() : static_cast<size_t>(lf - data.data());
+        if(memchr(data.data() + pos, ':', end - pos) != nullptr)
+        {
+            count ++;
+        }
+        pos = end + 1;
+    }
+
+    return count;
+}
+
+static size_t ScanBlocks(const ByteArray &data)
+{
+    size_t count = 0;
+    bool colon = false;
+    for(size_t block = 0;block < data.size();block += 64)
+    {
+        uint64_t lfMask;
+        uint64_t colonMask;
+        StringUtil::ScanBlock(data, block, data.size() - 1, lfMask, colonMask);
+        uint64_t mask = lfMask | colonMask;
+        while(mask != 0)
+        {
+            uint64_t bit = mask & (~mask + 1);
+            mask ^= bit;
+            if((colonMask & bit) != 0)
+            {
+                colon = true;
+            }
+            else
+            {
+                count += colon ? 1 : 0;
+                colon = false;
+            }
+        }
+    }
+
+    return count;
+}
+
+// returns the time of parsing the whole corpus once, in ns
+template<typename F>
+static double Measure(const std::vector<ByteArray> &corpus, int iterations, F f)
+{
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0;i < iterations;i ++)
+    {
+        for(auto &data: corpus)
+        {
+            total += f(data);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // the total is used so the compiler can't drop the calls
+    if(total == 0)
+    {
+        return (-1);
+    }
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / iterations;
+}
+
+// the lowercase names should be the same headers as the canonical ones
+static bool CheckLowercase(const std::vector<ByteArray> &corpus)
+{
+    for(auto &data: corpus)
+    {
+        WebCpp::HttpHeader canonical(WebCpp::HttpHeader::HeaderRole::Request);
+        canonical.ParseHeader(data);
+
+        std::string str(data.begin(), data.end());
+        StringUtil::ToLower(str);
+        WebCpp::HttpHeader lowercase(WebCpp::HttpHeader::HeaderRole::Request);
+        lowercase.ParseHeader(StringUtil::String2ByteArray(str));
+
+        auto headers1 = canonical.GetHeaders();
+        auto headers2 = lowercase.GetHeaders();
+        if(headers1.size() != headers2.size())
+        {
+            return false;
+        }
+        for(size_t i = 0;i < headers1.size();i ++)
+        {
+            if(headers1[i].type != headers2[i].type ||
+                    lowercase.GetHeader(headers1[i].name) != headers2[i].value)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-n: count of iterations over the corpus, default: " + std::to_string(DEFAULT_ITERATIONS));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int iterations = DEFAULT_ITERATIONS;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-n"), v) && v > 0)
+    {
+        iterations = v;
+    }
+
+    // the first lookup generates the classifier table
+    auto start = std::chrono::steady_clock::now();
+    WebCpp::HttpHeader::String2HeaderType("Host");
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "classifier table generated in " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " µs" << std::endl;
+
+    std::vector<ByteArray> corpus;
+    size_t bytes = 0;
+    for(auto &str: Corpus())
+    {
+        corpus.push_back(StringUtil::String2ByteArray(str));
+        bytes += str.size();
+    }
+
+    bool lowercaseOk = CheckLowercase(corpus);
+    std::cout << "lowercase names: " << (lowercaseOk ? "OK" : "FAILED") << std::endl;
+
+    double strings = Measure(corpus, iterations, ParseStrings);
+    double header = Measure(corpus, iterations, ParseHeader);
+    double memchrScan = Measure(corpus, iterations, ScanMemchr);
+    double lineScan = Measure(corpus, iterations, ScanBlocks);
+
+    std::stringstream stream;
+    stream << corpus.size() << " requests, " << bytes << " bytes of headers\n";
+    stream << "|                        step |    before, ns |     after, ns | speedup |\n";
+    stream << "| header parsing, the corpus  |" << std::setw(14) << std::right << std::fixed << std::setprecision(0) << strings << " |";
+    stream << std::setw(14) << std::right << header << " |";
+    stream << std::setw(8) << std::right << std::setprecision(2) << strings / header << " |\n";
+    stream << "| line scanning, the corpus   |" << std::setw(14) << std::right << std::setprecision(0) << memchrScan << " |";
+    stream << std::setw(14) << std::right << lineScan << " |";
+    stream << std::setw(8) << std::right << std::setprecision(2) << memchrScan / lineScan << " |\n";
+    std::cout << stream.str();
+
+    return lowercaseOk ? 0 : 1;
+}
@@ -0,0 +1,344 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+/*
+ * ParserBenchmark - feeds HTTP requests to the incremental request parser
+ * byte by byte, in random segments and as a whole, checks that all the ways
+ * give the same result, fuzzes the parser with corrupted input and measures
+ * how the cost of the byte-by-byte parsing grows with the header size.
+ * It also counts the heap allocations made while parsing the header lines.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include "common_webcpp.h"
+#include "Request.h"
+#include "HttpHeader.h"
+#include "HttpConfig.h"
+#include "StringUtil.h"
+#include "example_common.h"
+
+#define DEFAULT_ITERATIONS 1000
+#define DEFAULT_SEED 1
+#define HEADER_LINES 30
+
+static std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    allocations ++;
+    void *ptr = malloc(size > 0 ? size : 1);
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+struct ParseSummary
+{
+    WebCpp::Request::ParseResult result = WebCpp::Request::ParseResult::NeedMore;
+    size_t consumed = 0;
+    std::string method;
+    std::string path;
+    int headers = 0;
+    size_t values = 0;
+    std::string body;
+
+    bool operator ==(const ParseSummary &other) const
+    {
+        return result == other.result && consumed == other.consumed &&
+                method == other.method && path == other.path &&
+                headers == other.headers && values == other.values && body == other.body;
+    }
+};
+
+static std::vector<std::string> Corpus()
+{
+    std::vector<std::string> corpus;
+    corpus.push_back("GET / HTTP/1.1\r\n\r\n");
+    corpus.push_back("GET /index.html?a=1&b=2 HTTP/1.1\r\n"
+                     "Host: 127.0.0.1:8080\r\n"
+                     "User-Agent: curl/7.79.1\r\n"
+                     "Accept: */*\r\n"
+                     "Connection: keep-alive\r\n"
+                     "\r\n");
+    corpus.push_back("\r\nGET /lf HTTP/1.1\nHost: localhost\nAccept: */*\n\n");
+    corpus.push_back("POST /form HTTP/1.1\r\n"
+                     "Host: localhost\r\n"
+                     "Content-Type: application/x-www-form-urlencoded\r\n"
+                     "Content-Length: 23\r\n"
+                     "\r\n"
+                     "name=John&city=New+York");
+    corpus.push_back("POST /text HTTP/1.1\r\n"
+                     "Host: localhost\r\n"
+                     "Content-Type: text/plain\r\n"
+                     "Content-Length: 11\r\n"
+                     "\r\n"
+                     "hello world");
+    corpus.push_back("POST /upload HTTP/1.1\r\n"
+                     "Host: localhost\r\n"
+                     "Content-Type: multipart/form-data; boundary=XyZ\r\n"
+                     "Content-Length: 135\r\n"
+                     "\r\n"
+                     "--XyZ\r\n"
+                     "Content-Disposition: form-data; name=\"field\"\r\n"
+                     "\r\n"
+                     "value\r\n"
+                     "--XyZ\r\n"
+                     "Content-Disposition: form-data; name=\"other\"\r\n"
+                     "\r\n"
+                     "1234567\r\n"
+                     "--XyZ--\r\n");
+    corpus.push_back("BROKEN\r\n\r\n");
+    return corpus;
+}
+
+static ParseSummary Summary(WebCpp::Request &request, WebCpp::Request::ParseResult result, size_t consumed)
+{
+    ParseSummary summary;
+    summary.result = result;
+    if(result == WebCpp::Request::ParseResult::Complete)
+    {
+        summary.consumed = consumed;
+        summary.method = WebCpp::Http::Method2String(request.GetMethod());
+        summary.path = request.GetUrl().GetPath();
+        summary.headers = request.GetHeader().GetCount();
+        summary.values = request.GetRequestBody().GetValues().size();
+        for(auto &value: request.GetRequestBody().GetValues())
+        {
+            summary.body += value.name + "=" + value.GetDataString() + ";";
+        }
+    }
+
+    return summary;
+}
+
+// feeds the data in segments of the given sizes, the last size is repeated
+static ParseSummary Feed(const std::string &str, const std::vector<size_t> &segments)
+{
+    WebCpp::Request request;
+    WebCpp::Request::ParseResult result = WebCpp::Request::ParseResult::NeedMore;
+    ByteArray data;
+    size_t consumed = 0;
+    size_t pos = 0;
+    size_t index = 0;
+
+    while(pos < str.size() && result == WebCpp::Request::ParseResult::NeedMore)
+    {
+        size_t size = std::min(segments[std::min(index ++, segments.size() - 1)], str.size() - pos);
+        data.insert(data.end(), str.begin() + pos, str.begin() + pos + size);
+        pos += size;
+        result = request.Parse(data, consumed);
+    }
+
+    return Summary(request, result, consumed);
+}
+
+static bool CheckCorpus(std::mt19937 &random, int iterations)
+{
+    bool retval = true;
+    auto corpus = Corpus();
+
+    for(auto &str: corpus)
+    {
+        auto whole = Feed(str, { str.size() });
+        auto bytes = Feed(str, { 1 });
+        if(!(whole == bytes))
+        {
+            std::cout << "byte-by-byte mismatch: " << StringUtil::String2ByteArray(str).size() << " bytes, " << str.substr(0, str.find('\n')) << std::endl;
+            retval = false;
+        }
+
+        for(int i = 0;i < iterations;i ++)
+        {
+            std::vector<size_t> segments;
+            std::uniform_int_distribution<size_t> distribution(1, 16);
+            for(size_t size = 0;size < str.size();size += segments.back())
+            {
+                segments.push_back(distribution(random));
+            }
+            if(!(whole == Feed(str, segments)))
+            {
+                std::cout << "random segments mismatch: " << str.substr(0, str.find('\n')) << std::endl;
+                retval = false;
+                break;
+            }
+        }
+    }
+
+    return retval;
+}
+
+// corrupts the corpus and checks that the parser neither crashes nor consumes more than it was given
+static bool Fuzz(std::mt19937 &random, int iterations)
+{
+    auto corpus = Corpus();
+    std::uniform_int_distribution<int> byteDistribution(0, 255);
+
+    for(int i = 0;i < iterations;i ++)
+    {
+        std::string str = corpus[random() % corpus.size()];
+        int mutations = 1 + random() % 8;
+        for(int j = 0;j < mutations && !str.empty();j ++)
+        {
+            size_t pos = random() % str.size();
+            switch(random() % 3)
+            {
+                case 0: str[pos] = static_cast<char>(byteDistribution(random)); break;
+                case 1: str.erase(pos, 1); break;
+                case 2: str.insert(pos, 1, static_cast<char>(byteDistribution(random))); break;
+            }
+        }
+
+        auto summary = Feed(str, { 1 + random() % 8 });
+        if(summary.consumed > str.size())
+        {
+            std::cout << "fuzz: consumed " << summary.consumed << " of " << str.size() << " bytes" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// returns the time of the byte-by-byte parsing of a header with the given size, in µs, -1 if it isn't parsed
+static double MeasureHeader(size_t headerSize)
+{
+    std::string str = "GET / HTTP/1.1\r\n";
+    for(int i = 0;str.size() < headerSize;i ++)
+    {
+        str += "X-Header-" + std::to_string(i) + ": some value of the header\r\n";
+    }
+    str += "\r\n";
+
+    // the largest headers are over the default limit, it's the parsing that is measured
+    auto &config = WebCpp::HttpConfig::Instance();
+    size_t maxHeaderSize = config.GetMaxHeaderSize();
+    config.SetMaxHeaderSize(std::max(maxHeaderSize, str.size()));
+    auto start = std::chrono::steady_clock::now();
+    auto summary = Feed(str, { 1 });
+    auto end = std::chrono::steady_clock::now();
+    config.SetMaxHeaderSize(maxHeaderSize);
+
+    if(summary.result != WebCpp::Request::ParseResult::Complete)
+    {
+        return (-1);
+    }
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+// returns the count of the heap allocations made by parsing the header lines of a browser-like request
+static size_t CountHeaderAllocations()
+{
+    std::vector<std::string> names = { "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding",
+                                       "Connection", "Referer", "Cookie", "Upgrade-Insecure-Requests", "Sec-Fetch-Dest",
+                                       "Sec-Fetch-Mode", "Sec-Fetch-Site", "Sec-Fetch-User", "Cache-Control", "Pragma" };
+    std::string str;
+    std::vector<StringUtil::Range> lines;
+    for(int i = 0;i < HEADER_LINES;i ++)
+    {
+        std::string name = (static_cast<size_t>(i) < names.size()) ? names[i] : "X-Custom-Header-" + std::to_string(i);
+        size_t start = str.size();
+        str += name + ": value of the header number " + std::to_string(i);
+        lines.push_back(StringUtil::Range { start, str.size() - 1 });
+        str += "\r\n";
+    }
+    ByteArray data(str.begin(), str.end());
+    WebCpp::HttpHeader header(WebCpp::HttpHeader::HeaderRole::Request);
+
+    size_t before = allocations;
+    for(auto &line: lines)
+    {
+        header.ParseLine(data, line);
+    }
+
+    return allocations - before;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-n: count of random splits and fuzz iterations, default: " + std::to_string(DEFAULT_ITERATIONS));
+        adds.push_back("-s: random seed, default: " + std::to_string(DEFAULT_SEED));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int iterations = DEFAULT_ITERATIONS;
+    int seed = DEFAULT_SEED;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-n"), v))
+    {
+        iterations = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-s"), v))
+    {
+        seed = v;
+    }
+
+    std::mt19937 random(seed);
+    bool corpusOk = CheckCorpus(random, iterations);
+    std::cout << "segmented parsing: " << (corpusOk ? "OK" : "FAILED") << std::endl;
+    bool fuzzOk = Fuzz(random, iterations * 10);
+    std::cout << "fuzzing: " << (fuzzOk ? "OK" : "FAILED") << std::endl;
+
+    std::stringstream stream;
+    bool measureOk = true;
+    stream << "| header, bytes |  byte-by-byte, µs |     µs per KB |\n";
+    for(size_t size = 1024;size <= 65536;size *= 4)
+    {
+        double result = MeasureHeader(size);
+        stream << "|" << std::setw(14) << std::right << size << " |";
+        if(result < 0)
+        {
+            measureOk = false;
+            stream << std::setw(18) << std::right << "FAILED" << " |" << std::setw(14) << std::right << "-" << " |\n";
+            continue;
+        }
+        stream << std::setw(18) << std::right << std::fixed << std::setprecision(0) << result << " |";
+        stream << std::setw(14) << std::right << std::fixed << std::setprecision(2) << result * 1024 / size << " |\n";
+    }
+    std::cout << stream.str();
+    std::cout << "heap allocations parsing " << HEADER_LINES << " header lines: " << CountHeaderAllocations() << std::endl;
+
+    return (corpusOk && fuzzOk && measureOk) ? 0 : 1;
+}
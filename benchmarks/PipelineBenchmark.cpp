@@ -0,0 +1,228 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+/*
+ * PipelineBenchmark - runs an HTTP server with a single small route and
+ * measures the request rate of one keep-alive client that sends requests
+ * one by one and pipelined with a growing depth.
+*/
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include "common_webcpp.h"
+#include "HttpServer.h"
+#include "StringUtil.h"
+#include "example_common.h"
+#include "benchmark_common.h"
+
+#define DEFAULT_REQUESTS 20000
+#define DEFAULT_DEPTH 16
+#define DEFAULT_BENCHMARK_PORT 8091
+
+
+// removes the complete responses from the buffer and returns their count
+static int TakeResponses(std::string &buffer)
+{
+    int count = 0;
+    size_t pos = 0;
+    while(true)
+    {
+        size_t headerEnd = buffer.find("\r\n\r\n", pos);
+        if(headerEnd == std::string::npos)
+        {
+            break;
+        }
+
+        size_t length = 0;
+        size_t field = buffer.find("Content-Length:", pos);
+        if(field != std::string::npos && field < headerEnd)
+        {
+            length = std::strtoul(buffer.c_str() + field + 15, nullptr, 10);
+        }
+
+        size_t end = headerEnd + 4 + length;
+        if(end > buffer.size())
+        {
+            break;
+        }
+        pos = end;
+        count ++;
+    }
+    buffer.erase(0, pos);
+
+    return count;
+}
+
+// returns the count of requests per second or (-1) on error
+static double Run(int port, int requests, int depth)
+{
+    int fd = ConnectClient(port);
+    if(fd == ERROR)
+    {
+        std::cout << "failed to connect: " << strerror(errno) << std::endl;
+        return (-1);
+    }
+
+    const std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: PipelineBenchmark\r\n\r\n";
+    std::string batch;
+    for(int i = 0;i < depth;i ++)
+    {
+        batch += request;
+    }
+
+    std::string buffer;
+    char chunk[16384];
+    double retval = (-1);
+    int done = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while(done < requests)
+    {
+        int count = std::min(depth, requests - done);
+        size_t size = request.size() * static_cast<size_t>(count);
+        if(send(fd, batch.data(), size, 0) != static_cast<ssize_t>(size))
+        {
+            break;
+        }
+
+        int received = 0;
+        while(received < count)
+        {
+            ssize_t read = recv(fd, chunk, sizeof(chunk), 0);
+            if(read <= 0)
+            {
+                break;
+            }
+            buffer.append(chunk, static_cast<size_t>(read));
+            received += TakeResponses(buffer);
+        }
+        if(received < count)
+        {
+            std::cout << "the connection was closed after " << (done + received) << " responses" << std::endl;
+            break;
+        }
+        done += count;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if(done == requests)
+    {
+        double seconds = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / 1000000.0;
+        retval = requests / seconds;
+    }
+
+    close(fd);
+
+    return retval;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-n: count of requests, default: " + std::to_string(DEFAULT_REQUESTS));
+        adds.push_back("-d: max pipelining depth, default: " + std::to_string(DEFAULT_DEPTH));
+        adds.push_back("-p: port, default: " + std::to_string(DEFAULT_BENCHMARK_PORT));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int requests = DEFAULT_REQUESTS;
+    int maxDepth = DEFAULT_DEPTH;
+    int port = DEFAULT_BENCHMARK_PORT;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-n"), v) && v > 0)
+    {
+        requests = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-d"), v) && v > 0)
+    {
+        maxDepth = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-p"), v))
+    {
+        port = v;
+    }
+
+    WebCpp::HttpServer httpServer;
+    WebCpp::HttpConfig &config = WebCpp::HttpConfig::Instance();
+    config.SetHttpProtocol(WebCpp::Http::Protocol::HTTP);
+    config.SetHttpServerAddress("127.0.0.1");
+    config.SetHttpServerPort(port);
+
+    if(httpServer.Init() == false)
+    {
+        std::cout << "HTTP server Init() failed: " << httpServer.GetLastError() << std::endl;
+        return 1;
+    }
+
+    httpServer.OnGet("/", [](const WebCpp::Request &, WebCpp::Response &response) -> bool
+    {
+        response.AddHeader("Content-Type","text/plain");
+        response.Write("pong");
+        return true;
+    });
+
+    if(httpServer.Run() == false)
+    {
+        std::cout << "HTTP server Run() failed: " << httpServer.GetLastError() << std::endl;
+        return 1;
+    }
+
+    std::vector<int> depths;
+    for(int depth = 1;depth < maxDepth;depth *= 2)
+    {
+        depths.push_back(depth);
+    }
+    depths.push_back(maxDepth);
+
+    std::stringstream stream;
+    stream << "|   depth |      req/sec | speedup |\n";
+
+    double serial = (-1);
+    for(auto depth: depths)
+    {
+        double result = Run(port, requests, depth);
+        if(depth == 1)
+        {
+            serial = result;
+        }
+        stream << "|" << std::setw(8) << std::right << depth << " |";
+        stream << std::setw(13) << std::right << std::fixed << std::setprecision(0) << result << " |";
+        stream << std::setw(8) << std::right << std::fixed << std::setprecision(2) << (serial > 0 ? result / serial : 0.0) << " |\n";
+    }
+
+    std::cout << stream.str();
+
+    httpServer.Close();
+
+    return 0;
+}
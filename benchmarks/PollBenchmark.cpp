@@ -0,0 +1,225 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+/*
+ * PollBenchmark - opens a growing number of idle connections to a SocketPool
+ * and measures the cost of one poll/read iteration for a single active client
+ * using the poll() and the epoll backends.
+*/
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include "common_webcpp.h"
+#include "SocketPool.h"
+#include "StringUtil.h"
+#include "example_common.h"
+#include "benchmark_common.h"
+
+#define DEFAULT_MAX_CONNECTIONS 10000
+#define DEFAULT_ITERATIONS 10000
+#define DEFAULT_BENCHMARK_PORT 8090
+
+
+static size_t AcceptClient(WebCpp::SocketPool &pool)
+{
+    for(int i = 0;i < 1000;i ++)
+    {
+        size_t index = pool.Accept();
+        if(index != static_cast<size_t>(ERROR))
+        {
+            return index;
+        }
+        usleep(100);
+    }
+
+    return ERROR;
+}
+
+// returns the average duration of one write/poll/read cycle in µs or (-1) on error
+static double Run(WebCpp::SocketPool::PollMode mode, size_t idle, int iterations, int port)
+{
+    WebCpp::SocketPool pool(idle + 2,
+                            WebCpp::SocketPool::Service::Server,
+                            WebCpp::SocketPool::Domain::Inet,
+                            WebCpp::SocketPool::Type::Stream,
+                            WebCpp::SocketPool::Options::ReuseAddr);
+    pool.SetPollMode(mode);
+    if(pool.Create(true) == ERROR || pool.Bind("127.0.0.1", port) == false || pool.Listen() == false)
+    {
+        std::cout << "server socket error: " << pool.GetLastError() << std::endl;
+        return (-1);
+    }
+
+    std::vector<int> clients;
+    double retval = (-1);
+
+    for(size_t i = 0;i <= idle;i ++)
+    {
+        int fd = ConnectClient(port);
+        if(fd == ERROR || AcceptClient(pool) == static_cast<size_t>(ERROR))
+        {
+            std::cout << "failed to open connection #" << i << ": " << pool.GetLastError() << std::endl;
+            if(fd != ERROR)
+            {
+                close(fd);
+            }
+            break;
+        }
+        clients.push_back(fd);
+    }
+
+    if(clients.size() == idle + 1)
+    {
+        int active = clients.back();
+        char buffer[64];
+        uint8_t byte = 'x';
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0;i < iterations;i ++)
+        {
+            if(send(active, &byte, 1, 0) != 1)
+            {
+                break;
+            }
+
+            bool received = false;
+            while(received == false)
+            {
+                if(pool.Poll())
+                {
+                    for(size_t j = 0;j < pool.GetReadyCount();j ++)
+                    {
+                        size_t index = pool.GetReadyIndex(j);
+                        if(index != 0 && pool.HasData(index))
+                        {
+                            while(pool.Read(buffer, sizeof(buffer), index) > 0)
+                            {
+                                received = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        retval = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()) / iterations;
+    }
+
+    for(auto fd: clients)
+    {
+        close(fd);
+    }
+    pool.CloseSockets();
+
+    return retval;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-c: max count of idle connections, default: " + std::to_string(DEFAULT_MAX_CONNECTIONS));
+        adds.push_back("-n: count of iterations, default: " + std::to_string(DEFAULT_ITERATIONS));
+        adds.push_back("-p: port, default: " + std::to_string(DEFAULT_BENCHMARK_PORT));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int maxConnections = DEFAULT_MAX_CONNECTIONS;
+    int iterations = DEFAULT_ITERATIONS;
+    int port = DEFAULT_BENCHMARK_PORT;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-c"), v))
+    {
+        maxConnections = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-n"), v))
+    {
+        iterations = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-p"), v))
+    {
+        port = v;
+    }
+
+    // each connection costs two descriptors, the client one and the server one
+    struct rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+        if(static_cast<rlim_t>(maxConnections) * 2 + 32 > limit.rlim_cur)
+        {
+            maxConnections = static_cast<int>((limit.rlim_cur - 32) / 2);
+            std::cout << "the count of connections is limited to " << maxConnections << " by RLIMIT_NOFILE" << std::endl;
+        }
+    }
+
+    std::vector<WebCpp::SocketPool::PollMode> modes = {
+        WebCpp::SocketPool::PollMode::Poll,
+        WebCpp::SocketPool::PollMode::Epoll,
+        WebCpp::SocketPool::PollMode::EpollEdge };
+
+    std::stringstream stream;
+    stream << "|  idle conn. |";
+    for(auto mode: modes)
+    {
+        stream << std::setw(14) << std::right << WebCpp::SocketPool::PollMode2String(mode) << ", µs |";
+    }
+    stream << "\n";
+
+    std::vector<int> steps;
+    for(int idle = 10;idle <= maxConnections;idle *= 10)
+    {
+        steps.push_back(idle);
+    }
+    if(steps.empty() || steps.back() != maxConnections)
+    {
+        steps.push_back(maxConnections);
+    }
+
+    for(auto idle: steps)
+    {
+        stream << "|" << std::setw(12) << std::right << idle << " |";
+        for(auto mode: modes)
+        {
+            double result = Run(mode, idle, iterations, port);
+            stream << std::setw(18) << std::right << std::fixed << std::setprecision(2) << result << " |";
+        }
+        stream << "\n";
+    }
+
+    std::cout << stream.str();
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+/*
+ * ResponseBenchmark - measures the cost of turning a typical small response
+ * into bytes: the Date header and the serialization of the status line and
+ * the headers, compared with building the same bytes by string concatenation
+ * and formatting the date for every response.
+*/
+
+#include <ctime>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include "common_webcpp.h"
+#include "HttpConfig.h"
+#include "Response.h"
+#include "FileSystem.h"
+#include "StringUtil.h"
+#include "example_common.h"
+
+#define DEFAULT_ITERATIONS 1000000
+
+
+static std::string FormatDate()
+{
+    time_t now = time(nullptr);
+    struct tm timeinfo;
+    char buffer[30];
+    gmtime_r(&now, &timeinfo);
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &timeinfo);
+    return buffer;
+}
+
+static void FillResponse(WebCpp::Response &response)
+{
+    response.AddHeader(WebCpp::HttpHeader::HeaderType::ContentType, "text/html;charset=utf-8");
+    response.AddHeader(WebCpp::HttpHeader::HeaderType::Connection, "keep-alive");
+    response.AddHeader(WebCpp::HttpHeader::HeaderType::CacheControl, "no-cache");
+    response.Write("<h3>WebCpp works!</h3>");
+}
+
+// the serialization as it's done by concatenating strings
+static size_t Concatenate(const WebCpp::Response &response)
+{
+    std::string str = response.GetHttpVersion() + " " + std::to_string(response.GetResponseCode()) + " " + response.GetResponsePhrase() + CR + LF;
+    for(auto const &header: response.GetHeader().GetHeaders())
+    {
+        str += header.name + ": " + header.value + CR + LF;
+    }
+    str += CR;
+    str += LF;
+    ByteArray data(str.begin(), str.end());
+    return data.size();
+}
+
+template<typename F>
+static double Measure(int iterations, F f)
+{
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0;i < iterations;i ++)
+    {
+        total += f();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // the total is used so the compiler can't drop the calls
+    if(total == 0)
+    {
+        return (-1);
+    }
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-n: count of iterations, default: " + std::to_string(DEFAULT_ITERATIONS));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int iterations = DEFAULT_ITERATIONS;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-n"), v) && v > 0)
+    {
+        iterations = v;
+    }
+
+    WebCpp::HttpConfig &config = WebCpp::HttpConfig::Instance();
+    WebCpp::Response response(0, config);
+    FillResponse(response);
+    response.AddHeader(WebCpp::HttpHeader::HeaderType::Date, WebCpp::FileSystem::GetDateTime());
+    std::vector<struct iovec> buffers;
+
+    struct Result
+    {
+        std::string name;
+        double concatenated;
+        double current;
+    };
+    std::vector<Result> results;
+
+    results.push_back(Result{ "Date header",
+                              Measure(iterations, []() { return FormatDate().size(); }),
+                              Measure(iterations, []() { return WebCpp::FileSystem::GetDateTime().size(); }) });
+    results.push_back(Result{ "status line and headers",
+                              Measure(iterations, [&response]() { return Concatenate(response); }),
+                              Measure(iterations, [&response, &buffers]()
+                              {
+                                  buffers.clear();
+                                  response.AppendBuffers(buffers);
+                                  return buffers.size();
+                              }) });
+    results.push_back(Result{ "whole response",
+                              Measure(iterations, [&config]()
+                              {
+                                  WebCpp::Response response(0, config);
+                                  FillResponse(response);
+                                  response.AddHeader(WebCpp::HttpHeader::HeaderType::Date, FormatDate());
+                                  return Concatenate(response);
+                              }),
+                              Measure(iterations, [&config, &buffers]()
+                              {
+                                  WebCpp::Response response(0, config);
+                                  FillResponse(response);
+                                  response.AddHeader(WebCpp::HttpHeader::HeaderType::Date, WebCpp::FileSystem::GetDateTime());
+                                  buffers.clear();
+                                  response.AppendBuffers(buffers);
+                                  return buffers.size();
+                              }) });
+
+    std::stringstream stream;
+    stream << "|                    step | concatenated, ns |   current, ns | speedup |\n";
+    for(auto &result: results)
+    {
+        stream << "|" << std::setw(24) << std::right << result.name << " |";
+        stream << std::setw(17) << std::right << std::fixed << std::setprecision(1) << result.concatenated << " |";
+        stream << std::setw(14) << std::right << std::fixed << std::setprecision(1) << result.current << " |";
+        stream << std::setw(8) << std::right << std::fixed << std::setprecision(2) << result.concatenated / result.current << " |\n";
+    }
+    std::cout << stream.str();
+
+    return 0;
+}
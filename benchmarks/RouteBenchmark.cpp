@@ -0,0 +1,275 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+/*
+ * RouteBenchmark - registers up to 1000 routes of different kinds (static,
+ * typed variables, groups, optional parts, wildcards), checks that the route
+ * tree picks the same route with the same arguments as matching the routes
+ * one by one with Route::IsMatch() and measures the cost of a lookup.
+*/
+
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include "common_webcpp.h"
+#include "RouteHttp.h"
+#include "RouteTree.h"
+#include "Request.h"
+#include "StringUtil.h"
+#include "example_common.h"
+
+#define DEFAULT_ROUTES 1000
+#define DEFAULT_ITERATIONS 200000
+#define DEFAULT_SEED 1
+
+
+struct Sample
+{
+    std::string path;
+    std::vector<std::string> args;  // the argument names the route has
+};
+
+static std::string MakePattern(size_t i, std::vector<std::string> &args)
+{
+    std::string n = std::to_string(i);
+    switch(i % 5)
+    {
+        case 0: return "/api/v" + std::to_string(i % 3) + "/items" + n;
+        case 1: args = { "id" }; return "/users" + n + "/{id:numeric}";
+        case 2: args = { "category", "item" }; return "/shop" + n + "/{category:alpha}/{item}";
+        case 3: args = { "slug", "page" }; return "/(blog|news)" + n + "/{slug:string}/[{page:numeric}]";
+        default: return "/files" + n + "/*";
+    }
+}
+
+static std::string MakePath(size_t i, std::mt19937 &random)
+{
+    std::string n = std::to_string(i);
+    std::string number = std::to_string(random() % 100000);
+    switch(i % 5)
+    {
+        case 0: return "/api/v" + std::to_string(i % 3) + "/items" + n;
+        case 1: return (random() % 4 == 0) ? "/users" + n + "/abc" : "/users" + n + "/" + number;
+        case 2: return "/shop" + n + "/books/item-" + number;
+        case 3: return std::string(random() % 2 ? "/blog" : "/news") + n + "/hello_world/" + (random() % 2 ? number : "");
+        default: return "/files" + n + "/css/style" + number + ".css";
+    }
+}
+
+static WebCpp::Request MakeRequest(const std::string &path)
+{
+    WebCpp::Request request;
+    request.Parse(StringUtil::String2ByteArray("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    return request;
+}
+
+// the way the routes were looked up before, the first one that matches
+static size_t FindLinear(std::vector<WebCpp::RouteHttp> &routes, size_t count, WebCpp::Request &request)
+{
+    for(size_t i = 0;i < count;i ++)
+    {
+        if(routes[i].IsMatch(request))
+        {
+            return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t FindTree(const WebCpp::RouteTree &tree, std::vector<WebCpp::RouteHttp> &routes, WebCpp::Request &request, std::vector<WebCpp::RouteTree::Match> &matches)
+{
+    const std::string path = request.GetUrl().GetPath();
+    tree.Find(request.GetMethod(), path, matches);
+    for(auto &match: matches)
+    {
+        if(match.verify == false || routes[match.index].IsMatch(request))
+        {
+            WebCpp::RouteTree::SetArgs(match, path, request);
+            return match.index;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static bool Check(std::vector<WebCpp::RouteHttp> &routes, const std::vector<std::vector<std::string>> &args, const WebCpp::RouteTree &tree, const std::vector<std::string> &paths)
+{
+    std::vector<WebCpp::RouteTree::Match> matches;
+    for(auto &path: paths)
+    {
+        WebCpp::Request linear = MakeRequest(path);
+        WebCpp::Request compiled = MakeRequest(path);
+        size_t expected = FindLinear(routes, routes.size(), linear);
+        size_t found = FindTree(tree, routes, compiled, matches);
+        if(expected != found)
+        {
+            std::cout << "mismatch: " << path << ", expected route " << expected << ", found " << found << std::endl;
+            return false;
+        }
+        if(expected == SIZE_MAX)
+        {
+            continue;
+        }
+        // the arguments of the matching route only, a failed IsMatch() leaves some as well
+        WebCpp::Request clean = MakeRequest(path);
+        routes[expected].IsMatch(clean);
+        for(auto &name: args[expected])
+        {
+            if(clean.GetArg(name) != compiled.GetArg(name))
+            {
+                std::cout << "mismatch: " << path << ", argument " << name << ": " << clean.GetArg(name) << " / " << compiled.GetArg(name) << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<typename F>
+static double Measure(std::vector<WebCpp::Request> &requests, int iterations, F f)
+{
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0;i < iterations;i ++)
+    {
+        found += (f(requests[static_cast<size_t>(i) % requests.size()]) != SIZE_MAX);
+    }
+    auto end = std::chrono::steady_clock::now();
+    if(found == 0)
+    {
+        return (-1);
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / static_cast<double>(iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-c: count of routes, default: " + std::to_string(DEFAULT_ROUTES));
+        adds.push_back("-n: count of lookups, default: " + std::to_string(DEFAULT_ITERATIONS));
+        adds.push_back("-r: random seed, default: " + std::to_string(DEFAULT_SEED));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int count = DEFAULT_ROUTES;
+    int iterations = DEFAULT_ITERATIONS;
+    int seed = DEFAULT_SEED;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-c"), v) && v > 0)
+    {
+        count = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-n"), v) && v > 0)
+    {
+        iterations = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-r"), v))
+    {
+        seed = v;
+    }
+
+    std::mt19937 random(seed);
+    std::vector<WebCpp::RouteHttp> routes;
+    std::vector<std::vector<std::string>> args;
+    for(size_t i = 0;i < static_cast<size_t>(count);i ++)
+    {
+        std::vector<std::string> names;
+        routes.push_back(WebCpp::RouteHttp(MakePattern(i, names), WebCpp::Http::Method::GET));
+        args.push_back(names);
+    }
+
+    // every route gets its paths, some of them are not found
+    std::vector<std::string> paths;
+    for(size_t i = 0;i < routes.size();i ++)
+    {
+        paths.push_back(MakePath(i, random));
+        paths.push_back(MakePath(i, random));
+    }
+    paths.push_back("/");
+    paths.push_back("/unknown/path");
+    paths.push_back("/users/");
+    paths.push_back("/shop1/123/x");
+
+    WebCpp::RouteTree full;
+    for(size_t i = 0;i < routes.size();i ++)
+    {
+        full.Add(i, routes[i]);
+    }
+    bool checkOk = Check(routes, args, full, paths);
+
+    // Route::IsMatch() doesn't go back to another alternative of a group or to skip
+    // an optional part, the routes after these ones get the paths
+    std::vector<WebCpp::RouteHttp> edgeRoutes;
+    std::vector<std::vector<std::string>> edgeArgs = { {}, {}, {}, {}, { "id", "name" }, { "name" } };
+    for(auto &pattern: { "/(ab|a)bc", "/abc", "/x[/y]/y", "/x/y", "/(a|ab)[/{id:numeric}]/{name}", "/ab/{name}" })
+    {
+        edgeRoutes.push_back(WebCpp::RouteHttp(pattern, WebCpp::Http::Method::GET));
+    }
+    WebCpp::RouteTree edge;
+    for(size_t i = 0;i < edgeRoutes.size();i ++)
+    {
+        edge.Add(i, edgeRoutes[i]);
+    }
+    checkOk = checkOk && Check(edgeRoutes, edgeArgs, edge, { "/abc", "/abbc", "/x/y", "/x/y/y", "/a/12/test", "/a/test", "/ab/12", "/ab/test" });
+    std::cout << "routing results: " << (checkOk ? "OK" : "FAILED") << std::endl;
+
+    std::stringstream stream;
+    stream << "| routes | linear, ns/lookup | tree, ns/lookup | speedup |\n";
+    std::vector<WebCpp::RouteTree::Match> matches;
+    for(size_t size: { static_cast<size_t>(10), static_cast<size_t>(100), routes.size() })
+    {
+        if(size > routes.size())
+        {
+            continue;
+        }
+        WebCpp::RouteTree tree;
+        std::vector<WebCpp::Request> requests;
+        for(size_t i = 0;i < size;i ++)
+        {
+            tree.Add(i, routes[i]);
+            requests.push_back(MakeRequest(MakePath(random() % size, random)));
+        }
+
+        double linear = Measure(requests, iterations, [&](WebCpp::Request &request) { return FindLinear(routes, size, request); });
+        double compiled = Measure(requests, iterations, [&](WebCpp::Request &request) { return FindTree(tree, routes, request, matches); });
+
+        stream << "|" << std::setw(7) << std::right << size << " |";
+        stream << std::setw(18) << std::right << std::fixed << std::setprecision(0) << linear << " |";
+        stream << std::setw(16) << std::right << compiled << " |";
+        stream << std::setw(8) << std::right << std::setprecision(1) << linear / compiled << " |\n";
+    }
+    std::cout << stream.str();
+
+    return checkOk ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+/*
+ * SearchBenchmark - checks StringUtil::SearchPosition() and SearchPositionReverse()
+ * against the plain byte loops on random data and measures the search speed
+ * for the short delimiters (CRLF, CRLFCRLF) and a multipart boundary in
+ * MB-sized buffers.
+*/
+
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include "common_webcpp.h"
+#include "StringUtil.h"
+#include "example_common.h"
+
+#define DEFAULT_SIZE 16
+#define DEFAULT_ITERATIONS 10000
+#define DEFAULT_SEED 1
+
+
+// the byte loops the search was done with before
+static size_t NaiveSearch(const ByteArray &str, const ByteArray &substring, size_t start, size_t end)
+{
+    if(end == SIZE_MAX || end >= str.size())
+    {
+        end = str.size() - 1;
+    }
+    if(str.empty() || substring.empty() || start > end || end - start + 1 < substring.size())
+    {
+        return SIZE_MAX;
+    }
+    for(size_t pos1 = start;pos1 <= end - substring.size() + 1;pos1 ++)
+    {
+        size_t pos2;
+        for(pos2 = 0;pos2 < substring.size() && str[pos1 + pos2] == substring[pos2];pos2 ++);
+        if(pos2 == substring.size())
+        {
+            return pos1;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t NaiveSearchReverse(const ByteArray &str, const ByteArray &substring, size_t start, size_t end)
+{
+    if(end == SIZE_MAX || end >= str.size())
+    {
+        end = str.size() - 1;
+    }
+    if(str.empty() || substring.empty() || start > end || end - start + 1 < substring.size())
+    {
+        return SIZE_MAX;
+    }
+    for(size_t pos1 = end - substring.size() + 2;pos1 > start;)
+    {
+        pos1 --;
+        size_t pos2;
+        for(pos2 = 0;pos2 < substring.size() && str[pos1 + pos2] == substring[pos2];pos2 ++);
+        if(pos2 == substring.size())
+        {
+            return pos1;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+// random short buffers of a small alphabet, so there are a lot of partial matches
+static bool Check(std::mt19937 &random, int iterations)
+{
+    const std::string alphabet = "ab-\r\n";
+    for(int i = 0;i < iterations;i ++)
+    {
+        ByteArray str(random() % 300);
+        for(auto &ch: str)
+        {
+            ch = alphabet[random() % alphabet.size()];
+        }
+        ByteArray substring(1 + random() % 6);
+        for(auto &ch: substring)
+        {
+            ch = alphabet[random() % alphabet.size()];
+        }
+        size_t start = str.empty() ? 0 : random() % str.size();
+        size_t end = (random() % 4 == 0) ? SIZE_MAX : (str.empty() ? 0 : random() % str.size());
+
+        if(StringUtil::SearchPosition(str, substring, start, end) != NaiveSearch(str, substring, start, end) ||
+                StringUtil::SearchPositionReverse(str, substring, start, end) != NaiveSearchReverse(str, substring, start, end))
+        {
+            std::cout << "mismatch: size " << str.size() << ", substring " << substring.size() << ", start " << start << ", end " << end << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// returns the search speed in MB/s, the substring is at the very end (or the very beginning for the reverse search)
+template<typename F>
+static double Measure(const ByteArray &data, const ByteArray &substring, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t pos = f(data, substring, 0, SIZE_MAX);
+    auto end = std::chrono::steady_clock::now();
+    if(pos == SIZE_MAX)
+    {
+        return (-1);
+    }
+
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000000.0;
+    return seconds > 0 ? (data.size() / 1024.0 / 1024.0) / seconds : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    auto cmdline = CommandLine::Parse(argc, argv);
+
+    if(cmdline.Exists("-h"))
+    {
+        std::vector<std::string> adds;
+        adds.push_back("-s: size of the buffer in MB, default: " + std::to_string(DEFAULT_SIZE));
+        adds.push_back("-n: count of random checks, default: " + std::to_string(DEFAULT_ITERATIONS));
+        adds.push_back("-r: random seed, default: " + std::to_string(DEFAULT_SEED));
+        cmdline.PrintUsage(false, false, adds);
+        exit(0);
+    }
+
+    int size = DEFAULT_SIZE;
+    int iterations = DEFAULT_ITERATIONS;
+    int seed = DEFAULT_SEED;
+    int v;
+    if(StringUtil::String2int(cmdline.Get("-s"), v) && v > 0)
+    {
+        size = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-n"), v) && v > 0)
+    {
+        iterations = v;
+    }
+    if(StringUtil::String2int(cmdline.Get("-r"), v))
+    {
+        seed = v;
+    }
+
+    std::mt19937 random(seed);
+    bool checkOk = Check(random, iterations);
+    std::cout << "search results: " << (checkOk ? "OK" : "FAILED") << std::endl;
+
+    struct Needle
+    {
+        std::string name;
+        ByteArray substring;
+    };
+    std::vector<Needle> needles;
+    needles.push_back(Needle{ "CRLF", { CR, LF } });
+    needles.push_back(Needle{ "CRLFCRLF", { CR, LF, CR, LF } });
+    needles.push_back(Needle{ "multipart boundary", StringUtil::String2ByteArray("\r\n--------------------------d74496d66958873e") });
+
+    // a text with single CR, LF and '-' so the filters see candidates now and then
+    ByteArray data(static_cast<size_t>(size) * 1024 * 1024);
+    const std::string text = "Lorem ipsum dolor sit amet, consectetur adipiscing elit -\r- sed do eiusmod\n";
+    for(size_t i = 0;i < data.size();i ++)
+    {
+        data[i] = text[i % text.size()];
+    }
+
+    std::stringstream stream;
+    stream << "|          substring |   naive, MB/s |    SIMD, MB/s | speedup | naive rev, MB/s |  SIMD rev, MB/s | speedup |\n";
+    for(auto &needle: needles)
+    {
+        ByteArray forward = data;
+        std::copy(needle.substring.begin(), needle.substring.end(), forward.end() - needle.substring.size());
+        ByteArray reverse = data;
+        std::copy(needle.substring.begin(), needle.substring.end(), reverse.begin());
+
+        double naive = Measure(forward, needle.substring, NaiveSearch);
+        double simd = Measure(forward, needle.substring, StringUtil::SearchPosition);
+        double naiveReverse = Measure(reverse, needle.substring, NaiveSearchReverse);
+        double simdReverse = Measure(reverse, needle.substring, StringUtil::SearchPositionReverse);
+
+        stream << "|" << std::setw(19) << std::right << needle.name << " |";
+        stream << std::setw(14) << std::right << std::fixed << std::setprecision(0) << naive << " |";
+        stream << std::setw(14) << std::right << simd << " |";
+        stream << std::setw(8) << std::right << std::setprecision(2) << simd / naive << " |";
+        stream << std::setw(16) << std::right << std::setprecision(0) << naiveReverse << " |";
+        stream << std::setw(16) << std::right << simdReverse << " |";
+        stream << std::setw(8) << std::right << std::setprecision(2) << simdReverse / naiveReverse << " |\n";
+    }
+    std::cout << stream.str();
+
+    return checkOk ? 0 : 1;
+}
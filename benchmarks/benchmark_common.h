@@ -22,45 +22,36 @@
 *
 */
 
-#ifndef WEBCPP_KEEP_ALIVE_TIMER_H
-#define WEBCPP_KEEP_ALIVE_TIMER_H
+#ifndef BENCHMARK_COMMON_H
+#define BENCHMARK_COMMON_H
 
-#include <functional>
-#include <vector>
-#include <inttypes.h>
-#include <ThreadWorker.h>
-#include "Mutex.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "IErrorable.h"
 
 
-namespace WebCpp
+// opens a client connection to the local port, returns its descriptor or ERROR
+inline int ConnectClient(int port)
 {
-
-class KeepAliveTimer final
-{
-public:
-    ~KeepAliveTimer();
-    static void run();
-    static void stop();
-    static void SetCallback(std::function<void(int)> callback);
-    static void SetTimer(uint32_t delay, int connID);
-
-protected:
-    static void *task(bool &);
-
-private:
-    struct Timer
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd == ERROR)
     {
-        int connID;
-        int ticks;
-        int remain;
-    };
-
-    static std::function<void(int)> m_callback;
-    static ThreadWorker m_task;
-    static std::vector<Timer> m_timers;
-    static Mutex m_mutex;
-};
+        return ERROR;
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if(connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == ERROR)
+    {
+        close(fd);
+        return ERROR;
+    }
 
+    return fd;
 }
 
-#endif // WEBCPP_KEEP_ALIVE_TIMER_H
+#endif // BENCHMARK_COMMON_H
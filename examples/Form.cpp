@@ -27,6 +27,8 @@
 */
 
 #include <csignal>
+#include <map>
+#include <mutex>
 #include "common_webcpp.h"
 #include "HttpServer.h"
 #include "Request.h"
@@ -38,6 +40,8 @@
 
 
 static WebCpp::HttpServer *httpServerPtr = nullptr;
+static std::map<int, size_t> uploads; // bytes received by the streaming route, per connection
+static std::mutex uploadsMutex;
 
 void handle_sigint(int)
 {
@@ -129,6 +133,29 @@ int main(int argc, char *argv[])
             return retval;
         });
 
+        // the body isn't kept, the handler gets it by chunks as it arrives
+        httpServer.OnPostStream("/upload", [](const WebCpp::Request &request, const ByteArray &data) -> bool
+        {
+            std::lock_guard<std::mutex> lock(uploadsMutex);
+            uploads[request.GetConnectionID()] += data.size();
+            return true;
+        },
+        [](const WebCpp::Request &request, WebCpp::Response &response) -> bool
+        {
+            size_t size = 0;
+            {
+                std::lock_guard<std::mutex> lock(uploadsMutex);
+                size = uploads[request.GetConnectionID()];
+                uploads.erase(request.GetConnectionID());
+            }
+            WebCpp::DebugPrint() << "OnPostStream(), received: " << size << std::endl;
+
+            response.AddHeader("Content-Type","text/html;charset=utf-8");
+            response.Write("<div>" + std::to_string(size) + " bytes were successfully uploaded</div>");
+
+            return true;
+        });
+
         httpServer.Run();
         WebCpp::DebugPrint() << "Starting... Press Ctrl-C to terminate" << std::endl;
         httpServer.WaitFor();
@@ -97,6 +97,25 @@ int main(int argc, char *argv[])
             return true;
         });
 
+        httpServer.OnGet("/numbers/{count:numeric}", [](const WebCpp::Request &request, WebCpp::Response &response) -> bool
+        {
+            int count = 0;
+            StringUtil::String2int(request.GetArg("count"), count);
+
+            WebCpp::DebugPrint() << "OnGet(), numbers/: count: " << count << std::endl;
+
+            // the lines are sent as they are produced, the size isn't known in advance
+            response.AddHeader("Content-Type","text/plain;charset=utf-8");
+            for(int i = 1;i <= count;i ++)
+            {
+                if(response.WriteChunk(std::to_string(i) + "\n") == false)
+                {
+                    break;
+                }
+            }
+            return true;
+        });
+
         httpServer.Run();
         WebCpp::DebugPrint() << "Starting... Press Ctrl-C to terminate" << std::endl;
         httpServer.WaitFor();
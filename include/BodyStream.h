@@ -0,0 +1,89 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifndef WEBCPP_BODY_STREAM_H
+#define WEBCPP_BODY_STREAM_H
+
+#include <functional>
+#include <deque>
+#include "common_webcpp.h"
+#include "Mutex.h"
+#include "Signal.h"
+
+
+namespace WebCpp
+{
+
+class Request;
+
+/* the body of a request routed to a streaming handler, the chunks are queued
+ * as they arrive and passed to the handler in order on a worker thread.
+ * Reading from the client is paused while more than the high watermark is queued.
+ * The check function, if any, is called on the worker before the first chunk */
+class BodyStream
+{
+public:
+    using BodyFunc = std::function<bool(const Request &request, const ByteArray &data)>;
+    using ScheduleFunc = std::function<bool()>;
+    using PauseFunc = std::function<void(bool pause)>;
+    using CheckFunc = std::function<bool()>;
+
+    BodyStream(const Request *request, const BodyFunc &func, size_t highWatermark, size_t lowWatermark);
+    BodyStream(const BodyStream& other) = delete;
+    BodyStream& operator=(const BodyStream& other) = delete;
+    BodyStream(BodyStream&& other) = delete;
+    BodyStream& operator=(BodyStream&& other) = delete;
+
+    void SetScheduleFunction(const ScheduleFunc &f);
+    void SetPauseFunction(const PauseFunc &f);
+    void SetCheckFunction(const CheckFunc &f);
+    void Push(const ByteArray &data, size_t offset, size_t size);
+    void Drain();
+    bool IsFailed() const;
+    bool GetCheckResult(bool &passed) const;
+    size_t GetPending() const;
+
+private:
+    const Request *m_request;
+    BodyFunc m_func;
+    ScheduleFunc m_schedule = nullptr;
+    PauseFunc m_pause = nullptr;
+    CheckFunc m_check = nullptr;
+    size_t m_highWatermark;
+    size_t m_lowWatermark;
+    mutable Mutex m_mutex;
+    Signal m_signal;
+    std::deque<ByteArray> m_chunks;
+    size_t m_pending = 0;       // queued bytes
+    bool m_scheduled = false;   // a drain is posted and hasn't started yet
+    bool m_active = false;      // the handler is being called
+    bool m_paused = false;      // reading is paused by the high watermark
+    bool m_failed = false;      // the handler refused the data, the rest is dropped
+    bool m_checked = false;     // the check function was called
+    bool m_passed = false;      // the result of the check function
+};
+
+}
+
+#endif // WEBCPP_BODY_STREAM_H
@@ -0,0 +1,78 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifndef WEBCPP_CHUNKED_DECODER_H
+#define WEBCPP_CHUNKED_DECODER_H
+
+#include <functional>
+#include "common_webcpp.h"
+#include "IErrorable.h"
+
+#define MAX_CHUNK_LINE_SIZE 4096 // a chunk size line with extensions or a trailer line
+
+
+namespace WebCpp
+{
+
+/* Transfer-Encoding: chunked body decoder, the data is passed on as it's
+ * received, an incomplete size or trailer line is left for the next call */
+class ChunkedDecoder: public IErrorable
+{
+public:
+    enum class Result
+    {
+        NeedMore = 0,
+        Complete,
+        Error,
+    };
+    using DataFunc = std::function<bool(const ByteArray &data, size_t offset, size_t size)>;
+
+    ChunkedDecoder() = default;
+
+    Result Decode(const ByteArray &data, size_t offset, size_t size, size_t &consumed, const DataFunc &f);
+    bool IsComplete() const;
+    size_t GetDecodedSize() const;
+    void Reset();
+
+protected:
+    enum class State
+    {
+        Size = 0,
+        Data,
+        DataEnd,
+        Trailer,
+        Complete,
+    };
+
+    bool ParseSize(const ByteArray &data, size_t start, size_t end);
+
+private:
+    State m_state = State::Size;
+    size_t m_chunkSize = 0; // bytes left in the current chunk
+    size_t m_decoded = 0;
+};
+
+}
+
+#endif // WEBCPP_CHUNKED_DECODER_H
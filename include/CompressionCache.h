@@ -0,0 +1,86 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifdef WITH_ZLIB
+#ifndef WEBCPP_COMPRESSION_CACHE_H
+#define WEBCPP_COMPRESSION_CACHE_H
+
+#include <map>
+#include <string>
+#include "Mutex.h"
+
+#define DEFAULT_COMPRESSION_FOLDER "webcpp-gzip"
+
+
+namespace WebCpp
+{
+
+/* gzip variants of the static files, a file is compressed once on the first
+ * request and then sent from the disk as is. A fresh file.gz next to the file
+ * is used instead. The variant is keyed by the path and the modification time
+ * so a changed file is compressed again. The caller knows the size and the time
+ * of the source file and checks the variant itself, see FileCache. An empty
+ * path means the file is sent as is, the reason of a failure is logged.
+ * The variants are sent without any check so they are kept in a folder nobody
+ * else can write to: a new one made by mkdtemp() by default, a configured one
+ * must belong to the user and be writable by nobody else */
+class CompressionCache
+{
+public:
+    static CompressionCache& Instance();
+    CompressionCache(const CompressionCache& other) = delete;
+    CompressionCache& operator=(const CompressionCache& other) = delete;
+    ~CompressionCache();
+
+    std::string Get(const std::string &path, size_t sourceSize, int64_t modified);
+    void Remove(const std::string &path);
+    void Clear();
+
+protected:
+    CompressionCache() = default;
+    std::string GetFolder();
+    bool CompressFile(const std::string &source, const std::string &target, int level);
+    static bool IsPrivate(const std::string &folder);
+    static bool GetVariantStat(const std::string &path, size_t &size);
+
+private:
+    struct Entry
+    {
+        int64_t modified;   // of the source file
+        std::string path;   // of the gzip variant
+        size_t size;
+        bool own;           // created by the cache, deleted when it's outdated
+    };
+
+    Mutex m_mutex;
+    std::map<std::string, Entry> m_entries;
+    std::string m_folder;
+    bool m_failed = false;      // no folder for the variants, the files are sent as is
+    bool m_temporary = false;   // created by mkdtemp(), removed on exit
+};
+
+}
+
+#endif // WEBCPP_COMPRESSION_CACHE_H
+#endif // WITH_ZLIB
@@ -0,0 +1,116 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifndef WEBCPP_FILE_CACHE_H
+#define WEBCPP_FILE_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "common_webcpp.h"
+#include "ThreadWorker.h"
+#include "Mutex.h"
+
+#define FILE_CACHE_MAX_ENTRIES 10000
+#define FILE_CACHE_POLL_TIMEOUT 200 // msec. the watching thread checks whether it should stop
+
+
+namespace WebCpp
+{
+
+/* the static files known to the server: the metadata of a file and, for the small
+ * ones, the content are kept in memory so a hit costs no file I/O at all. The folders
+ * of the cached files are watched with inotify and an entry is dropped as soon
+ * as its file is changed, moved or deleted. The content is limited by FileCacheSize,
+ * the least recently used files are evicted first. A file is watched through the folder
+ * in its path, so a change made through a symlink to it elsewhere isn't noticed.
+ * The cache is shared by all the workers so it keeps no error state, a missing file
+ * is nullptr and a failure to watch is logged */
+class FileCache
+{
+public:
+    struct Entry
+    {
+        std::string path;
+        size_t size;
+        int64_t modified;           // nsec.
+        std::string lastModified;   // HTTP date
+        std::string mimeType;
+        std::string etag;           // strong, quoted
+        ByteArray content;
+        bool loaded;                // the content is in memory, otherwise the file is sent from the disk
+    };
+
+    static FileCache& Instance();
+    FileCache(const FileCache& other) = delete;
+    FileCache& operator=(const FileCache& other) = delete;
+    ~FileCache();
+
+    std::shared_ptr<const Entry> Get(const std::string &path);
+    void Remove(const std::string &path);
+    void Clear();
+    size_t GetCount() const;
+    size_t GetMemoryUsage() const;
+
+protected:
+    struct Item
+    {
+        std::shared_ptr<Entry> entry; // nullptr - the file doesn't exist
+        std::list<std::string>::iterator lru;
+    };
+    struct Folder
+    {
+        int wd;
+        uint64_t generation; // changed by every event in the folder
+    };
+
+    FileCache() = default;
+    std::shared_ptr<Entry> Load(const std::string &path, size_t maxSize);
+    bool Watch(const std::string &folder, uint64_t &generation);
+    void Insert(const std::string &path, const std::shared_ptr<Entry> &entry);
+    void Evict(size_t budget);
+    std::map<std::string, Item>::iterator Erase(std::map<std::string, Item>::iterator it);
+    void RemoveFolder(const std::string &folder);
+    void *WatchThread(bool &running);
+    static size_t GetMemory(const std::shared_ptr<Entry> &entry);
+    static std::string ExtractFolder(const std::string &path);
+
+private:
+    mutable Mutex m_mutex;
+    std::map<std::string, Item> m_entries;
+    std::list<std::string> m_lru;       // the most recently used first
+    std::map<std::string, Folder> m_folders;
+    std::map<int, std::vector<std::string>> m_watches; // the same folder can be watched by several paths
+    size_t m_memory = 0;
+    int m_inotify = -1;
+    bool m_failed = false;              // no inotify, nothing is cached
+    ThreadWorker m_thread;
+};
+
+}
+
+#endif // WEBCPP_FILE_CACHE_H
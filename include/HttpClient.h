@@ -35,6 +35,7 @@
 #include "Response.h"
 #include "Url.h"
 #include "AuthProvider.h"
+#include "File.h"
 
 
 namespace WebCpp {
@@ -72,6 +73,8 @@ public:
     void SetStateCallback(const std::function<void(State)> &func);
     void SetProgressCallback(const std::function<void(size_t,size_t)> &func);
     void SetAuthCallback(const std::function<bool(const Request&, AuthProvider&)> &func);
+    void SetBodyCallback(const Response::BodyFunc &func);
+    void SetOutputFile(const std::string &path);
     State GetState() const;
     void ClearAuth();
 
@@ -79,6 +82,8 @@ protected:
     bool Open();
     void OnDataReady(const ByteArray &data);
     void OnClosed();
+    bool BeginBody(Response &response);
+    void ProcessResponse();
     bool InitConnection(const Url &url);
     void SetState(State state);
     bool AddAuthHeaders();
@@ -88,7 +93,14 @@ private:
     std::shared_ptr<ICommunicationClient> m_connection = nullptr;
     HttpConfig &m_config;
     State m_state = State::Undefined;
-    ByteArray m_buffer;
+    ByteArray m_buffer;        // the received data that isn't parsed yet
+    std::unique_ptr<Response> m_response;
+    Response::BodyFunc m_bodyCallback = nullptr;
+    std::string m_outputFile;  // the body is written there instead of being collected
+    std::unique_ptr<File> m_output;
+#ifdef WITH_ZLIB
+    Decompressor m_decompressor; // used by all the responses of the connection
+#endif
     std::function<void(State)> m_stateCallback = nullptr;
     std::function<bool(const Response&)> m_responseCallback = nullptr;
     std::function<void(size_t,size_t)> m_progressCallback = nullptr;
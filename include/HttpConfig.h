@@ -71,14 +71,32 @@ private:
     PROPERTY(int, HttpServerPort, 8080)
     PROPERTY(Http::Protocol, HttpProtocol, Http::Protocol::HTTP)
     PROPERTY(int, KeepAliveTimeout, 10000)
+    PROPERTY(int, HeaderTimeout, 20000) // msec. to receive the whole request header, 0 - no limit
+    PROPERTY(int, ReadTimeout, 30000) // msec. between two reads of an incomplete request, 0 - no limit
+    PROPERTY(int, WriteTimeout, 30000) // msec. to send a response, 0 - no limit
+    PROPERTY(size_t, MaxConnections, 10000)
+    PROPERTY(size_t, ReactorCount, 1) // I/O threads, 0 - one per CPU core
+    PROPERTY(size_t, WorkerCount, 1) // request handler threads, 0 - one per CPU core
+    PROPERTY(size_t, WriteHighWatermark, 1_Mb) // queued output that pauses reading from the client
+    PROPERTY(size_t, WriteLowWatermark, 256_Kb) // queued output that resumes it
+    PROPERTY(size_t, StreamHighWatermark, 1_Mb) // body queued for a streaming handler that pauses reading from the client
+    PROPERTY(size_t, StreamLowWatermark, 256_Kb) // queued body that resumes it
     PROPERTY(std::string, SslSertificate, "cert.pem")
     PROPERTY(std::string, SslKey, "key.pem")
     PROPERTY(bool, TempFile, false)
     PROPERTY(bool, WsProcessDefault, true)
     PROPERTY(int, WsServerPort, 8081)
     PROPERTY(Http::Protocol, WsProtocol, Http::Protocol::WS)
+    PROPERTY(size_t, MaxHeaderSize, 16_Kb) // the request line and the header, a larger one is answered with 431
     PROPERTY(size_t, MaxBodySize, 2_Mb)
     PROPERTY(size_t, MaxBodyFileSize, 20_Mb)
+    PROPERTY(bool, Compression, true) // gzip/deflate responses for the clients that accept it, WITH_ZLIB only
+    PROPERTY(int, CompressionLevel, 6) // 1 - fastest ... 9 - smallest
+    PROPERTY(size_t, CompressionMinSize, 1_Kb) // smaller bodies are sent as is
+    PROPERTY(size_t, CompressionMaxFileSize, 10_Mb) // larger static files aren't compressed
+    PROPERTY(std::string, CompressionFolder, "") // precompressed static files, must be writable by the user only, empty - a new webcpp-gzip-XXXXXX in the temp. folder
+    PROPERTY(size_t, FileCacheSize, 32_Mb) // static file content kept in memory, 0 - every request reads the file
+    PROPERTY(size_t, FileCacheMaxFileSize, 256_Kb) // larger static files are sent from the disk
 
 };
 
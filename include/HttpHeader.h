@@ -132,6 +132,8 @@ public:
         static HttpHeader::Header defaultHeader;
     };
 
+    static constexpr size_t HeaderTypeCount = static_cast<size_t>(HeaderType::XFrameOptions) + 1;
+
     explicit HttpHeader(HeaderRole role);
     HttpHeader(const HttpHeader& other) = delete;
     HttpHeader& operator=(const HttpHeader& other) = delete;
@@ -140,7 +142,10 @@ public:
 
     bool Parse(const ByteArray &data, size_t start = 0);
     bool ParseHeader(const ByteArray &data);
+    bool ParseLine(const ByteArray &data, const StringUtil::Range &range, size_t colon = SIZE_MAX);
+    void SetComplete(size_t headerSize);
     ByteArray ToByteArray() const;
+    void Serialize(ByteArray &buffer) const;
     bool IsComplete() const;
     size_t GetHeaderSize() const;
     size_t GetBodySize() const;
@@ -160,23 +165,50 @@ public:
     std::string GetHeader(HeaderType headerType) const;
     std::string GetHeader(const std::string &headerType) const;
     std::vector<std::string> GetAllHeaders(const std::string &headerType) const;
-    const std::vector<HttpHeader::Header> &GetHeaders() const;
+    std::vector<HttpHeader::Header> GetHeaders() const;
     void SetHeader(HeaderType type, const std::string &value);
     void SetHeader(const std::string &name, const std::string &value);
+    void SetHeader(HeaderType type, const char *name, size_t nameSize, const char *value, size_t valueSize);
+    void RemoveHeader(HeaderType type);
     void Clear();
 
     static HttpHeader::HeaderType String2HeaderType(const std::string &str);
+    static HttpHeader::HeaderType String2HeaderType(const char *str, size_t size);
     static std::string HeaderType2String(HttpHeader::HeaderType headerType);
+    static const std::string& HeaderTypeName(HttpHeader::HeaderType headerType);
 
     std::string ToString() const;
 
 protected:
-    bool ParseHeaders(const ByteArray &data, const StringUtil::Ranges &ranges);
+    /* a part of m_data, the names and the values aren't stored as separate strings,
+     * so setting or parsing a header doesn't allocate anything but the growth of m_data */
+    struct Slice
+    {
+        size_t offset = 0;
+        size_t length = 0;
+        bool exists = false;
+    };
+    struct Entry // a header which name isn't one of HeaderType
+    {
+        Slice name;
+        Slice value;
+        uint32_t hash = 0; // of the name, case-insensitive
+    };
+
+    bool ParseHeaders(const ByteArray &data, size_t start, size_t end);
+    void AddLine(const ByteArray &data, size_t start, size_t end, size_t colon);
+    void Assign(Slice &slice, const char *str, size_t size);
+    std::string ToString(const Slice &slice) const;
+    bool IsEqual(const Slice &slice, const char *str, size_t size) const;
+    size_t FindEntry(const char *name, size_t size) const;
 
 private:
     HeaderRole m_role;
     bool m_complete = false;
-    std::vector<Header> m_headers = {};
+    ByteArray m_data;
+    Slice m_known[HeaderTypeCount];
+    std::vector<Entry> m_unknown;
+    size_t m_count = 0;
     std::string m_version = "HTTP/1.1";
     size_t m_headerSize = 0;
     std::string m_remoteAddress;
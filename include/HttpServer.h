@@ -33,12 +33,15 @@
 #include "IErrorable.h"
 #include "IRunnable.h"
 #include "ThreadWorker.h"
+#include "ThreadPool.h"
+#include "TimerWheel.h"
 #include "Mutex.h"
 #include "Signal.h"
 #include "SessionManager.h"
 #include "Request.h"
 #include "Response.h"
 #include "RouteHttp.h"
+#include "RouteTree.h"
 #include "HttpConfig.h"
 #include "HttpHeader.h"
 
@@ -63,12 +66,14 @@ public:
 
     HttpServer& OnGet(const std::string &path, const RouteHttp::RouteFunc &f, bool needAuth = false);
     HttpServer& OnPost(const std::string &path, const RouteHttp::RouteFunc &f, bool needAuth = false);
+    HttpServer& OnPostStream(const std::string &path, const RouteHttp::BodyFunc &body, const RouteHttp::RouteFunc &f, bool needAuth = false);
     void SetPreRouteFunc(const RouteHttp::RouteFunc &callback);
     void SetPostRouteFunc(const RouteHttp::RouteFunc &callback);
     using AuthHandler = std::function<bool(const Request &request, IAuth *authMethod)>;
     void SetAuthHandler(const AuthHandler &f);
 
     bool SendResponse(Response &response);
+    ThreadPool::Metrics GetWorkerMetrics() const;
 
     std::string ToString() const;
 
@@ -76,6 +81,7 @@ protected:
     void OnConnected(int connID, const std::string& remote);
     void OnDataReady(int connID, ByteArray &data);
     void OnClosed(int connID);
+    void OnHeaderReceived(const std::shared_ptr<Session> &session, Request &request);
 
     bool StartRequestThread();
     bool StopRequestThread();
@@ -84,24 +90,35 @@ protected:
     void SendSignal();
     void WaitForSignal();
     void PutToQueue(int connID, const std::string &remote);
-    void AppendData(int connID, const ByteArray &data);
+    void AppendData(int connID, ByteArray &data);
     bool IsQueueEmpty();
-    bool CheckDataFullness();
-    std::unique_ptr<Request> GetNextRequest();
+    std::vector<std::unique_ptr<Request>> GetNextRequests(std::shared_ptr<Session> &session);
+    void DispatchRequests(std::vector<std::unique_ptr<Request>> requests, const std::shared_ptr<Session> &session);
+    void FinishRequest(const std::shared_ptr<Session> &session);
+    bool IsSessionOpened(const std::shared_ptr<Session> &session);
+    void UpdatePause(int connID);
     void RemoveFromQueue(int connID);
 
-    void ProcessRequest(Request &request);
-    void ProcessKeepAlive(int connID);    
+    void ProcessRequest(Request &request, Response &response);
+    bool CheckAuth(Request &request);
+    bool IsAuthorized(Request &request, int &authorized);
+    void SendResponses(int connID, const std::vector<std::unique_ptr<Response>> &responses);
+    void UpdateReceiveTimers(int connID, SessionManager::ReceiveState state);
+    void ProcessTimeout(int connID, TimerWheel::Type type);
 
 private:
     std::shared_ptr<ICommunicationServer> m_server = nullptr;
     Http::Protocol m_protocol = Http::Protocol::Undefined;
     SessionManager m_sessions;
     ThreadWorker m_requestThread;
+    ThreadPool m_workers;
+    TimerWheel m_timers;
     Mutex m_queueMutex;
     Mutex m_signalMutex;
     Signal m_signalCondition;
     std::vector<RouteHttp> m_routes;
+    RouteTree m_routeTree; // the routes compiled for the lookup, by their index in m_routes
+    RouteTree m_streamRouteTree; // only the ones with a body function
     HttpConfig &m_config;
     RouteHttp::RouteFunc m_preRoute = nullptr;
     RouteHttp::RouteFunc m_postRoute = nullptr;
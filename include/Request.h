@@ -30,6 +30,8 @@
 #include "common_webcpp.h"
 #include "HttpConfig.h"
 #include "RequestBody.h"
+#include "BodyStream.h"
+#include "ChunkedDecoder.h"
 #include "HttpHeader.h"
 #include "ICommunicationClient.h"
 #include "Url.h"
@@ -45,6 +47,14 @@ class Session;
 class Request: public IErrorable
 {
 public:
+    enum class ParseResult
+    {
+        NeedMore = 0,
+        Header,     // the header is complete, the body follows
+        Complete,
+        Error,
+    };
+
     Request();
     Request(int connID, const std::string &remote);
     Request(const Request& other) = delete;
@@ -53,6 +63,7 @@ public:
     Request& operator=(Request&& other) = default;
 
     bool Parse(const ByteArray &data);
+    ParseResult Parse(const ByteArray &data, size_t &consumed);
     int GetConnectionID() const;
     void SetConnectionID(int connID);
     const HttpConfig& GetConfig() const;
@@ -66,12 +77,15 @@ public:
     std::string GetHttpVersion() const;
     const RequestBody& GetRequestBody() const;
     RequestBody& GetRequestBody();
+    void SetBodyStream(const std::shared_ptr<BodyStream> &stream);
+    const std::shared_ptr<BodyStream>& GetBodyStream() const;
     std::string GetArg(const std::string &name) const;
     void SetArg(const std::string &name, const std::string &value);
     bool IsKeepAlive() const;
     Http::Protocol GetProtocol() const;
     size_t GetRequestLineLength() const;
     size_t GetRequestSize() const;
+    uint16_t GetParseError() const;
     std::string GetRemote() const;
     void SetRemote(const std::string &remote);
     bool Send(const std::shared_ptr<ICommunicationClient> &communication);
@@ -82,8 +96,21 @@ public:
     std::string ToString() const;
 
 protected:
-    bool ParseRequestLine(const ByteArray &data, size_t &pos);
-    bool ParseBody(const ByteArray &data, size_t headerSize);
+    enum class ParseState
+    {
+        RequestLine = 0,
+        Header,
+        BodyBegin,
+        Body,
+        Complete,
+        Error,
+    };
+
+    bool ParseRequestLine(const ByteArray &data, size_t start, size_t end);
+    bool BeginBody();
+    bool ParseBody(const ByteArray &data, size_t offset, size_t size);
+    bool PassBody(const ByteArray &data, size_t offset, size_t size);
+    bool IsChunked() const;
     ByteArray BuildRequestLine() const;
     ByteArray BuildHeaders() const;
 
@@ -94,8 +121,19 @@ private:
     Http::Method m_method = Http::Method::Undefined;
     std::string m_httpVersion = "HTTP/1.1";
     size_t m_requestLineLength = 0;
+    ParseState m_parseState = ParseState::RequestLine;
+    uint16_t m_parseError = 400; // the status a request that failed to parse is answered with
+    size_t m_parsePos = 0;    // the data before it was already scanned
+    size_t m_lineStart = 0;   // the start of the current line
+    size_t m_headerStart = 0;
+    size_t m_bodyOffset = 0;
+    size_t m_bodyReceived = 0; // the body bytes passed to the parser
+    size_t m_released = 0;     // the bytes reported as consumed before the request was complete
+    bool m_chunked = false;    // Transfer-Encoding: chunked, the body size isn't known in advance
+    ChunkedDecoder m_chunkedDecoder;
     std::map<std::string, std::string> m_args;
     RequestBody m_requestBody;
+    std::shared_ptr<BodyStream> m_bodyStream; // the body goes to a streaming handler instead
     std::string m_remote;
     Session *m_session = nullptr;
 };
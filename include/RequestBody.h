@@ -29,6 +29,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <memory>
 #include "IErrorable.h"
 
 
@@ -55,7 +56,10 @@ public:
     RequestBody(RequestBody&& other);
     RequestBody& operator=(RequestBody&& other);
 
-    bool Parse(const ByteArray &data, size_t offset, const ByteArray &contentType, bool useTempFile);
+    bool Parse(const ByteArray &data, size_t offset, size_t size, const ByteArray &contentType, bool useTempFile);
+    bool BeginParse(const ByteArray &contentType, bool useTempFile, size_t maxFileSize = SIZE_MAX, size_t maxValueSize = SIZE_MAX);
+    bool ParseChunk(const ByteArray &data, size_t offset, size_t size);
+    bool EndParse();
 
     ContentType GetContentType() const;
     void SetContentType(ContentType type);
@@ -86,9 +90,11 @@ protected:
     std::string GetHeader(const std::string &name, const std::map<std::string, std::string> &map) const;
     ContentType ParseContentType(const ByteArray &contentType) const;
 
-    bool ParseFormData(const ByteArray &data, size_t offset, const ByteArray &contentType, bool useTempFile);
-    bool ParseUrlEncoded(const ByteArray &data, size_t offset, const ByteArray &contentType);
-    bool ParseText(const ByteArray &data, size_t offset, const ByteArray &contentType);
+    bool ParseFormData(const ByteArray &data, size_t &pos, size_t end);
+    bool BeginPart(const ByteArray &data, size_t start, size_t end);
+    bool WritePart(const ByteArray &data, size_t start, size_t end);
+    void EndPart();
+    bool ParseUrlEncoded(const ByteArray &data, size_t offset, size_t size, const ByteArray &contentType);
 
     ByteArray GetDataUrlUncoded() const;
     ByteArray GetDataMultipart();
@@ -96,10 +102,13 @@ protected:
     void CreateBoundary();
 
 private:
+    struct ParseContext;
+
     std::vector<ContentValue> m_values;
     ContentType m_contentType = ContentType::Undefined;
     std::string m_tempFolder;
     std::string m_boundary;
+    std::unique_ptr<ParseContext> m_context; // the state of the body being parsed
 };
 
 }
@@ -27,17 +27,29 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <sys/uio.h>
 #include "ICommunicationServer.h"
 #include "common_webcpp.h"
 #include "HttpConfig.h"
 #include "HttpHeader.h"
 #include "IErrorable.h"
+#include "ChunkedDecoder.h"
+#include "Compressor.h"
+#include "Decompressor.h"
+#include "FileCache.h"
+
+#define MAX_RANGE_COUNT 16 // a request for more ranges gets the whole file
+#define RANGE_BOUNDARY_LENGTH 24
 
 
 namespace WebCpp
 {
 
 class Session;
+class Request;
 class Response: public IErrorable
 {
 public:
@@ -46,6 +58,14 @@ public:
         Undefined = 0,
 
     };
+    enum class ParseResult
+    {
+        NeedMore = 0,
+        Header,     // the header is complete, the body follows
+        Complete,
+        Error,
+    };
+    using BodyFunc = std::function<bool(const Response&, const ByteArray &data, size_t offset, size_t size)>;
 
     Response(int connID, const HttpConfig& config);
     Response(const Response& other) = delete;
@@ -74,10 +94,30 @@ public:
     bool IsShouldSend() const;
     void SetShouldSend(bool value);
     bool Send(ICommunicationServer *communication);
+    bool HasFile() const;
+    void AppendBuffers(std::vector<struct iovec> &buffers);
+    bool SendFile(ICommunicationServer *communication);
     bool Parse(const ByteArray &data, size_t *all = nullptr, size_t *downoaded = nullptr);
+    ParseResult Parse(const ByteArray &data, size_t &consumed);
+    ParseResult Finish();
+    void SetBodyFunction(const BodyFunc &f);
+    size_t GetBodyReceived() const;
+#ifdef WITH_ZLIB
+    void SetDecompressor(Decompressor *decompressor);
+#endif
+
+    /* a route function can send the body by pieces (Transfer-Encoding: chunked)
+     * instead of collecting it, the header goes out with the first chunk */
+    void SetStream(ICommunicationServer *communication, const std::function<void()> &flush);
+    bool WriteChunk(const ByteArray &data, size_t start = 0);
+    bool WriteChunk(const std::string &data);
+    bool End();
+    bool IsStreaming() const;
 
     void SetSession(Session *session);
     Session* GetSession() const;
+    void SetAcceptEncoding(const std::string &value);
+    void SetRequest(const Request &request);
 
     static std::string HeaderType2String(Response::HeaderType headerType);
     static Response::HeaderType String2HeaderType(const std::string &str);
@@ -95,12 +135,51 @@ protected:
         Brotli,
     };
 
+    enum class ParseState
+    {
+        StatusLine = 0,
+        Header,
+        Body,
+        Complete,
+        Error,
+    };
+
+    enum class RangeResult
+    {
+        Ignored = 0,    // no or invalid Range, the whole file is sent
+        Partial,
+        Unsatisfiable,
+    };
+
+    struct Range
+    {
+        size_t offset;
+        size_t size;
+        size_t header;      // the part header of multipart/byteranges in m_rangeData
+        size_t headerSize;
+    };
+
     void InitDefault();
-    ByteArray BuildStatusLine() const;
-    ByteArray BuildHeaders() const;    
-    bool ParseStatusLine(const ByteArray &data, size_t &pos);
-    bool DecodeBody(EncodingType type, const ByteArray &data, size_t pos);
+    void AppendStatusLine(ByteArray &buffer) const;
+    bool ParseStatusLine(const ByteArray &data, size_t start, size_t end);
+    void BeginBody();
+    bool PassBody(const ByteArray &data, size_t offset, size_t size);
+    bool StoreBody(const ByteArray &data, size_t offset, size_t size);
+    bool EndBody();
+    bool IsCompressible() const;
+    bool IsCompressionNegotiable() const;
+    bool IsNotModified(const std::string &etag, int64_t modified) const;
+    bool IsRangeAllowed(const std::string &etag, const std::string &lastModified) const;
+    RangeResult ParseRange(const std::string &value, size_t size);
+    size_t PrepareRanges(size_t size, const std::string &contentType);
+    void CompressBody();
+    bool BeginStream();
+    bool SendChunk(const uint8_t *data, size_t size, bool withHeader);
+    bool WaitForRoom();
+    static bool String2Position(const std::string &str, uint64_t &value);
     static EncodingType String2EncodingType(const std::string &str);
+    static EncodingType NegotiateEncoding(const std::string &value);
+    static std::string EncodingType2String(EncodingType type);
 
 private:
     int m_connID;
@@ -108,11 +187,46 @@ private:
     std::string m_version;
     HttpHeader m_header;
     ByteArray m_body;
+    ByteArray m_headerData; // the status line and the headers while the response is sent
     uint16_t m_responseCode = 200;
     std::string m_responsePhrase = "";
     std::string m_mimeType = "";   
     std::string  m_file;
+    size_t m_fileSize = 0;
+    std::shared_ptr<const FileCache::Entry> m_cachedFile; // the content is sent from the memory
+    std::vector<Range> m_ranges; // the parts of the file that are sent, empty - the whole one
+    ByteArray m_rangeData;       // the part headers and the closing delimiter of multipart/byteranges
     bool m_shouldSend = true;
+    ICommunicationServer *m_communication = nullptr;
+    std::function<void()> m_flush;  // sends the responses queued before this one
+    bool m_streaming = false;
+    EncodingType m_encoding = EncodingType::Undefined; // the preferred one the client accepts
+    bool m_conditional = false; // GET or HEAD, a file the client has is answered with 304
+    std::string m_ifNoneMatch;
+    std::string m_ifModifiedSince;
+    std::string m_range;
+    std::string m_ifRange;
+#ifdef WITH_ZLIB
+    std::unique_ptr<Compressor> m_compressor; // a streamed body is compressed by chunks
+    ByteArray m_chunkData;
+#endif
+    ParseState m_parseState = ParseState::StatusLine;
+    size_t m_parsePos = 0;     // the data before it was already scanned
+    size_t m_lineStart = 0;
+    size_t m_headerStart = 0;
+    size_t m_bodyOffset = 0;
+    size_t m_bodySize = 0;     // Content-Length
+    size_t m_bodyReceived = 0; // the body bytes passed on, as they were on the wire
+    size_t m_released = 0;     // the bytes reported as consumed
+    bool m_chunked = false;
+    bool m_untilClose = false; // neither Content-Length nor chunked, the body ends with the connection
+    ChunkedDecoder m_chunkedDecoder;
+    BodyFunc m_bodyFunc;       // the body is passed on instead of being collected
+#ifdef WITH_ZLIB
+    Decompressor *m_decompressor = nullptr; // a gzip/deflate body is decoded as it arrives
+    std::unique_ptr<Decompressor> m_ownDecompressor;
+    bool m_decoding = false;
+#endif
     Session *m_session = nullptr;
 };
 
@@ -38,6 +38,8 @@ namespace WebCpp
 
 class Route
 {
+    friend class RouteTree; // compiles the tokens
+
 public:
     Route(const std::string &path, Http::Method method, bool useAuth = false);
     Route(const Route& other) = delete;
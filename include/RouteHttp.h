@@ -28,6 +28,7 @@
 #include "Route.h"
 #include "Request.h"
 #include "Response.h"
+#include "BodyStream.h"
 
 
 namespace WebCpp
@@ -37,14 +38,18 @@ class RouteHttp: public Route
 {
 public:
     using RouteFunc = std::function<bool(const Request&request, Response &response)>;
+    using BodyFunc = BodyStream::BodyFunc;
 
     RouteHttp(const std::string &path, Http::Method method, bool useAuth = false);
 
     bool SetFunction(const RouteFunc& f);
     const RouteFunc& GetFunction() const;
+    bool SetBodyFunction(const BodyFunc& f);
+    const BodyFunc& GetBodyFunction() const;
 
 private:
     RouteFunc m_func;
+    BodyFunc m_bodyFunc = nullptr; // the body is streamed to it instead of being parsed
 };
 
 }
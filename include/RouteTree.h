@@ -0,0 +1,125 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifndef WEBCPP_ROUTE_TREE_H
+#define WEBCPP_ROUTE_TREE_H
+
+#include <bitset>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Route.h"
+#include "Request.h"
+#include "IHttp.h"
+
+#define MAX_ROUTE_VARIANTS 64 // a pattern with more optional parts and groups is checked with Route::IsMatch()
+
+
+namespace WebCpp
+{
+
+/* the routes compiled into a radix tree, one per method. The static parts of the patterns
+ * are the edges compressed into strings, a {variable} is an edge that takes the longest run
+ * of the characters of its type, the optional parts and the groups are added as several
+ * variants of the pattern. Looking a path up costs O(path length) instead of matching
+ * every route. A pattern with '*' is compiled up to it and checked with Route::IsMatch().
+ * Route::IsMatch() doesn't go back to try another group alternative or to skip an optional
+ * part that matched, the tree does, so a pattern with them is confirmed with Route::IsMatch() too.
+ * The matches are returned in the order the routes were added */
+class RouteTree
+{
+public:
+    struct Arg
+    {
+        const std::string *name;
+        size_t offset;  // in the path
+        size_t size;
+    };
+    struct Match
+    {
+        size_t index;   // of the route, as it was added
+        size_t variant; // the preferred one of a route has the lowest number
+        bool verify;    // the route must be checked with Route::IsMatch()
+        std::vector<Arg> args;
+    };
+
+    RouteTree() = default;
+    RouteTree(const RouteTree& other) = delete;
+    RouteTree& operator=(const RouteTree& other) = delete;
+
+    void Add(size_t index, const Route &route);
+    void Find(Http::Method method, const std::string &path, std::vector<Match> &matches) const;
+    static void SetArgs(const Match &match, const std::string &path, Request &request);
+    void Clear();
+
+protected:
+    struct Node;
+    struct Leaf
+    {
+        size_t index;
+        size_t variant;
+        bool verify;    // the tree may find a variant Route::IsMatch() doesn't try
+    };
+    struct Param
+    {
+        Route::Token::View view;
+        std::string name;
+        std::bitset<256> chars;
+        std::unique_ptr<Node> node;
+    };
+    struct Node
+    {
+        std::string text;   // the static part of the edge leading here
+        std::map<char, std::unique_ptr<Node>> children; // by the first character of their text
+        std::vector<Param> params;
+        std::vector<Leaf> routes;       // the patterns that end here
+        std::vector<Leaf> wildcards;    // the patterns that continue with '*'
+    };
+    struct Part
+    {
+        enum class Type
+        {
+            Text = 0,
+            Param,
+            Any,
+        };
+        Type type;
+        std::string text;
+        Route::Token::View view;
+    };
+
+    void Expand(const std::vector<Route::Token> &tokens, size_t i, std::vector<Part> &current, std::vector<std::vector<Part>> &variants) const;
+    void Insert(Node *node, const std::vector<Part> &parts, const Leaf &leaf);
+    Node* InsertText(Node *node, const std::string &text);
+    Node* InsertParam(Node *node, const Part &part);
+    void Search(const Node &node, const std::string &path, size_t pos, std::vector<Arg> &args, std::vector<Match> &matches) const;
+
+private:
+    std::map<Http::Method, std::unique_ptr<Node>> m_roots;
+};
+
+}
+
+#endif // WEBCPP_ROUTE_TREE_H
@@ -1,8 +1,11 @@
 #ifndef SESSION_H
 #define SESSION_H
 
+#include <deque>
+#include <memory>
 #include "common_webcpp.h"
 #include "AuthProvider.h"
+#include "Mutex.h"
 
 
 namespace WebCpp
@@ -13,11 +16,19 @@ struct Session
 public:
     Session(int connID, const std::string &remote);
 
+    int connID;
     ByteArray data;
-    std::unique_ptr<Request> request;
-    bool readyForDispatch;
+    std::unique_ptr<Request> request; // the request being received
+    std::deque<std::unique_ptr<Request>> ready; // received requests in the order they came
+    bool busy; // a request is being processed, the next one waits to keep the order
+    bool queued; // the session is in the ready queue
+    bool closed; // the connection is closed, the requests are kept while a task uses them
+    bool paused; // reading is paused while the pipeline is full
+    bool failed; // a request failed to parse, it's answered with an error and the connection is closed
     std::string remote;
     AuthProvider authProvider;
+    Mutex pauseMutex; // guards closed for a stream pausing the connection, the ID is reused once it is closed
+    Mutex authMutex; // the auth provider is used by one request at a time, a stream checks it on another worker
 };
 
 }
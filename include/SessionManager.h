@@ -2,6 +2,9 @@
 #define SESSIONMANAGER_H
 
 #include <map>
+#include <functional>
+#include <deque>
+#include <vector>
 #include <memory>
 #include "common_webcpp.h"
 #include "IErrorable.h"
@@ -9,6 +12,8 @@
 #include "AuthProvider.h"
 #include "Session.h"
 
+#define MAX_PIPELINED_REQUESTS 32
+
 
 namespace WebCpp
 {
@@ -16,17 +21,36 @@ namespace WebCpp
 class SessionManager : public IErrorable
 {
 public:
+    enum class ReceiveState
+    {
+        Idle = 0,   // nothing is being received or processed
+        Header,     // a part of the request header is received
+        Body,       // the header is received, the body isn't complete
+        Processing, // the received requests are processed
+    };
+
+    using HeaderCallback = std::function<void(const std::shared_ptr<Session> &session, Request &request)>;
+
     SessionManager();
+    void SetHeaderCallback(const HeaderCallback &callback);
     bool AddNewSession(int connID, const std::string &remote);
-    bool AppendData(int connID, const ByteArray &data);
-    bool Process();
-    std::unique_ptr<Request> GetReadyRequest();
+    bool AppendData(int connID, ByteArray &data);
+    ReceiveState GetReceiveState(int connID) const;
+    bool UpdatePause(int connID, bool &pause);
+    bool HasReadyRequests() const;
+    std::vector<std::unique_ptr<Request>> GetReadyRequests(std::shared_ptr<Session> &session);
+    std::shared_ptr<Session> GetSession(int connID) const;
+    bool ReleaseSession(const Session *session);
     bool RemoveSession(int connID);
     bool IsEmpty() const;
 private:
+    void Parse(const std::shared_ptr<Session> &session);
+    void PushReady(const std::shared_ptr<Session> &session);
 
+    std::map<int, std::shared_ptr<Session>> m_sesions;
+    std::deque<std::shared_ptr<Session>> m_readyQueue; // sessions with a request to dispatch, FIFO
+    HeaderCallback m_headerCallback = nullptr;
 
-    std::map<int, Session> m_sesions;
 };
 
 }
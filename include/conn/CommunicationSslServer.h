@@ -35,9 +35,6 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
-#define MAX_CLIENTS 10
-#define READ_BUFFER_SIZE 1024
-
 
 namespace WebCpp
 {
@@ -49,6 +46,13 @@ public:
 
     bool Init() override final;
     bool Connect(const std::string &address = "", int port = 0) override final;
+
+protected:
+    void InitSockets(SocketPool &sockets) override;
+
+private:
+    std::string m_cert;
+    std::string m_key;
 };
 
 }
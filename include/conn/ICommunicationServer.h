@@ -26,15 +26,26 @@
 #define WEBCPP_ICOMMUNICATION_SERVER_H
 
 #include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <map>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include "ICommunication.h"
 #include "common_webcpp.h"
 #include "SocketPool.h"
 #include "ThreadWorker.h"
 #include "Mutex.h"
+#include "Signal.h"
 
-#define MAX_CLIENTS 10
-#define QUEUE_SIZE 10
-#define READ_BUFFER_SIZE 1024
+#define DEFAULT_MAX_CLIENTS 1024
+#define DEFAULT_REACTOR_COUNT 1
+#define READ_CHUNK_SIZE 16384 // min. free room in the receive buffer before a read
+#define MAX_READ_SIZE 1048576 // data is handed over when the receive buffer reaches that size
+#define WRITE_FILE_CHUNK_SIZE 16384 // a file is read by such chunks when sendfile() can't be used
+#define DEFAULT_WRITE_HIGH_WATERMARK 1048576 // queued bytes that pause reading from the client
+#define DEFAULT_WRITE_LOW_WATERMARK 262144 // queued bytes that resume it
 
 
 namespace WebCpp
@@ -53,8 +64,25 @@ public:
     std::string GetHost() const override;
 
     virtual bool CloseConnection(int connID);
+    bool CloseAfterWrite(int connID);
     virtual bool Write(int connID, ByteArray &data);
     virtual bool Write(int connID, ByteArray &data, size_t size);
+    virtual bool Write(int connID, const std::vector<struct iovec> &buffers);
+    virtual bool WriteFile(int connID, const std::string &path, size_t offset, size_t size);
+    bool IsWritePending(int connID) const;
+    size_t GetWriteQueueSize(int connID) const;
+    size_t GetWriteProgress(int connID) const;
+    bool WaitForRoom(int connID, uint32_t timeout);
+    void SetWriteWatermarks(size_t high, size_t low);
+    bool PauseReading(int connID, bool pause);
+    void SetMaxConnections(size_t count);
+    size_t GetMaxConnections() const;
+    size_t GetConnectionsCount() const;
+    void SetPollMode(SocketPool::PollMode mode);
+    SocketPool::PollMode GetPollMode() const;
+    void SetReactorCount(size_t count);
+    size_t GetReactorCount() const;
+
     virtual bool Init() override;
     virtual bool Connect(const std::string &host = "", int port = 0) override;
     bool Close(bool wait = true) override;
@@ -66,13 +94,79 @@ public:
     virtual bool SetCloseConnectionCallback(const std::function<void(int)> &callback) { m_closeConnectionCallback = callback; return true; };
 
 protected:
+    /* writing never blocks, the data a socket didn't take is queued and sent
+     * by the reactor when the socket becomes writable, a file range is sent
+     * with sendfile() or read by chunks for SSL. Reading from the client is
+     * paused while more than the high watermark is queued for it */
+    struct WriteItem
+    {
+        WriteItem() = default;
+        WriteItem(WriteItem &&other) noexcept;
+        WriteItem& operator=(WriteItem &&other) noexcept;
+        WriteItem(const WriteItem &other) = delete;
+        WriteItem& operator=(const WriteItem &other) = delete;
+        ~WriteItem();
+
+        ByteArray data;
+        size_t position = 0;    // in the data
+        int file = (-1);
+        off_t offset = 0;       // in the file
+        size_t size = 0;        // bytes left
+    };
+    struct Outbound
+    {
+        Mutex mutex;
+        std::deque<WriteItem> items;
+        size_t size = 0;        // queued bytes
+        size_t progress = 0;    // bytes sent from the queue since the last check
+        bool paused = false;    // reading is paused by the high watermark
+        size_t stopped = 0;     // reading is paused by the consumers of the data, each resumes its own pause
+        bool closing = false;   // the connection is closed when the queue is sent
+        bool closed = false;
+        Signal room;            // the queue went down to the low watermark or the connection is closed
+    };
+
+    /* every reactor is an event loop with its own listening socket (SO_REUSEPORT),
+     * socket pool and receive buffer, the kernel balances new connections between them */
+    struct Reactor
+    {
+        Reactor(size_t id, size_t maxCount, SocketPool::Domain domain, SocketPool::Type type, SocketPool::Options options);
+        size_t id;
+        SocketPool sockets;
+        ThreadWorker thread;
+        ByteArray readBuffer;
+        mutable Mutex outboundMutex;
+        std::map<size_t, std::shared_ptr<Outbound>> outbound;
+        Mutex exitMutex;
+        Signal exit;
+        bool exited = false;    // the read thread has returned, Close() waits for it
+    };
+
+    virtual void InitSockets(SocketPool &sockets);
     virtual void CloseConnections();
-    SocketPool m_sockets;
-    Mutex m_writeMutex;
+    int ToConnID(const Reactor &reactor, size_t index) const;
+    Reactor* FromConnID(int connID, size_t &index) const;
+
+    void* ReadThread(Reactor *reactor, bool &running);
+    void AcceptConnections(Reactor &reactor);
+    void ReadConnection(Reactor &reactor, size_t index);
+    void WriteConnection(Reactor &reactor, size_t index);
+    std::shared_ptr<Outbound> GetOutbound(Reactor &reactor, size_t index, bool create) const;
+    bool IsReadPaused(Reactor &reactor, size_t index) const;
+    size_t SendItem(SocketPool &sockets, size_t index, WriteItem &item);
+    void Enqueue(Reactor &reactor, size_t index, Outbound &outbound, WriteItem &&item);
 
-    void* ReadThread(bool &running);
-    ThreadWorker m_readThread;
-    char m_readBuffer[READ_BUFFER_SIZE];
+    SocketPool::Domain m_domain;
+    SocketPool::Type m_type;
+    SocketPool::Options m_options;
+    std::string m_host;
+    int m_port = 0;
+    size_t m_maxConnections = DEFAULT_MAX_CLIENTS;
+    size_t m_reactorCount = DEFAULT_REACTOR_COUNT;
+    SocketPool::PollMode m_pollMode = SocketPool::PollMode::EpollEdge;
+    size_t m_writeHighWatermark = DEFAULT_WRITE_HIGH_WATERMARK;
+    size_t m_writeLowWatermark = DEFAULT_WRITE_LOW_WATERMARK;
+    std::vector<std::unique_ptr<Reactor>> m_reactors;
 
     std::function<void(int, const std::string&)> m_newConnectionCallback = nullptr;
     std::function<void(int, ByteArray &data)> m_dataReadyCallback = nullptr;
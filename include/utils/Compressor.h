@@ -0,0 +1,72 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifdef WITH_ZLIB
+#ifndef WEBCPP_COMPRESSOR_H
+#define WEBCPP_COMPRESSOR_H
+
+#include "zlib.h"
+#include "common_webcpp.h"
+#include "IErrorable.h"
+
+#define COMPRESSOR_CHUNK_SIZE 16384 // the output grows by such steps
+
+
+namespace WebCpp
+{
+
+/* streaming deflate/gzip encoder, the input can be passed by pieces,
+ * the output is appended to the buffer passed by the caller */
+class Compressor: public IErrorable
+{
+public:
+    enum class Format
+    {
+        Deflate = 0,    // zlib (RFC 1950), that's "deflate" in HTTP
+        Gzip,
+    };
+
+    Compressor() = default;
+    ~Compressor();
+    Compressor(const Compressor& other) = delete;
+    Compressor& operator=(const Compressor& other) = delete;
+
+    bool Init(Format format, int level = Z_DEFAULT_COMPRESSION);
+    bool Compress(const uint8_t *data, size_t size, ByteArray &output, bool flush = false);
+    bool Finish(ByteArray &output);
+    bool Reset();
+    bool IsInitialized() const;
+
+protected:
+    bool Deflate(const uint8_t *data, size_t size, ByteArray &output, int flush);
+
+private:
+    z_stream m_stream;
+    bool m_initialized = false;
+};
+
+}
+
+#endif // WEBCPP_COMPRESSOR_H
+#endif // WITH_ZLIB
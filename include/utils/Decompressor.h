@@ -0,0 +1,80 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifdef WITH_ZLIB
+#ifndef WEBCPP_DECOMPRESSOR_H
+#define WEBCPP_DECOMPRESSOR_H
+
+#include <functional>
+#include "zlib.h"
+#include "common_webcpp.h"
+#include "IErrorable.h"
+
+#define DECOMPRESSOR_CHUNK_SIZE 16384 // the decoded data is passed on by such pieces
+
+
+namespace WebCpp
+{
+
+/* streaming gzip/deflate decoder, the input can be passed by pieces as it's
+ * received, the decoded data goes to the function from an internal buffer.
+ * The stream is allocated once and reset for the next body */
+class Decompressor: public IErrorable
+{
+public:
+    enum class Format
+    {
+        Deflate = 0,    // zlib wrapped or raw, that's detected by the first bytes
+        Gzip,
+    };
+    using DataFunc = std::function<bool(const ByteArray &data, size_t offset, size_t size)>;
+
+    Decompressor() = default;
+    ~Decompressor();
+    Decompressor(const Decompressor& other) = delete;
+    Decompressor& operator=(const Decompressor& other) = delete;
+
+    bool Init(Format format);
+    bool Decompress(const uint8_t *data, size_t size, const DataFunc &f);
+    bool IsFinished() const;
+
+protected:
+    bool Start(int windowBits);
+    bool Inflate(const uint8_t *data, size_t size, const DataFunc &f);
+
+private:
+    z_stream m_stream;
+    bool m_allocated = false;
+    int m_windowBits = 0;   // of the allocated stream
+    bool m_started = false; // the stream is ready for this body
+    bool m_finished = false;
+    Format m_format = Format::Gzip;
+    ByteArray m_buffer;
+    ByteArray m_header;     // the first byte of a deflate body while the second one is awaited
+};
+
+}
+
+#endif // WEBCPP_DECOMPRESSOR_H
+#endif // WITH_ZLIB
@@ -27,6 +27,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 
 namespace WebCpp
@@ -43,6 +44,7 @@ public:
     static std::string ExtractFileExtension(const std::string &path);
     static bool IsFileExist(const std::string &path);
     static int GetFileSize(const std::string &path);
+    static bool GetFileStat(const std::string &path, size_t &size, int64_t &modified);
     static char PathDelimiter();
     static bool CreateFolder(const std::string &path);
     static bool DeleteFolder(const std::string &path);
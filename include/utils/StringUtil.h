@@ -44,6 +44,7 @@ public:
     static Ranges Split(const ByteArray &str, const ByteArray &delimiter, size_t start = 0, size_t end = SIZE_MAX);
     static size_t SearchPositionReverse(const ByteArray &str, const ByteArray &substring, size_t start = 0, size_t end = SIZE_MAX);
     static Ranges SplitReverse(const ByteArray &str, const ByteArray &delimiter, size_t start = 0, size_t end = SIZE_MAX);
+    static void ScanBlock(const ByteArray &str, size_t pos, size_t end, uint64_t &lf, uint64_t &colon);
     static ByteArray Trim(ByteArray &str, const ByteArray &chars = { '\r','\n','\t' });
     static bool Contains(const ByteArray &str, char ch);
     static std::vector<std::string> Split(const std::string &str, const char delimiter);
@@ -0,0 +1,105 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifndef WEBCPP_THREAD_POOL_H
+#define WEBCPP_THREAD_POOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <inttypes.h>
+#include "IErrorable.h"
+#include "ThreadWorker.h"
+#include "Mutex.h"
+#include "Signal.h"
+
+#define DEFAULT_POOL_SIZE 4
+
+
+namespace WebCpp
+{
+
+class ThreadPool: public IErrorable
+{
+public:
+    using Task = std::function<void()>;
+    struct Metrics
+    {
+        size_t threads = 0;
+        size_t queueDepth = 0;      // tasks waiting for a worker
+        size_t processed = 0;       // tasks finished
+        size_t stolen = 0;          // tasks taken from another worker's queue
+        uint64_t averageLatency = 0; // task run time, usec.
+        uint64_t maxLatency = 0;     // usec.
+    };
+
+    explicit ThreadPool(size_t count = DEFAULT_POOL_SIZE);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) = delete;
+    ThreadPool& operator=(ThreadPool&& other) = delete;
+
+    void SetThreadCount(size_t count);
+    size_t GetThreadCount() const;
+    bool Start();
+    void Stop();
+    bool IsRunning() const;
+    bool Post(size_t key, const Task &task);
+    Metrics GetMetrics() const;
+
+protected:
+    /* every worker has its own queue, the idle one steals
+     * from the tail of the others */
+    struct Worker
+    {
+        ThreadWorker thread;
+        std::deque<Task> tasks;
+        Mutex mutex;
+    };
+
+    void* WorkerThread(size_t id, bool &running);
+    bool PopTask(size_t id, Task &task);
+    bool StealTask(size_t id, Task &task);
+    void UpdateLatency(uint64_t latency);
+    static uint64_t Now();
+
+private:
+    size_t m_count;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool> m_running;
+    std::atomic<size_t> m_pending;
+    std::atomic<size_t> m_processed;
+    std::atomic<size_t> m_stolen;
+    std::atomic<uint64_t> m_totalLatency;
+    std::atomic<uint64_t> m_maxLatency;
+    Mutex m_signalMutex;
+    Signal m_signal;
+};
+
+}
+
+#endif // WEBCPP_THREAD_POOL_H
@@ -0,0 +1,126 @@
+/*
+*
+* Copyright (c) 2021 ruslan@muhlinin.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*/
+
+#ifndef WEBCPP_TIMER_WHEEL_H
+#define WEBCPP_TIMER_WHEEL_H
+
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <inttypes.h>
+#include "IErrorable.h"
+#include "ThreadWorker.h"
+#include "Mutex.h"
+#include "Signal.h"
+
+#define DEFAULT_TIMER_TICK 100 // msec.
+#define DEFAULT_TIMER_SLOTS 512
+#define DEFAULT_TIMER_SHARDS 16
+
+
+namespace WebCpp
+{
+
+/* hashed timing wheel, a timer is a node of the slot's list it expires in,
+ * so setting, refreshing and cancelling a timer is O(1). The timers are spread
+ * over the shards by the connection ID, every shard has its own lock
+ * and only the timers of the current slot are visited on a tick */
+class TimerWheel: public IErrorable
+{
+public:
+    enum class Type
+    {
+        KeepAlive = 0,  // idle connection between the requests
+        Header,         // the whole request header must arrive in time
+        Read,           // pause between two reads of an incomplete request
+        Write,          // sending a response
+    };
+    using Callback = std::function<void(int connID, Type type)>;
+
+    explicit TimerWheel(uint32_t tick = DEFAULT_TIMER_TICK, size_t slots = DEFAULT_TIMER_SLOTS, size_t shards = DEFAULT_TIMER_SHARDS);
+    ~TimerWheel();
+    TimerWheel(const TimerWheel& other) = delete;
+    TimerWheel& operator=(const TimerWheel& other) = delete;
+    TimerWheel(TimerWheel&& other) = delete;
+    TimerWheel& operator=(TimerWheel&& other) = delete;
+
+    void SetCallback(const Callback &callback);
+    bool Start();
+    void Stop();
+    bool IsRunning() const;
+    void SetTimer(int connID, Type type, uint32_t delay, bool restart = true);
+    void CancelTimer(int connID, Type type);
+    void CancelTimers(int connID);
+    size_t GetCount() const;
+
+    static std::string Type2String(Type type);
+
+protected:
+    struct Timer
+    {
+        int connID;
+        Type type;
+        size_t slot;
+        size_t rounds;          // full turns of the wheel left
+        uint64_t generation;    // changes on every restart
+        Timer *prev = nullptr;
+        Timer *next = nullptr;
+    };
+    struct Shard
+    {
+        Mutex mutex;
+        size_t cursor = 0;
+        uint64_t generation = 0;
+        int firing = -1;        // the connection whose timer callback is being called
+        Signal fired;
+        std::vector<Timer *> slots;
+        std::unordered_map<uint64_t, std::unique_ptr<Timer>> timers;
+    };
+    struct Expired
+    {
+        uint64_t key;
+        uint64_t generation;
+    };
+
+    void *TimerThread(bool &running);
+    void Tick(Shard &shard, std::vector<Expired> &expired);
+    Shard &GetShard(int connID) const;
+    void Link(Shard &shard, Timer *timer, uint32_t delay);
+    void Unlink(Shard &shard, Timer *timer);
+    void Cancel(Shard &shard, int connID, Type type);
+    static uint64_t Key(int connID, Type type);
+    static uint64_t Now();
+
+private:
+    uint32_t m_tick;
+    size_t m_slotCount;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    Callback m_callback = nullptr;
+    ThreadWorker m_thread;
+};
+
+}
+
+#endif // WEBCPP_TIMER_WHEEL_H
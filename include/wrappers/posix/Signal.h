@@ -26,6 +26,7 @@
 #define WEBCPP_SIGNAL_H
 
 #include "pthread.h"
+#include <inttypes.h>
 #include "Mutex.h"
 
 
@@ -36,11 +37,16 @@ class Signal
 {
 public:
     Signal();
+    ~Signal();
+    Signal(const Signal& other) = delete;
+    Signal& operator=(const Signal& other) = delete;
     void Fire();
+    void FireAll();
     void Wait(Mutex &mutex);
+    bool Wait(Mutex &mutex, uint32_t timeout); // msec., false if it's timed out
 
 private:
-    pthread_cond_t m_signalCondition = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t m_signalCondition;
 };
 
 }
@@ -26,7 +26,12 @@
 #define WEBCPP_SOCKET_POOL_H
 
 #include <poll.h>
+#include <sys/uio.h>
 #include <stddef.h>
+#include <inttypes.h>
+#include <vector>
+#include <memory>
+#include <atomic>
 #ifdef WITH_OPENSSL
 #include <openssl/ssl.h>
 #include <openssl/err.h>
@@ -35,6 +40,8 @@
 #include "Mutex.h"
 
 #define POLL_TIMEOUT 500
+#define MAX_POLL_EVENTS 1024
+#define SLOT_CHUNK_SIZE 256
 #define DEFAULT_HOST "*"
 #define DEFAULT_PORT 80
 #define DEFAULT_SSL_HOST "*"
@@ -72,9 +79,17 @@ public:
         None = 0,
         ReuseAddr = 1,
         Ssl = 2,
+        ReusePort = 4,
+        NoDelay = 8, // TCP_NODELAY for the accepted connections
+    };
+    enum class PollMode
+    {
+        Poll = 0,   // poll() over all the slots
+        Epoll,      // epoll, level-triggered
+        EpollEdge,  // epoll, edge-triggered, the socket should be read until it returns 0
     };
 
-    SocketPool(size_t count, Service service, Domain domain, Type type, Options options = Options::None);
+    SocketPool(size_t maxCount, Service service, Domain domain, Type type, Options options = Options::None);
     ~SocketPool();
     SocketPool(const SocketPool& other) = delete;
     SocketPool& operator=(const SocketPool& other) = delete;
@@ -82,7 +97,8 @@ public:
     SocketPool& operator=(SocketPool&& other) = delete;
 
     int Create(bool main = false);
-    bool CloseSocket(size_t index);
+    bool CloseSocket(size_t index, bool release = true);
+    void ReleaseSlot(size_t index);
     bool CloseSockets();
     bool IsSocketValid(size_t index);
     bool Bind(const std::string &host, int port);
@@ -90,12 +106,22 @@ public:
     size_t Accept();
     bool Connect(const std::string &host, int port = 0);
     size_t Write(const uint8_t *buffer, size_t size, size_t index = 0);
+    size_t WriteNoWait(const uint8_t *buffer, size_t size, size_t index = 0);
+    size_t WriteNoWait(const struct iovec *buffers, size_t count, size_t index = 0);
+    size_t SendFile(int file, off_t &offset, size_t size, size_t index = 0);
     size_t Read(void *buffer, size_t size, size_t index = 0);
 
+    void SetPollMode(PollMode mode);
+    PollMode GetPollMode() const;
+    bool IsEdgeTriggered() const;
     void SetPollRead();
     void SetPollWrite();
     bool Poll();
+    size_t GetReadyCount() const;
+    size_t GetReadyIndex(size_t position) const;
     bool HasData(size_t index) const;
+    bool CanWrite(size_t index) const;
+    bool SetPollEvents(size_t index, bool read, bool write);
     bool IsPollError(size_t index) const;
 
     void SetPort(int port);
@@ -103,6 +129,9 @@ public:
     void SetHost(const std::string &host);
     std::string GetHost() const;
     size_t GetCount() const;
+    void SetMaxCount(size_t maxCount);
+    size_t GetMaxCount() const;
+    size_t GetActiveCount() const;
     int GetConnectTimeout() const;
     void SetConnectTimeout(int timeout);
     std::string GetRemoteAddress(size_t index) const;
@@ -115,12 +144,29 @@ public:
     static std::string Domain2String(SocketPool::Domain domain);
     static std::string Type2String(SocketPool::Type type);
     static std::string Service2String(SocketPool::Service service);
+    static std::string PollMode2String(SocketPool::PollMode mode);
 
 protected:
+    struct Slot
+    {
+        int fd = (-1);
+        short events = 0;
+        short revents = 0;
+#ifdef WITH_OPENSSL
+        SSL *ssl = nullptr;
+#endif
+    };
+
+    inline Slot& GetSlot(size_t index) { return m_slots[index / SLOT_CHUNK_SIZE][index % SLOT_CHUNK_SIZE]; }
+    inline const Slot& GetSlot(size_t index) const { return m_slots[index / SLOT_CHUNK_SIZE][index % SLOT_CHUNK_SIZE]; }
     int FindEmpty();
+    bool PollAdd(size_t index);
+    bool PollModify(size_t index, short events);
+    uint32_t PollEvents(short events) const;
     void ParseAddress(const std::string &address);
     bool ConnectTcp(const std::string &host, int port);
     bool ConnectUnix(const std::string &host);
+    bool WaitForWrite(int fd);
     template <typename T>
     bool IsContains(T v1, T v2)
     {
@@ -133,17 +179,25 @@ protected:
 #endif
 
 private:
-    size_t m_count;
+    std::atomic<size_t> m_count; // count of allocated slots, the index of a valid slot is always less than that
+    size_t m_maxCount;
+    size_t m_activeCount = 0;
+    std::vector<std::unique_ptr<Slot[]>> m_slots;
+    std::vector<size_t> m_freeSlots;
+    Mutex m_slotMutex;
     Service m_service = Service::Undefined;
     Domain m_domain = Domain::Undefined;
     Type m_type = Type::Undefined;
     Options m_options = Options::None;
-    struct pollfd *m_fds = nullptr;
+    std::vector<struct pollfd> m_pollfds;
+    PollMode m_pollMode = PollMode::Poll;
+    short m_pollEvents = POLLIN;
+    int m_epoll = (-1);
+    std::vector<size_t> m_ready;
 #ifdef WITH_OPENSSL
     std::string m_cert;
     std::string m_key;
     SSL_CTX *m_ctx = nullptr;
-    SSL **m_sslClient = nullptr;
 #endif
     std::string m_host = DEFAULT_HOST;
     int m_port = DEFAULT_PORT;
@@ -46,16 +46,19 @@ public:
     void StopNoWait();
     void Wait() const;
     bool IsRunning() const { return m_isRunning; }
+    bool IsCurrent() const;
 
 protected:
     static void *StartThread(void *cls);
     void SetStop();
+    void Join() const;
 
 private:
     pthread_t m_thread;
     std::function<ThreadRoutine> m_func = nullptr;
     std::function<ThreadFinishRoutine> m_funcFinish = nullptr;
     bool m_isRunning = false;
+    mutable bool m_joinable = false;
 };
 
 }
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include "Lock.h"
+#include "BodyStream.h"
+
+
+using namespace WebCpp;
+
+BodyStream::BodyStream(const Request *request, const BodyFunc &func, size_t highWatermark, size_t lowWatermark):
+    m_request(request),
+    m_func(func),
+    m_highWatermark(highWatermark),
+    m_lowWatermark(std::min(lowWatermark, highWatermark))
+{
+
+}
+
+void BodyStream::SetScheduleFunction(const ScheduleFunc &f)
+{
+    m_schedule = f;
+}
+
+void BodyStream::SetPauseFunction(const PauseFunc &f)
+{
+    m_pause = f;
+}
+
+void BodyStream::SetCheckFunction(const CheckFunc &f)
+{
+    m_check = f;
+}
+
+void BodyStream::Push(const ByteArray &data, size_t offset, size_t size)
+{
+    bool schedule = false;
+    {
+        Lock lock(m_mutex);
+        m_chunks.emplace_back(data.begin() + offset, data.begin() + offset + size);
+        m_pending += size;
+        if(m_paused == false && m_pending > m_highWatermark)
+        {
+            // the handler falls behind, don't read the client for now
+            m_paused = true;
+            if(m_pause != nullptr)
+            {
+                m_pause(true);
+            }
+        }
+        if(m_scheduled == false)
+        {
+            m_scheduled = schedule = true;
+        }
+    }
+
+    if(schedule && (m_schedule == nullptr || m_schedule() == false))
+    {
+        // the chunks wait for the next drain
+        Lock lock(m_mutex);
+        m_scheduled = false;
+    }
+}
+
+void BodyStream::Drain()
+{
+    {
+        // the chunks are passed by one thread at a time to keep them in order
+        Lock lock(m_mutex);
+        m_scheduled = false;
+        while(m_active)
+        {
+            m_signal.Wait(m_mutex);
+        }
+        m_active = true;
+    }
+
+    if(m_checked == false)
+    {
+        // it can take long, so it's done here rather than on the reactor
+        m_checked = true;
+        bool passed = true;
+        if(m_check != nullptr)
+        {
+            try
+            {
+                passed = m_check();
+            }
+            catch(...)
+            {
+                passed = false;
+            }
+        }
+        Lock lock(m_mutex);
+        m_passed = passed;
+        m_failed |= (passed == false);
+    }
+
+    while(true)
+    {
+        ByteArray chunk;
+        bool failed;
+        {
+            Lock lock(m_mutex);
+            if(m_chunks.empty())
+            {
+                m_active = false;
+                m_signal.FireAll();
+                break;
+            }
+            chunk = std::move(m_chunks.front());
+            m_chunks.pop_front();
+            failed = m_failed;
+        }
+
+        // the handler is called without the lock, the reactor keeps queuing
+        bool processed = false;
+        if(failed == false && m_func != nullptr)
+        {
+            try
+            {
+                processed = m_func(*m_request, chunk);
+            }
+            catch(...) { }
+        }
+
+        Lock lock(m_mutex);
+        m_failed |= (processed == false);
+        m_pending -= chunk.size();
+        if(m_paused && m_pending <= m_lowWatermark)
+        {
+            m_paused = false;
+            if(m_pause != nullptr)
+            {
+                m_pause(false);
+            }
+        }
+    }
+}
+
+bool BodyStream::IsFailed() const
+{
+    Lock lock(m_mutex);
+    return m_failed;
+}
+
+bool BodyStream::GetCheckResult(bool &passed) const
+{
+    // false if there was no check or it hasn't been done yet
+    Lock lock(m_mutex);
+    passed = m_passed;
+    return (m_checked && m_check != nullptr);
+}
+
+size_t BodyStream::GetPending() const
+{
+    Lock lock(m_mutex);
+    return m_pending;
+}
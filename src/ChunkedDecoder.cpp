@@ -0,0 +1,179 @@
+#include <cstring>
+#include "ChunkedDecoder.h"
+
+
+using namespace WebCpp;
+
+ChunkedDecoder::Result ChunkedDecoder::Decode(const ByteArray &data, size_t offset, size_t size, size_t &consumed, const DataFunc &f)
+{
+    ClearError();
+
+    size_t pos = offset;
+    size_t end = offset + size;
+    Result result = Result::NeedMore;
+
+    while(pos < end && m_state != State::Complete && result != Result::Error)
+    {
+        switch(m_state)
+        {
+            case State::Size:
+            case State::Trailer:
+            {
+                const void *ptr = memchr(data.data() + pos, LF, end - pos);
+                if(ptr == nullptr)
+                {
+                    if(end - pos > MAX_CHUNK_LINE_SIZE)
+                    {
+                        SetLastError("chunk line too long");
+                        result = Result::Error;
+                    }
+                    consumed = pos - offset;
+                    return result;
+                }
+
+                size_t lineEnd = static_cast<const uint8_t *>(ptr) - data.data();
+                if(m_state == State::Size)
+                {
+                    if(ParseSize(data, pos, lineEnd) == false)
+                    {
+                        result = Result::Error;
+                        break;
+                    }
+                    m_state = (m_chunkSize == 0) ? State::Trailer : State::Data;
+                }
+                else if(lineEnd == pos || (lineEnd == pos + 1 && data[pos] == CR))
+                {
+                    m_state = State::Complete; // the empty line after the trailer
+                }
+                pos = lineEnd + 1;
+                break;
+            }
+            case State::Data:
+            {
+                // the chunk data isn't copied, it's passed on in place
+                size_t length = std::min(end - pos, m_chunkSize);
+                if(f != nullptr && f(data, pos, length) == false)
+                {
+                    SetLastError("the chunk data isn't accepted");
+                    result = Result::Error;
+                    break;
+                }
+                m_chunkSize -= length;
+                m_decoded += length;
+                pos += length;
+                if(m_chunkSize == 0)
+                {
+                    m_state = State::DataEnd;
+                }
+                break;
+            }
+            case State::DataEnd:
+                if(data[pos] == LF)
+                {
+                    pos ++;
+                }
+                else if(data[pos] == CR)
+                {
+                    if(end - pos < 2)
+                    {
+                        consumed = pos - offset;
+                        return result;
+                    }
+                    if(data[pos + 1] != LF)
+                    {
+                        SetLastError("wrong chunk end");
+                        result = Result::Error;
+                        break;
+                    }
+                    pos += 2;
+                }
+                else
+                {
+                    SetLastError("wrong chunk end");
+                    result = Result::Error;
+                    break;
+                }
+                m_state = State::Size;
+                break;
+            case State::Complete:
+                break;
+        }
+    }
+
+    consumed = pos - offset;
+    if(result == Result::Error)
+    {
+        return result;
+    }
+
+    return (m_state == State::Complete) ? Result::Complete : Result::NeedMore;
+}
+
+bool ChunkedDecoder::IsComplete() const
+{
+    return m_state == State::Complete;
+}
+
+size_t ChunkedDecoder::GetDecodedSize() const
+{
+    return m_decoded;
+}
+
+void ChunkedDecoder::Reset()
+{
+    m_state = State::Size;
+    m_chunkSize = 0;
+    m_decoded = 0;
+}
+
+bool ChunkedDecoder::ParseSize(const ByteArray &data, size_t start, size_t end)
+{
+    // hex digits, the chunk extensions after ';' are ignored
+    size_t size = 0;
+    size_t pos = start;
+    while(pos < end)
+    {
+        uint8_t ch = data[pos];
+        int digit;
+        if(ch >= '0' && ch <= '9')
+        {
+            digit = ch - '0';
+        }
+        else if((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f')
+        {
+            digit = (ch | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            break;
+        }
+
+        if(size > (SIZE_MAX >> 4))
+        {
+            SetLastError("chunk size too big");
+            return false;
+        }
+        size = (size << 4) | static_cast<size_t>(digit);
+        pos ++;
+    }
+
+    if(pos == start)
+    {
+        SetLastError("wrong chunk size");
+        return false;
+    }
+
+    // only spaces, extensions and CR can follow the size
+    while(pos < end && (data[pos] == ' ' || data[pos] == '\t'))
+    {
+        pos ++;
+    }
+    if(pos < end && data[pos] != ';' && !(data[pos] == CR && pos + 1 == end))
+    {
+        SetLastError("wrong chunk size");
+        return false;
+    }
+
+    m_chunkSize = size;
+    return true;
+}
@@ -0,0 +1,269 @@
+#ifdef WITH_ZLIB
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include "CompressionCache.h"
+#include "Compressor.h"
+#include "FileCache.h"
+#include "FileSystem.h"
+#include "HttpConfig.h"
+#include "File.h"
+#include "Lock.h"
+#include "LogWriter.h"
+
+
+using namespace WebCpp;
+
+CompressionCache &CompressionCache::Instance()
+{
+    static CompressionCache instance;
+    return instance;
+}
+
+CompressionCache::~CompressionCache()
+{
+    Clear();
+    if(m_temporary && m_folder.empty() == false)
+    {
+        rmdir(m_folder.c_str());
+    }
+}
+
+std::string CompressionCache::Get(const std::string &path, size_t sourceSize, int64_t modified)
+{
+    {
+        Lock lock(m_mutex);
+        auto it = m_entries.find(path);
+        if(it != m_entries.end() && it->second.modified == modified)
+        {
+            return it->second.path; // empty if the file doesn't get smaller
+        }
+    }
+
+    // the file isn't known yet or it was changed, that's done without the lock,
+    // two threads compressing the same file write to different temp. files
+    Entry entry;
+    entry.modified = modified;
+    entry.own = false;
+    int64_t variantModified;
+    std::string sibling = path + ".gz";
+    if(FileSystem::GetFileStat(sibling, entry.size, variantModified) && variantModified >= modified)
+    {
+        entry.path = sibling;
+    }
+    else
+    {
+        std::string folder = GetFolder();
+        if(folder.empty())
+        {
+            return "";
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "%016zx-%016llx.gz", std::hash<std::string>()(path), static_cast<unsigned long long>(modified));
+        entry.path = folder + name;
+        entry.own = true;
+        if(GetVariantStat(entry.path, entry.size) == false)
+        {
+            if(CompressFile(path, entry.path, HttpConfig::Instance().GetCompressionLevel()) == false ||
+               GetVariantStat(entry.path, entry.size) == false)
+            {
+                return "";
+            }
+            // it may be remembered as missing, the event of its creation comes later
+            FileCache::Instance().Remove(entry.path);
+        }
+    }
+
+    if(entry.size >= sourceSize)
+    {
+        if(entry.own)
+        {
+            unlink(entry.path.c_str());
+        }
+        entry.path.clear();
+        entry.own = false;
+    }
+
+    Lock lock(m_mutex);
+    auto it = m_entries.find(path);
+    if(it != m_entries.end())
+    {
+        if(it->second.own && it->second.path != entry.path)
+        {
+            unlink(it->second.path.c_str()); // the variant of the previous version
+        }
+        it->second = entry;
+    }
+    else
+    {
+        m_entries.insert(std::make_pair(path, entry));
+    }
+
+    return entry.path;
+}
+
+void CompressionCache::Remove(const std::string &path)
+{
+    Lock lock(m_mutex);
+    auto it = m_entries.find(path);
+    if(it != m_entries.end())
+    {
+        if(it->second.own)
+        {
+            unlink(it->second.path.c_str());
+        }
+        m_entries.erase(it);
+    }
+}
+
+void CompressionCache::Clear()
+{
+    Lock lock(m_mutex);
+    for(auto &it: m_entries)
+    {
+        if(it.second.own)
+        {
+            unlink(it.second.path.c_str());
+        }
+    }
+    m_entries.clear();
+}
+
+std::string CompressionCache::GetFolder()
+{
+    Lock lock(m_mutex);
+    if(m_folder.empty() && m_failed == false)
+    {
+        std::string folder = HttpConfig::Instance().GetCompressionFolder();
+        if(folder.empty())
+        {
+            // a folder of this process only, its name can't be guessed
+            const char *temp = getenv("TMPDIR");
+            std::string pattern = std::string(temp == nullptr ? "/tmp" : temp) + FileSystem::PathDelimiter() + DEFAULT_COMPRESSION_FOLDER + "-XXXXXX";
+            std::vector<char> name(pattern.begin(), pattern.end());
+            name.push_back('\0');
+            if(mkdtemp(name.data()) == nullptr)
+            {
+                LOG("can't create " + pattern, LogWriter::LogType::Error);
+                m_failed = true;
+                return "";
+            }
+            folder = name.data();
+            m_temporary = true;
+        }
+        else
+        {
+            folder = FileSystem::NormalizePath(folder, true);
+            while(folder.size() > 1 && folder.back() == FileSystem::PathDelimiter())
+            {
+                folder.pop_back();
+            }
+            std::string parent = FileSystem::ExtractFileName(folder);
+            parent = folder.substr(0, folder.size() - parent.size());
+            if(parent.empty() == false && FileSystem::IsDir(parent) == false)
+            {
+                FileSystem::CreateFolder(parent);
+            }
+            mkdir(folder.c_str(), S_IRWXU);
+        }
+
+        if(IsPrivate(folder) == false)
+        {
+            LOG("can't use " + folder + " for the compressed files, it must be a folder of the user writable by nobody else",
+                LogWriter::LogType::Error);
+            m_failed = true;
+            return "";
+        }
+        m_folder = FileSystem::NormalizePath(folder);
+    }
+
+    return m_folder;
+}
+
+bool CompressionCache::IsPrivate(const std::string &folder)
+{
+    // a variant is sent as it is so nobody else may put a file there
+    struct stat sb;
+    return (lstat(folder.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode) && sb.st_uid == geteuid() &&
+            (sb.st_mode & (S_IWGRP | S_IWOTH)) == 0);
+}
+
+bool CompressionCache::GetVariantStat(const std::string &path, size_t &size)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if(fd == (-1))
+    {
+        return false;
+    }
+
+    struct stat sb;
+    bool retval = (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_uid == geteuid());
+    close(fd);
+    if(retval)
+    {
+        size = static_cast<size_t>(sb.st_size);
+    }
+
+    return retval;
+}
+
+bool CompressionCache::CompressFile(const std::string &source, const std::string &target, int level)
+{
+    static std::atomic<unsigned> counter(0);
+
+    File input(source, File::Mode::Read);
+    if(input.IsOpened() == false)
+    {
+        LOG("can't open " + source, LogWriter::LogType::Error);
+        return false;
+    }
+
+    // the variant appears under its name only when it's complete
+    std::string temp = target + "." + std::to_string(getpid()) + "." + std::to_string(++ counter);
+    File output(temp, File::Mode::Write);
+    Compressor compressor;
+    if(output.IsOpened() == false || compressor.Init(Compressor::Format::Gzip, level) == false)
+    {
+        LOG("can't create " + temp, LogWriter::LogType::Error);
+        return false;
+    }
+
+    char buffer[COMPRESSOR_CHUNK_SIZE];
+    ByteArray compressed;
+    bool retval = true;
+    while(retval)
+    {
+        size_t size = input.Read(buffer, sizeof(buffer));
+        if(size == 0 || size == SIZE_MAX)
+        {
+            retval = (size == 0);
+            break;
+        }
+        compressed.clear();
+        retval = compressor.Compress(reinterpret_cast<const uint8_t *>(buffer), size, compressed) &&
+                 output.Write(reinterpret_cast<const char *>(compressed.data()), compressed.size()) == compressed.size();
+    }
+    if(retval)
+    {
+        compressed.clear();
+        retval = compressor.Finish(compressed) &&
+                 output.Write(reinterpret_cast<const char *>(compressed.data()), compressed.size()) == compressed.size();
+    }
+    output.Close();
+
+    if(retval == false || rename(temp.c_str(), target.c_str()) != 0)
+    {
+        LOG("error compressing " + source, LogWriter::LogType::Error);
+        unlink(temp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+#endif // WITH_ZLIB
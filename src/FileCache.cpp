@@ -0,0 +1,346 @@
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <vector>
+#include "FileCache.h"
+#include "FileSystem.h"
+#include "HttpConfig.h"
+#include "Response.h"
+#include "File.h"
+#include "Lock.h"
+#include "LogWriter.h"
+
+#define FILE_CACHE_WATCH_MASK (IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                               IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#define FILE_CACHE_EVENT_BUFFER 4096
+
+
+using namespace WebCpp;
+
+FileCache &FileCache::Instance()
+{
+    static FileCache instance;
+    return instance;
+}
+
+FileCache::~FileCache()
+{
+    m_thread.Stop(true);
+    if(m_inotify != (-1))
+    {
+        close(m_inotify);
+    }
+}
+
+std::shared_ptr<const FileCache::Entry> FileCache::Get(const std::string &path)
+{
+    auto &config = HttpConfig::Instance();
+    size_t budget = config.GetFileCacheSize();
+    if(budget > 0)
+    {
+        Lock lock(m_mutex);
+        auto it = m_entries.find(path);
+        if(it != m_entries.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            return it->second.entry;
+        }
+    }
+
+    // the folder is watched before the file is read so a change made meanwhile
+    // isn't missed, the entry isn't kept if there were events in the folder since then
+    std::string folder = ExtractFolder(path);
+    uint64_t generation = 0;
+    bool cache = (budget > 0 && Watch(folder, generation));
+    size_t maxSize = cache ? std::min(budget, config.GetFileCacheMaxFileSize()) : 0;
+    auto entry = Load(path, maxSize);
+
+    // a missing file is remembered as well until a file is created in the folder
+    if(cache)
+    {
+        Lock lock(m_mutex);
+        auto it = m_folders.find(folder);
+        if(it != m_folders.end() && it->second.generation == generation)
+        {
+            Insert(path, entry);
+            Evict(budget);
+        }
+    }
+
+    return entry;
+}
+
+void FileCache::Remove(const std::string &path)
+{
+    Lock lock(m_mutex);
+    auto it = m_entries.find(path);
+    if(it != m_entries.end())
+    {
+        Erase(it);
+    }
+}
+
+void FileCache::Clear()
+{
+    Lock lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_memory = 0;
+}
+
+size_t FileCache::GetCount() const
+{
+    Lock lock(m_mutex);
+    return m_entries.size();
+}
+
+size_t FileCache::GetMemoryUsage() const
+{
+    Lock lock(m_mutex);
+    return m_memory;
+}
+
+std::shared_ptr<FileCache::Entry> FileCache::Load(const std::string &path, size_t maxSize)
+{
+    struct stat sb;
+    if(stat(path.c_str(), &sb) != 0 || S_ISREG(sb.st_mode) == false)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<Entry> entry(new Entry());
+    entry->path = path;
+    entry->size = static_cast<size_t>(sb.st_size);
+    entry->modified = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+    entry->loaded = false;
+
+    struct tm timeinfo;
+    char buffer[64];
+    gmtime_r(&sb.st_mtim.tv_sec, &timeinfo);
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &timeinfo);
+    entry->lastModified = buffer;
+    // the inode, the modification time in nsec. and the size change with every write
+    snprintf(buffer, sizeof(buffer), "\"%llx-%llx-%zx\"", static_cast<unsigned long long>(sb.st_ino),
+             static_cast<unsigned long long>(entry->modified), entry->size);
+    entry->etag = buffer;
+    entry->mimeType = Response::Extension2MimeType(FileSystem::ExtractFileExtension(path));
+
+    if(entry->size <= maxSize)
+    {
+        File file(path, File::Mode::Read);
+        if(file.IsOpened())
+        {
+            entry->content.resize(entry->size);
+            size_t position = 0;
+            while(position < entry->size)
+            {
+                size_t size = file.Read(reinterpret_cast<char *>(entry->content.data()) + position, entry->size - position);
+                if(size == 0 || size == SIZE_MAX)
+                {
+                    break;
+                }
+                position += size;
+            }
+            // the file was truncated meanwhile, it's sent from the disk
+            entry->loaded = (position == entry->size);
+            if(entry->loaded == false)
+            {
+                ByteArray().swap(entry->content);
+            }
+        }
+    }
+
+    return entry;
+}
+
+bool FileCache::Watch(const std::string &folder, uint64_t &generation)
+{
+    Lock lock(m_mutex);
+    if(m_failed)
+    {
+        return false;
+    }
+
+    if(m_inotify == (-1))
+    {
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(m_inotify == (-1))
+        {
+            // a file can't be cached if its changes aren't noticed
+            m_failed = true;
+            LOG("inotify isn't available, the file cache is off", LogWriter::LogType::Error);
+            return false;
+        }
+        auto f = std::bind(&FileCache::WatchThread, this, std::placeholders::_1);
+        m_thread.SetFunction(f);
+        if(m_thread.Start() == false)
+        {
+            m_failed = true;
+            LOG("failed to start the file cache thread: " + m_thread.GetLastError(), LogWriter::LogType::Error);
+            return false;
+        }
+    }
+
+    auto it = m_folders.find(folder);
+    if(it == m_folders.end())
+    {
+        int wd = inotify_add_watch(m_inotify, folder.empty() ? "." : folder.c_str(), FILE_CACHE_WATCH_MASK);
+        if(wd == (-1))
+        {
+            return false;
+        }
+        // the same folder can be reached by different paths, they share the watch
+        m_watches[wd].push_back(folder);
+        it = m_folders.insert(std::make_pair(folder, Folder{ wd, 0 })).first;
+    }
+
+    generation = it->second.generation;
+    return true;
+}
+
+void FileCache::Insert(const std::string &path, const std::shared_ptr<Entry> &entry)
+{
+    auto it = m_entries.find(path);
+    if(it != m_entries.end())
+    {
+        // loaded by another thread at the same time
+        m_memory -= GetMemory(it->second.entry);
+        it->second.entry = entry;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    }
+    else
+    {
+        m_lru.push_front(path);
+        m_entries.insert(std::make_pair(path, Item{ entry, m_lru.begin() }));
+    }
+    m_memory += GetMemory(entry);
+}
+
+void FileCache::Evict(size_t budget)
+{
+    while(m_lru.empty() == false && (m_memory > budget || m_entries.size() > FILE_CACHE_MAX_ENTRIES))
+    {
+        Erase(m_entries.find(m_lru.back()));
+    }
+}
+
+std::map<std::string, FileCache::Item>::iterator FileCache::Erase(std::map<std::string, Item>::iterator it)
+{
+    m_memory -= GetMemory(it->second.entry);
+    m_lru.erase(it->second.lru);
+    return m_entries.erase(it);
+}
+
+void FileCache::RemoveFolder(const std::string &folder)
+{
+    // the folder was moved or deleted, the entries and the watches of its subfolders go with it
+    for(auto it = m_entries.lower_bound(folder);it != m_entries.end() && it->first.compare(0, folder.size(), folder) == 0;)
+    {
+        it = Erase(it);
+    }
+
+    for(auto it = m_folders.lower_bound(folder);it != m_folders.end() && it->first.compare(0, folder.size(), folder) == 0;)
+    {
+        auto watch = m_watches.find(it->second.wd);
+        if(watch != m_watches.end())
+        {
+            inotify_rm_watch(m_inotify, watch->first);
+            m_watches.erase(watch);
+        }
+        it = m_folders.erase(it);
+    }
+}
+
+void *FileCache::WatchThread(bool &running)
+{
+    alignas(struct inotify_event) char buffer[FILE_CACHE_EVENT_BUFFER];
+
+    while(running)
+    {
+        struct pollfd fds;
+        fds.fd = m_inotify;
+        fds.events = POLLIN;
+        fds.revents = 0;
+        if(poll(&fds, 1, FILE_CACHE_POLL_TIMEOUT) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if(length <= 0)
+        {
+            continue;
+        }
+
+        Lock lock(m_mutex);
+        for(char *ptr = buffer;ptr < buffer + length;)
+        {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW)
+            {
+                // some events are lost so nothing cached can be trusted
+                m_entries.clear();
+                m_lru.clear();
+                m_memory = 0;
+                for(auto &folder: m_folders)
+                {
+                    folder.second.generation ++;
+                }
+                continue;
+            }
+
+            auto watch = m_watches.find(event->wd);
+            if(watch == m_watches.end())
+            {
+                continue;
+            }
+            std::vector<std::string> folders = watch->second;
+            for(auto &folder: folders)
+            {
+                auto it = m_folders.find(folder);
+                if(it != m_folders.end())
+                {
+                    it->second.generation ++;
+                }
+                if(event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+                {
+                    RemoveFolder(folder);
+                }
+                else if(event->len > 0)
+                {
+                    auto entry = m_entries.find(folder + event->name);
+                    if(entry != m_entries.end())
+                    {
+                        Erase(entry);
+                    }
+                }
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+size_t FileCache::GetMemory(const std::shared_ptr<Entry> &entry)
+{
+    return (entry == nullptr ? 0 : entry->content.size());
+}
+
+std::string FileCache::ExtractFolder(const std::string &path)
+{
+    // the entries of a folder are keyed by the folder as it's written in the path
+    size_t pos = path.rfind('/');
+    if(pos == std::string::npos)
+    {
+        return "";
+    }
+
+    return path.substr(0, pos + 1);
+}
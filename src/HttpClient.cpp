@@ -84,6 +84,9 @@ bool HttpClient::Open()
         return false;
     }
 
+    m_response.reset();
+    m_buffer.clear();
+
     if(m_request.Send(m_connection) == false)
     {
         SetLastError("request sending error: " + m_request.GetLastError());
@@ -159,6 +162,16 @@ void HttpClient::SetAuthCallback(const std::function<bool (const Request &, Auth
     m_authCallback = func;
 }
 
+void HttpClient::SetBodyCallback(const Response::BodyFunc &func)
+{
+    m_bodyCallback = func;
+}
+
+void HttpClient::SetOutputFile(const std::string &path)
+{
+    m_outputFile = path;
+}
+
 HttpClient::State HttpClient::GetState() const
 {
     return m_state;
@@ -173,70 +186,166 @@ void HttpClient::OnDataReady(const ByteArray &data)
 {
     m_buffer.insert(m_buffer.end(), data.begin(), data.end());
 
-    Response response(0, m_config);
-    size_t all, downloaded;
-    if(response.Parse(m_buffer, &all, &downloaded))
+    if(m_response == nullptr)
     {
-        if(response.GetResponseCode() == 401)
-        {
-            LOG("Authentication required", LogWriter::LogType::Info);
-            m_authRequired = true;
-            m_authProvider.Clear();
-
-            if(m_authCallback != nullptr)
-            {
-                auto list = response.GetHeader().GetAllHeaders("WWW-Authenticate");
-                for(auto &scheme: list)
-                {
-                    m_authProvider.Parse(scheme);
-                }
+        m_response.reset(new Response(0, m_config));
+#ifdef WITH_ZLIB
+        m_response->SetDecompressor(&m_decompressor);
+#endif
+    }
 
-                if(m_authCallback(m_request, m_authProvider) == true)
-                {
-                    AddAuthHeaders();
-                    if(Open() == false)
-                    {
-                        SetLastError("request with auth sending error: " + m_request.GetLastError());
-                        LOG(GetLastError(), LogWriter::LogType::Error);
-                    }
-
-                    SetState(State::DataSent);
-                }
-            }
+    // the response is parsed as it arrives, only an incomplete line is kept in the buffer
+    size_t consumed;
+    auto result = m_response->Parse(m_buffer, consumed);
+    if(result == Response::ParseResult::Header)
+    {
+        if(BeginBody(*m_response) == false)
+        {
+            result = Response::ParseResult::Error;
         }
         else
         {
-            SetState(State::DataReady);
-            if(m_responseCallback != nullptr)
-            {
-                m_responseCallback(response);
-            }
-
-            if(m_keepOpen == false)
-            {
-                Close(false);
-            }
-            else
-            {
-                SetState(State::Undefined);
-            }
+            result = m_response->Parse(m_buffer, consumed);
         }
+    }
 
+    if(result == Response::ParseResult::Error)
+    {
+        if(m_response->GetLastError().empty() == false)
+        {
+            SetLastError("response parsing error: " + m_response->GetLastError());
+        }
+        LOG(GetLastError(), LogWriter::LogType::Error);
+        m_response.reset();
+        m_output.reset();
         m_buffer.clear();
+        SetState(State::Undefined);
+        return;
     }
 
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + consumed);
+
     if(m_progressCallback)
     {
-        m_progressCallback(all, downloaded);
+        m_progressCallback(m_response->GetHeader().GetBodySize(), m_response->GetBodyReceived());
+    }
+
+    if(result == Response::ParseResult::Complete)
+    {
+        m_buffer.clear();
+        ProcessResponse();
     }
 }
 
 void HttpClient::OnClosed()
 {
+    // a body without the size ends with the connection
+    if(m_response != nullptr)
+    {
+        if(m_response->Finish() == Response::ParseResult::Complete)
+        {
+            ProcessResponse();
+        }
+        else
+        {
+            SetLastError("response parsing error: " + m_response->GetLastError());
+            LOG(GetLastError(), LogWriter::LogType::Error);
+        }
+    }
+    m_response.reset();
+    m_output.reset();
     m_buffer.clear();
     SetState(State::Closed);
 }
 
+bool HttpClient::BeginBody(Response &response)
+{
+    // the body of a response that will be repeated with the credentials isn't needed
+    if(response.GetResponseCode() == 401 || (m_bodyCallback == nullptr && m_outputFile.empty()))
+    {
+        return true;
+    }
+
+    if(m_outputFile.empty() == false)
+    {
+        m_output.reset(new File(m_outputFile, File::Mode::Write));
+        if(m_output->IsOpened() == false)
+        {
+            SetLastError("error opening output file: " + m_output->GetLastError());
+            m_output.reset();
+            return false;
+        }
+    }
+
+    response.SetBodyFunction([this](const Response &response, const ByteArray &data, size_t offset, size_t size) -> bool
+    {
+        if(m_output != nullptr && m_output->Write(reinterpret_cast<const char *>(data.data() + offset), size) != size)
+        {
+            SetLastError("error writing output file: " + m_output->GetLastError());
+            return false;
+        }
+        if(m_bodyCallback != nullptr)
+        {
+            return m_bodyCallback(response, data, offset, size);
+        }
+        return true;
+    });
+
+    return true;
+}
+
+void HttpClient::ProcessResponse()
+{
+    // the same connection can carry the next request while the response is processed
+    std::unique_ptr<Response> response = std::move(m_response);
+    m_output.reset();
+
+    if(response->GetResponseCode() == 401)
+    {
+        LOG("Authentication required", LogWriter::LogType::Info);
+        m_authRequired = true;
+        m_authProvider.Clear();
+
+        if(m_authCallback != nullptr)
+        {
+            auto list = response->GetHeader().GetAllHeaders("WWW-Authenticate");
+            for(auto &scheme: list)
+            {
+                m_authProvider.Parse(scheme);
+            }
+
+            if(m_authCallback(m_request, m_authProvider) == true)
+            {
+                AddAuthHeaders();
+                if(Open() == false)
+                {
+                    SetLastError("request with auth sending error: " + m_request.GetLastError());
+                    LOG(GetLastError(), LogWriter::LogType::Error);
+                }
+
+                SetState(State::DataSent);
+            }
+        }
+    }
+    else
+    {
+        SetState(State::DataReady);
+        if(m_responseCallback != nullptr)
+        {
+            m_responseCallback(*response);
+        }
+
+        if(m_keepOpen == false)
+        {
+            Close(false);
+        }
+        else
+        {
+            SetState(State::Undefined);
+        }
+    }
+}
+
 bool HttpClient::InitConnection(const Url &url)
 {
     if(m_connection == nullptr || m_connection->IsInitialized() == false)
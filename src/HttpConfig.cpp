@@ -55,6 +55,13 @@ std::string HttpConfig::ToString() const
             "\tname: " + m_ServerName + "\n" +
             "\tHTTP protocol: " + Http::Protocol2String(m_HttpProtocol) + "\n" +
             "\tHTTP port: " + std::to_string(m_HttpServerPort) + "\n" +
+            "\ttimeouts, msec.: keep-alive " + std::to_string(m_KeepAliveTimeout) +
+                ", header " + std::to_string(m_HeaderTimeout) +
+                ", read " + std::to_string(m_ReadTimeout) +
+                ", write " + std::to_string(m_WriteTimeout) + "\n" +
+            "\tmax. connections: " + std::to_string(m_MaxConnections) + "\n" +
+            "\treactors: " + std::to_string(m_ReactorCount) + "\n" +
+            "\tworkers: " + std::to_string(m_WorkerCount) + "\n" +
             "\tWebSocket protocol: " + Http::Protocol2String(m_WsProtocol) + "\n" +
             "\tWebSocket port: " + std::to_string(m_WsServerPort) + "\n" +
             "\tRoot : " + m_rootFolder + "\n";
@@ -1,12 +1,86 @@
 #include <algorithm>
+#include <cstring>
+#include <cctype>
 #include "defines_webcpp.h"
 #include "StringUtil.h"
 #include "HttpHeader.h"
 
 
+#define DEFAULT_HEADER_DATA_SIZE 2048
+#define DEFAULT_UNKNOWN_HEADERS 32
+#define HEADER_TABLE_SIZE 1024
+
+
 using namespace WebCpp;
 
 HttpHeader::Header HttpHeader::Header::defaultHeader = HttpHeader::Header();
+constexpr size_t HttpHeader::HeaderTypeCount;
+
+static bool IsSpace(uint8_t ch)
+{
+    return ch == ' ' || ch == '\t' || ch == CR || ch == LF;
+}
+
+static bool IsEqualNoCase(const char *str1, const char *str2, size_t size)
+{
+    for(size_t i = 0;i < size;i ++)
+    {
+        if(tolower(static_cast<uint8_t>(str1[i])) != tolower(static_cast<uint8_t>(str2[i])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* the names are hashed ignoring the case (the letters are ORed with 0x20),
+ * so 'content-length' from HTTP/2-style clients is the same header as 'Content-Length' */
+static uint32_t HashName(const char *str, size_t size, uint32_t seed)
+{
+    uint32_t hash = (seed ^ static_cast<uint32_t>(size)) * 16777619u;
+    for(size_t i = 0;i < size;i ++)
+    {
+        hash = (hash ^ (static_cast<uint8_t>(str[i]) | 0x20)) * 16777619u;
+    }
+
+    return hash ^ (hash >> 15);
+}
+
+struct HeaderTable
+{
+    uint32_t seed = 0;
+    HttpHeader::HeaderType slots[HEADER_TABLE_SIZE];
+};
+
+/* the table is generated on the first use, the seed is changed until
+ * every known name gets its own slot, so the lookup is a single probe */
+static const HeaderTable &GetHeaderTable()
+{
+    static const HeaderTable table = []()
+    {
+        HeaderTable t;
+        for(t.seed = 0;;t.seed ++)
+        {
+            bool perfect = true;
+            std::fill(std::begin(t.slots), std::end(t.slots), HttpHeader::HeaderType::Undefined);
+            for(size_t i = 1;i < HttpHeader::HeaderTypeCount && perfect;i ++)
+            {
+                auto type = static_cast<HttpHeader::HeaderType>(i);
+                const std::string &name = HttpHeader::HeaderTypeName(type);
+                auto &slot = t.slots[HashName(name.data(), name.size(), t.seed) & (HEADER_TABLE_SIZE - 1)];
+                perfect = (slot == HttpHeader::HeaderType::Undefined);
+                slot = type;
+            }
+            if(perfect)
+            {
+                return t;
+            }
+        }
+    }();
+
+    return table;
+}
 
 HttpHeader::HttpHeader(HeaderRole role)
 {
@@ -20,8 +94,7 @@ bool HttpHeader::Parse(const ByteArray &data, size_t start)
     size_t pos = StringUtil::SearchPosition(data, { CRLFCRLF }, start);
     if(pos != SIZE_MAX)
     {
-        auto arr = StringUtil::Split(data, { CRLF }, start, pos);
-        if(ParseHeaders(data, arr))
+        if(ParseHeaders(data, start, pos + 1))
         {
             m_headerSize = pos - start;
             m_complete = true;
@@ -33,19 +106,61 @@ bool HttpHeader::Parse(const ByteArray &data, size_t start)
 
 bool HttpHeader::ParseHeader(const ByteArray &data)
 {
-    auto arr = StringUtil::Split(data, { CRLF }, 0, data.size());
-    return ParseHeaders(data, arr);
+    if(data.empty())
+    {
+        return true;
+    }
+
+    return ParseHeaders(data, 0, data.size() - 1);
 }
 
 ByteArray HttpHeader::ToByteArray() const
 {
-    std::string headers;
-    for(auto const &header: m_headers)
+    ByteArray headers;
+    Serialize(headers);
+
+    return headers;
+}
+
+void HttpHeader::Serialize(ByteArray &buffer) const
+{
+    // the size is known in advance, so the lines are appended without reallocations
+    size_t size = buffer.size();
+    for(size_t i = 1;i < HeaderTypeCount;i ++)
     {
-        headers += header.name + ": " + header.value + CR + LF;
+        if(m_known[i].exists)
+        {
+            size += HeaderTypeName(static_cast<HeaderType>(i)).size() + m_known[i].length + 4;
+        }
     }
+    for(auto const &entry: m_unknown)
+    {
+        size += entry.name.length + entry.value.length + 4;
+    }
+    buffer.reserve(size);
 
-    return ByteArray(headers.begin(), headers.end());
+    auto append = [this, &buffer](const uint8_t *name, size_t nameSize, const Slice &value)
+    {
+        buffer.insert(buffer.end(), name, name + nameSize);
+        buffer.push_back(':');
+        buffer.push_back(' ');
+        buffer.insert(buffer.end(), m_data.begin() + value.offset, m_data.begin() + value.offset + value.length);
+        buffer.push_back(CR);
+        buffer.push_back(LF);
+    };
+
+    for(size_t i = 1;i < HeaderTypeCount;i ++)
+    {
+        if(m_known[i].exists)
+        {
+            const std::string &name = HeaderTypeName(static_cast<HeaderType>(i));
+            append(reinterpret_cast<const uint8_t *>(name.data()), name.size(), m_known[i]);
+        }
+    }
+    for(auto const &entry: m_unknown)
+    {
+        append(m_data.data() + entry.name.offset, entry.name.length, entry.value);
+    }
 }
 
 bool HttpHeader::IsComplete() const
@@ -64,13 +179,19 @@ size_t HttpHeader::GetBodySize() const
 
     if(m_complete)
     {
-        auto str = GetHeader(HeaderType::ContentLength);
-        if(str.empty() == false)
+        // called for every received piece of the request, so the value is read in place
+        const Slice &slice = m_known[static_cast<size_t>(HeaderType::ContentLength)];
+        if(slice.exists && slice.length > 0)
         {
-            int num;
-            if(StringUtil::String2int(str, num))
+            const uint8_t *ptr = m_data.data() + slice.offset;
+            for(size_t i = 0;i < slice.length;i ++)
             {
-                size = num;
+                if(ptr[i] < '0' || ptr[i] > '9' || size > (SIZE_MAX - 9) / 10)
+                {
+                    size = 0;
+                    break;
+                }
+                size = size * 10 + (ptr[i] - '0');
             }
         }
         else
@@ -102,113 +223,121 @@ void HttpHeader::SetVersion(const std::string &version)
     m_version = version;
 }
 
-bool HttpHeader::ParseHeaders(const ByteArray &data, const StringUtil::Ranges &ranges)
+bool HttpHeader::ParseHeaders(const ByteArray &data, size_t start, size_t end)
 {
-    bool statusLineParsed = false;
-
-    for(auto &range: ranges)
+    // the data is scanned by 64 bytes blocks, the masks of LF and ':' give
+    // the line ends and the name delimiters without looking at every byte
+    size_t lineStart = start;
+    size_t colon = SIZE_MAX;
+    for(size_t block = start;block <= end;block += 64)
     {
-        auto headerDelimiter = StringUtil::SearchPosition(data, { ':' }, range.start, range.end);
-        if(headerDelimiter != SIZE_MAX)
+        uint64_t lfMask;
+        uint64_t colonMask;
+        StringUtil::ScanBlock(data, block, end, lfMask, colonMask);
+
+        uint64_t mask = lfMask | colonMask;
+        while(mask != 0)
         {
-            std::string name = std::string(data.begin() + range.start, data.begin() + headerDelimiter);
-            std::string value = std::string(data.begin() + headerDelimiter + 1, data.begin() + range.end + 1);
-            StringUtil::Trim(name);
-            StringUtil::Trim(value);
+            uint64_t bit = mask & (~mask + 1);
+            size_t pos = block + __builtin_ctzll(mask);
+            mask ^= bit;
+            if((colonMask & bit) != 0)
+            {
+                if(colon == SIZE_MAX)
+                {
+                    colon = pos;
+                }
+                continue;
+            }
 
-            SetHeader(name, value);
+            AddLine(data, lineStart, pos, colon);
+            lineStart = pos + 1;
+            colon = SIZE_MAX;
         }
     }
+    AddLine(data, lineStart, end + 1, colon);
 
     return true;
 }
 
+void HttpHeader::AddLine(const ByteArray &data, size_t start, size_t end, size_t colon)
+{
+    if(end > start && data[end - 1] == CR)
+    {
+        end --;
+    }
+    if(end > start && colon != SIZE_MAX && colon < end)
+    {
+        ParseLine(data, StringUtil::Range { start, end - 1 }, colon);
+    }
+}
+
+bool HttpHeader::ParseLine(const ByteArray &data, const StringUtil::Range &range, size_t colon)
+{
+    if(range.end < range.start || range.end >= data.size())
+    {
+        return false;
+    }
+
+    // the name and the value are trimmed in place and copied once, into m_data
+    const char *line = reinterpret_cast<const char *>(data.data()) + range.start;
+    size_t size = range.end - range.start + 1;
+    const char *delimiter = nullptr;
+    if(colon >= range.start && colon <= range.end)
+    {
+        delimiter = reinterpret_cast<const char *>(data.data()) + colon;
+    }
+    else
+    {
+        delimiter = static_cast<const char *>(memchr(line, ':', size));
+    }
+    if(delimiter == nullptr)
+    {
+        return false;
+    }
+
+    const char *name = line;
+    const char *nameEnd = delimiter;
+    const char *value = delimiter + 1;
+    const char *valueEnd = line + size;
+    while(name < nameEnd && IsSpace(*name)) name ++;
+    while(nameEnd > name && IsSpace(*(nameEnd - 1))) nameEnd --;
+    while(value < valueEnd && IsSpace(*value)) value ++;
+    while(valueEnd > value && IsSpace(*(valueEnd - 1))) valueEnd --;
+
+    size_t nameSize = nameEnd - name;
+    SetHeader(String2HeaderType(name, nameSize), name, nameSize, value, valueEnd - value);
+    return true;
+}
+
+void HttpHeader::SetComplete(size_t headerSize)
+{
+    m_headerSize = headerSize;
+    m_complete = true;
+}
+
 
 
 HttpHeader::HeaderType HttpHeader::String2HeaderType(const std::string &str)
 {
-    switch(_(str.c_str()))
-    {
-        case _("Accept"):              return HttpHeader::HeaderType::Accept;
-        case _("Accept-Charset"):      return HttpHeader::HeaderType::AcceptCharset;
-        case _("Accept-Encoding"):     return HttpHeader::HeaderType::AcceptEncoding;
-        case _("Accept-Datetime"):     return HttpHeader::HeaderType::AcceptDatetime;
-        case _("Accept-Language"):     return HttpHeader::HeaderType::AcceptLanguage;
-        case _("Authorization"):       return HttpHeader::HeaderType::Authorization;
-        case _("Cache-Control"):       return HttpHeader::HeaderType::CacheControl;
-        case _("Connection"):          return HttpHeader::HeaderType::Connection;
-        case _("Content-Encoding"):    return HttpHeader::HeaderType::ContentEncoding;
-        case _("Content-Length"):      return HttpHeader::HeaderType::ContentLength;
-        case _("Content-MD5"):         return HttpHeader::HeaderType::ContentMD5;
-        case _("Content-Type"):        return HttpHeader::HeaderType::ContentType;
-        case _("Cookie"):              return HttpHeader::HeaderType::Cookie;
-        case _("Date"):                return HttpHeader::HeaderType::Date;
-        case _("Expect"):              return HttpHeader::HeaderType::Expect;
-        case _("Forwarded"):           return HttpHeader::HeaderType::Forwarded;
-        case _("From"):                return HttpHeader::HeaderType::From;
-        case _("HTTP2-Settings"):      return HttpHeader::HeaderType::HTTP2Settings;
-        case _("Host"):                return HttpHeader::HeaderType::Host;
-        case _("If-Match"):            return HttpHeader::HeaderType::IfMatch;
-        case _("If-Modified-Since"):   return HttpHeader::HeaderType::IfModifiedSince;
-        case _("If-None-Match"):       return HttpHeader::HeaderType::IfNoneMatch;
-        case _("If-Range"):            return HttpHeader::HeaderType::IfRange;
-        case _("If-Unmodified-Since"): return HttpHeader::HeaderType::IfUnmodifiedSince;
-        case _("Max-Forwards"):        return HttpHeader::HeaderType::MaxForwards;
-        case _("Origin"):              return HttpHeader::HeaderType::Origin;
-        case _("Pragma"):              return HttpHeader::HeaderType::Pragma;
-        case _("Prefer"):              return HttpHeader::HeaderType::Prefer;
-        case _("Proxy-Authorization"): return HttpHeader::HeaderType::ProxyAuthorization;
-        case _("Range"):               return HttpHeader::HeaderType::Range;
-        case _("Referer"):             return HttpHeader::HeaderType::Referer;
-        case _("TE"):                  return HttpHeader::HeaderType::TE;
-        case _("Trailer"):             return HttpHeader::HeaderType::Trailer;
-        case _("TransferEncoding"):    return HttpHeader::HeaderType::TransferEncoding;
-        case _("User-Agent"):          return HttpHeader::HeaderType::UserAgent;
-        case _("Upgrade"):             return HttpHeader::HeaderType::Upgrade;
-        case _("Via"):                 return HttpHeader::HeaderType::Via;
-        case _("Warning"):             return HttpHeader::HeaderType::Warning;
-
-        case _("Accept-CH"):                       return HeaderType::AcceptCH;
-        case _("Access-Control-Allow-Origin"):     return HeaderType::AccessControlAllowOrigin;
-        case _("Access-Control-Allow-Credential"): return HeaderType::AccessControlAllowCredentials;
-        case _("Access-Control-Expose-Headers"):   return HeaderType::AccessControlExposeHeaders;
-        case _("Access-Control-Max-Age"):          return HeaderType::AccessControlMaxAge;
-        case _("Access-Control-Allow-Methods"):    return HeaderType::AccessControlAllowMethods;
-        case _("Access-Control-Allow-Headers"):    return HeaderType::AccessControlAllowHeaders;
-        case _("Accept-Patch"):                    return HeaderType::AcceptPatch;
-        case _("Accept-Ranges"):                   return HeaderType::AcceptRanges;
-        case _("Age"):                             return HeaderType::Age;
-        case _("Allow"):                           return HeaderType::Allow;
-        case _("Alt-Svc"):                         return HeaderType::AltSvc;
-        case _("Content-Disposition"):             return HeaderType::ContentDisposition;
-        case _("Content-Language"):                return HeaderType::ContentLanguage;
-        case _("Content-Location"):                return HeaderType::ContentLocation;
-        case _("Content-Range"):                   return HeaderType::ContentRange;
-        case _("Delta-Base"):                      return HeaderType::DeltaBase;
-        case _("ETag"):                            return HeaderType::ETag;
-        case _("Expires"):                         return HeaderType::Expires;
-        case _("IM"):                              return HeaderType::IM;
-        case _("Last-Modified"):                   return HeaderType::LastModified;
-        case _("Link"):                            return HeaderType::Link;
-        case _("Location"):                        return HeaderType::Location;
-        case _("P3P"):                             return HeaderType::P3P;
-        case _("Preference-Applied"):              return HeaderType::PreferenceApplied;
-        case _("Proxy-Authenticate"):              return HeaderType::ProxyAuthenticate;
-        case _("Public-Key-Pins"):                 return HeaderType::PublicKeyPins;
-        case _("Retry-After"):                     return HeaderType::RetryAfter;
-        case _("Server"):                          return HeaderType::Server;
-        case _("Set-Cookie"):                      return HeaderType::SetCookie;
-        case _("Strict-Transport-Security"):       return HeaderType::StrictTransportSecurity;
-        case _("Transfer-Encoding"):               return HeaderType::TransferEncoding;
-        case _("Tk"):                              return HeaderType::Tk;
-        case _("Vary"):                            return HeaderType::Vary;
-        case _("WWW-Authenticate"):                return HeaderType::WWWAuthenticate;
-        case _("X-Frame-Options"):                 return HeaderType::XFrameOptions;
+    return String2HeaderType(str.data(), str.size());
+}
 
-        default: break;
+HttpHeader::HeaderType HttpHeader::String2HeaderType(const char *str, size_t size)
+{
+    // one probe into the table, the name found there is compared to the string to reject the unknown ones
+    const HeaderTable &table = GetHeaderTable();
+    HeaderType type = table.slots[HashName(str, size, table.seed) & (HEADER_TABLE_SIZE - 1)];
+    if(type != HeaderType::Undefined)
+    {
+        const std::string &name = HeaderTypeName(type);
+        if(name.size() == size && IsEqualNoCase(name.data(), str, size))
+        {
+            return type;
+        }
     }
 
-    return HttpHeader::HeaderType::Undefined;
+    return HeaderType::Undefined;
 }
 
 std::string HttpHeader::HeaderType2String(HttpHeader::HeaderType headerType)
@@ -295,43 +424,124 @@ std::string HttpHeader::HeaderType2String(HttpHeader::HeaderType headerType)
     return "";
 }
 
+const std::string &HttpHeader::HeaderTypeName(HeaderType headerType)
+{
+    // the names of the known headers are built once and then copied from here
+    static const std::vector<std::string> names = []()
+    {
+        std::vector<std::string> list;
+        for(int i = static_cast<int>(HeaderType::Undefined);i <= static_cast<int>(HeaderType::XFrameOptions);i ++)
+        {
+            list.push_back(HeaderType2String(static_cast<HeaderType>(i)));
+        }
+        return list;
+    }();
+
+    size_t index = static_cast<size_t>(headerType);
+    return index < names.size() ? names[index] : names[0];
+}
+
 std::string HttpHeader::ToString() const
 {
-    return "Header (" + std::to_string(m_headers.size()) + " records, ver. " + m_version + ", size: " + std::to_string(m_headerSize) + ")";
+    return "Header (" + std::to_string(m_count) + " records, ver. " + m_version + ", size: " + std::to_string(m_headerSize) + ")";
 }
 
-const std::vector<HttpHeader::Header> &HttpHeader::GetHeaders() const
+std::vector<HttpHeader::Header> HttpHeader::GetHeaders() const
 {
-    return m_headers;
+    std::vector<HttpHeader::Header> headers;
+    headers.reserve(m_count);
+    for(size_t i = 1;i < HeaderTypeCount;i ++)
+    {
+        if(m_known[i].exists)
+        {
+            HttpHeader::Header header;
+            header.type = static_cast<HeaderType>(i);
+            header.name = HeaderTypeName(header.type);
+            header.value = ToString(m_known[i]);
+            headers.push_back(std::move(header));
+        }
+    }
+    for(auto &entry: m_unknown)
+    {
+        HttpHeader::Header header;
+        header.name = ToString(entry.name);
+        header.value = ToString(entry.value);
+        headers.push_back(std::move(header));
+    }
+
+    return headers;
 }
 
 void HttpHeader::SetHeader(HeaderType type, const std::string &value)
 {
-    SetHeader(HeaderType2String(type), value);
+    if(type == HeaderType::Undefined)
+    {
+        return;
+    }
+
+    const std::string &name = HeaderTypeName(type);
+    SetHeader(type, name.data(), name.size(), value.data(), value.size());
 }
 
 void HttpHeader::SetHeader(const std::string &name, const std::string &value)
 {
-    for(auto &header: m_headers)
+    SetHeader(String2HeaderType(name), name.data(), name.size(), value.data(), value.size());
+}
+
+void HttpHeader::SetHeader(HeaderType type, const char *name, size_t nameSize, const char *value, size_t valueSize)
+{
+    // a known header goes to its slot, the name is taken from the table when the header is written
+    size_t index = static_cast<size_t>(type);
+    if(type != HeaderType::Undefined && index < HeaderTypeCount)
     {
-        if(header.name == name)
+        if(m_known[index].exists == false)
         {
-            header.value = value;
-            return;
+            m_count ++;
         }
+        Assign(m_known[index], value, valueSize);
+        return;
+    }
+
+    size_t found = FindEntry(name, nameSize);
+    if(found != SIZE_MAX)
+    {
+        Assign(m_unknown[found].value, value, valueSize);
+        return;
+    }
+
+    if(m_unknown.capacity() == 0)
+    {
+        m_unknown.reserve(DEFAULT_UNKNOWN_HEADERS);
+    }
+    Entry entry;
+    entry.hash = HashName(name, nameSize, 0);
+    Assign(entry.name, name, nameSize);
+    Assign(entry.value, value, valueSize);
+    m_unknown.push_back(entry);
+    m_count ++;
+}
+
+void HttpHeader::RemoveHeader(HeaderType type)
+{
+    size_t index = static_cast<size_t>(type);
+    if(type != HeaderType::Undefined && index < HeaderTypeCount && m_known[index].exists)
+    {
+        m_known[index].exists = false;
+        m_count --;
     }
-    HttpHeader::Header header;
-    header.type = String2HeaderType(name);
-    header.name = name;
-    header.value = value;
-    m_headers.push_back(std::move(header));
 }
 
 void HttpHeader::Clear()
 {
     m_role = HeaderRole::Undefined;
     m_complete = false;
-    m_headers.clear();
+    m_data.clear();
+    for(auto &slice: m_known)
+    {
+        slice = Slice();
+    }
+    m_unknown.clear();
+    m_count = 0;
     m_version = "HTTP/1.1";
     m_headerSize = 0;
     m_remoteAddress = "";
@@ -341,17 +551,27 @@ void HttpHeader::Clear()
 
 std::string HttpHeader::GetHeader(HeaderType headerType) const
 {
-    return GetHeader(HttpHeader::HeaderType2String(headerType));
+    size_t index = static_cast<size_t>(headerType);
+    if(index < HeaderTypeCount)
+    {
+        return ToString(m_known[index]);
+    }
+
+    return "";
 }
 
 std::string HttpHeader::GetHeader(const std::string &headerType) const
 {
-    for(auto &header: m_headers)
+    HeaderType type = String2HeaderType(headerType);
+    if(type != HeaderType::Undefined)
     {
-        if(header.name == headerType)
-        {
-            return header.value;
-        }
+        return GetHeader(type);
+    }
+
+    size_t found = FindEntry(headerType.data(), headerType.size());
+    if(found != SIZE_MAX)
+    {
+        return ToString(m_unknown[found].value);
     }
 
     return "";
@@ -359,12 +579,22 @@ std::string HttpHeader::GetHeader(const std::string &headerType) const
 
 std::vector<std::string> HttpHeader::GetAllHeaders(const std::string &headerType) const
 {
+    // a header is stored once, the last value wins
     std::vector<std::string> value;
-    for(auto &header: m_headers)
+    HeaderType type = String2HeaderType(headerType);
+    if(type != HeaderType::Undefined)
+    {
+        if(m_known[static_cast<size_t>(type)].exists)
+        {
+            value.push_back(ToString(m_known[static_cast<size_t>(type)]));
+        }
+    }
+    else
     {
-        if(header.name == headerType)
+        size_t found = FindEntry(headerType.data(), headerType.size());
+        if(found != SIZE_MAX)
         {
-            value.push_back(header.value);
+            value.push_back(ToString(m_unknown[found].value));
         }
     }
 
@@ -412,5 +642,56 @@ int HttpHeader::GetRemotePort() const
 
 int HttpHeader::GetCount() const
 {
-    return m_headers.size();
+    return static_cast<int>(m_count);
+}
+
+void HttpHeader::Assign(Slice &slice, const char *str, size_t size)
+{
+    // a shorter value overwrites the old one, a longer one is appended to the data
+    if(slice.exists && size <= slice.length)
+    {
+        memcpy(m_data.data() + slice.offset, str, size);
+    }
+    else
+    {
+        if(m_data.capacity() == 0)
+        {
+            m_data.reserve(DEFAULT_HEADER_DATA_SIZE);
+        }
+        slice.offset = m_data.size();
+        m_data.insert(m_data.end(), str, str + size);
+    }
+    slice.length = size;
+    slice.exists = true;
+}
+
+std::string HttpHeader::ToString(const Slice &slice) const
+{
+    if(slice.exists == false)
+    {
+        return "";
+    }
+
+    return std::string(m_data.begin() + slice.offset, m_data.begin() + slice.offset + slice.length);
+}
+
+bool HttpHeader::IsEqual(const Slice &slice, const char *str, size_t size) const
+{
+    // the header names are case-insensitive
+    return slice.length == size && IsEqualNoCase(reinterpret_cast<const char *>(m_data.data()) + slice.offset, str, size);
+}
+
+size_t HttpHeader::FindEntry(const char *name, size_t size) const
+{
+    // the hashes are compared first, the names only when they match
+    uint32_t hash = HashName(name, size, 0);
+    for(size_t i = 0;i < m_unknown.size();i ++)
+    {
+        if(m_unknown[i].hash == hash && IsEqual(m_unknown[i].name, name, size))
+        {
+            return i;
+        }
+    }
+
+    return SIZE_MAX;
 }
@@ -7,7 +7,6 @@
 #include "FileSystem.h"
 #include "StringUtil.h"
 #include "Request.h"
-#include "KeepAliveTimer.h"
 #include "Data.h"
 #include "HttpServer.h"
 #include "IHttp.h"
@@ -52,6 +51,9 @@ bool WebCpp::HttpServer::Init()
 
     m_server->SetPort(m_config.GetHttpServerPort());
     m_server->SetHost(m_config.GetHttpServerAddress());
+    m_server->SetMaxConnections(m_config.GetMaxConnections());
+    m_server->SetReactorCount(m_config.GetReactorCount());
+    m_server->SetWriteWatermarks(m_config.GetWriteHighWatermark(), m_config.GetWriteLowWatermark());
 
     if(!m_server->Init())
     {
@@ -70,17 +72,21 @@ bool WebCpp::HttpServer::Init()
     m_server->SetDataReadyCallback(f2);
     auto f3 = std::bind(&HttpServer::OnClosed, this, std::placeholders::_1);
     m_server->SetCloseConnectionCallback(f3);
+    auto f4 = std::bind(&HttpServer::OnHeaderReceived, this, std::placeholders::_1, std::placeholders::_2);
+    m_sessions.SetHeaderCallback(f4);
 
     if(StartRequestThread() == false)
     {
         return false;
     }
 
-    if(m_config.GetKeepAliveTimeout() != 0)
+    auto f = std::bind(&HttpServer::ProcessTimeout, this, std::placeholders::_1, std::placeholders::_2);
+    m_timers.SetCallback(f);
+    if(m_timers.Start() == false)
     {
-        auto f = std::bind(&HttpServer::ProcessKeepAlive, this, std::placeholders::_1);
-        KeepAliveTimer::SetCallback(f);
-        KeepAliveTimer::run();
+        SetLastError("failed to run timers: " + m_timers.GetLastError());
+        LOG(GetLastError(), LogWriter::LogType::Error);
+        return false;
     }
 
     return true;
@@ -104,8 +110,9 @@ bool HttpServer::Run()
 
 bool HttpServer::Close(bool wait)
 {
+    // the reactors are joined first, they post the stream drains to the workers
     m_server->Close(wait);
-    KeepAliveTimer::stop();
+    m_timers.Stop();
     StopRequestThread();
     return true;
 }
@@ -120,6 +127,7 @@ HttpServer &HttpServer::OnGet(const std::string &path, const RouteHttp::RouteFun
     RouteHttp route(path, Http::Method::GET, needAuth);
     LOG("register route: " + route.ToString(), LogWriter::LogType::Info);
     route.SetFunction(f);
+    m_routeTree.Add(m_routes.size(), route);
     m_routes.push_back(std::move(route));
 
     return *this;
@@ -130,6 +138,21 @@ HttpServer &HttpServer::OnPost(const std::string &path, const RouteHttp::RouteFu
     RouteHttp route(path, Http::Method::POST, needAuth);
     LOG("register route: " + route.ToString(), LogWriter::LogType::Info);
     route.SetFunction(f);
+    m_routeTree.Add(m_routes.size(), route);
+    m_routes.push_back(std::move(route));
+    return *this;
+}
+
+HttpServer &HttpServer::OnPostStream(const std::string &path, const RouteHttp::BodyFunc &body, const RouteHttp::RouteFunc &f, bool needAuth)
+{
+    // the body is passed to the body function by chunks as it's received,
+    // the route function is called when it's complete
+    RouteHttp route(path, Http::Method::POST, needAuth);
+    LOG("register streaming route: " + route.ToString(), LogWriter::LogType::Info);
+    route.SetBodyFunction(body);
+    route.SetFunction(f);
+    m_routeTree.Add(m_routes.size(), route);
+    m_streamRouteTree.Add(m_routes.size(), route);
     m_routes.push_back(std::move(route));
     return *this;
 }
@@ -163,13 +186,18 @@ bool HttpServer::SendResponse(Response &response)
     return true;
 }
 
+ThreadPool::Metrics HttpServer::GetWorkerMetrics() const
+{
+    return m_workers.GetMetrics();
+}
+
 void HttpServer::OnConnected(int connID, const std::string &remote)
 {
     LOG(std::string("client connected: #") + std::to_string(connID) + ", " + remote, LogWriter::LogType::Access);
     PutToQueue(connID, remote);
     if(m_config.GetKeepAliveTimeout() > 0)
     {
-        KeepAliveTimer::SetTimer(m_config.GetKeepAliveTimeout(), connID);
+        m_timers.SetTimer(connID, TimerWheel::Type::KeepAlive, m_config.GetKeepAliveTimeout());
     }
 }
 
@@ -180,13 +208,79 @@ void HttpServer::OnDataReady(int connID, ByteArray &data)
 }
 
 void HttpServer::OnClosed(int connID)
-{    
-    m_sessions.RemoveSession(connID);
+{
+    m_timers.CancelTimers(connID);
+    RemoveFromQueue(connID);
     LOG(std::string("http connection closed: #") + std::to_string(connID), LogWriter::LogType::Access);
 }
 
+void HttpServer::OnHeaderReceived(const std::shared_ptr<Session> &session, Request &request)
+{
+    std::vector<RouteTree::Match> matches;
+    const std::string path = request.GetUrl().GetPath();
+    m_streamRouteTree.Find(request.GetMethod(), path, matches);
+    for(auto &match: matches)
+    {
+        auto &route = m_routes[match.index];
+        if(match.verify && route.IsMatch(request) == false)
+        {
+            continue;
+        }
+        RouteTree::SetArgs(match, path, request);
+
+        int connID = session->connID;
+        std::weak_ptr<Session> weakSession = session;
+        auto stream = std::make_shared<BodyStream>(&request, route.GetBodyFunction(), m_config.GetStreamHighWatermark(), m_config.GetStreamLowWatermark());
+        std::weak_ptr<BodyStream> weakStream = stream;
+        if(route.IsUseAuth())
+        {
+            // the auth handler is called by the first drain on a worker, the reactor doesn't wait for it.
+            // If it fails the body is dropped, ProcessRequest() answers the request with the same result
+            Request *ptr = &request;
+            stream->SetCheckFunction([this, ptr]() -> bool
+            {
+                return CheckAuth(*ptr);
+            });
+        }
+        stream->SetPauseFunction([this, weakSession](bool pause)
+        {
+            // a drain can finish after the connection was closed and its ID given to another one
+            auto session = weakSession.lock();
+            if(session != nullptr)
+            {
+                Lock lock(session->pauseMutex);
+                if(session->closed == false)
+                {
+                    m_server->PauseReading(session->connID, pause);
+                }
+            }
+        });
+        stream->SetScheduleFunction([this, connID, weakSession, weakStream]() -> bool
+        {
+            // the task holds the session, so the request survives closing the connection
+            auto session = weakSession.lock();
+            auto stream = weakStream.lock();
+            if(session == nullptr || stream == nullptr)
+            {
+                return false;
+            }
+            return m_workers.Post(static_cast<size_t>(connID), [session, stream]() { stream->Drain(); });
+        });
+        request.SetBodyStream(stream);
+        break;
+    }
+}
+
 bool HttpServer::StartRequestThread()
 {
+    m_workers.SetThreadCount(m_config.GetWorkerCount());
+    if(m_workers.Start() == false)
+    {
+        SetLastError("failed to run request workers: " + m_workers.GetLastError());
+        LOG(GetLastError(), LogWriter::LogType::Error);
+        return false;
+    }
+
     auto f = std::bind(&HttpServer::RequestThread, this, std::placeholders::_1);
     m_requestThread.SetFunction(f);
     if(m_requestThread.Start() == false)
@@ -207,6 +301,7 @@ bool HttpServer::StopRequestThread()
         SendSignal();
         m_requestThread.Wait();
     }
+    m_workers.Stop();
     return true;
 }
 
@@ -231,32 +326,117 @@ void HttpServer::PutToQueue(int connID, const std::string &remote)
     m_sessions.AddNewSession(connID, remote);
 }
 
-void HttpServer::AppendData(int connID, const ByteArray &data)
+void HttpServer::AppendData(int connID, ByteArray &data)
 {
-    Lock lock(m_queueMutex);
-    m_sessions.AppendData(connID, data);
+    SessionManager::ReceiveState state;
+    {
+        Lock lock(m_queueMutex);
+        m_sessions.AppendData(connID, data);
+        state = m_sessions.GetReceiveState(connID);
+        UpdatePause(connID);
+    }
+    UpdateReceiveTimers(connID, state);
 }
 
 bool HttpServer::IsQueueEmpty()
 {
     Lock lock(m_queueMutex);
-    return m_sessions.IsEmpty();
+    return !m_sessions.HasReadyRequests();
 }
 
-bool HttpServer::CheckDataFullness()
+std::vector<std::unique_ptr<Request>> HttpServer::GetNextRequests(std::shared_ptr<Session> &session)
 {
     Lock lock(m_queueMutex);
-    bool retval = false;
+    return m_sessions.GetReadyRequests(session);
+}
 
-    retval = m_sessions.Process();
+void HttpServer::DispatchRequests(std::vector<std::unique_ptr<Request>> requests, const std::shared_ptr<Session> &session)
+{
+    // the task holds the session so it survives closing the connection while the requests are processed
+    auto batch = std::make_shared<std::vector<std::unique_ptr<Request>>>(std::move(requests));
+    auto task = [this, batch, session]()
+    {
+        std::vector<std::unique_ptr<Response>> responses;
+        int connID = session->connID;
+        bool close = false;
+        for(auto &request: *batch)
+        {
+            std::unique_ptr<Response> response(new Response(request->GetConnectionID(), m_config));
+            response->SetSession(request->GetSession());
+            if(request->GetParseError() != 0)
+            {
+                // the last one of the connection, nothing after it was parsed
+                LOG("#" + std::to_string(connID) + ": " + request->GetLastError(), LogWriter::LogType::Access);
+                response->SetResponseCode(request->GetParseError());
+                response->AddHeader(HttpHeader::HeaderType::ContentLength, "0");
+                response->AddHeader(HttpHeader::HeaderType::Connection, "close");
+                responses.push_back(std::move(response));
+                close = true;
+                break;
+            }
+            response->SetRequest(*request);
+            // a streaming response sends the ones gathered before it first
+            response->SetStream(m_server.get(), [this, &responses, connID]()
+            {
+                SendResponses(connID, responses);
+                responses.clear();
+            });
+            ProcessRequest(*request, *response);
+            if(response->IsStreaming() && response->End() == false)
+            {
+                LOG("Error sending response: " + response->GetLastError(), LogWriter::LogType::Error);
+            }
+            responses.push_back(std::move(response));
+        }
+        SendResponses(connID, responses);
+        if(close && IsSessionOpened(session))
+        {
+            m_server->CloseAfterWrite(connID);
+        }
+        FinishRequest(session);
+    };
 
-    return retval;
+    if(m_workers.Post(static_cast<size_t>(session->connID), task) == false)
+    {
+        FinishRequest(session);
+    }
 }
 
-std::unique_ptr<Request> HttpServer::GetNextRequest()
+void HttpServer::FinishRequest(const std::shared_ptr<Session> &session)
 {
+    // the connection ID can belong to another connection already
+    SessionManager::ReceiveState state = SessionManager::ReceiveState::Processing;
+    {
+        Lock lock(m_queueMutex);
+        if(m_sessions.ReleaseSession(session.get()))
+        {
+            state = m_sessions.GetReceiveState(session->connID);
+            UpdatePause(session->connID);
+        }
+    }
+    if(state == SessionManager::ReceiveState::Idle && m_config.GetKeepAliveTimeout() > 0)
+    {
+        m_timers.SetTimer(session->connID, TimerWheel::Type::KeepAlive, m_config.GetKeepAliveTimeout());
+    }
+    // the next pipelined request of the connection can be dispatched now
+    SendSignal();
+}
+
+void HttpServer::UpdatePause(int connID)
+{
+    // called with the queue locked so the pause and the resume of the pipeline come in order
+    bool pause;
+    if(m_sessions.UpdatePause(connID, pause))
+    {
+        m_server->PauseReading(connID, pause);
+    }
+}
+
+bool HttpServer::IsSessionOpened(const std::shared_ptr<Session> &session)
+{
+    // the connection ID can belong to another connection already
     Lock lock(m_queueMutex);
-    return m_sessions.GetReadyRequest();
+    return (m_sessions.GetSession(session->connID) == session);
 }
 
 void HttpServer::RemoveFromQueue(int connID)
@@ -273,10 +453,12 @@ void *HttpServer::RequestThread(bool &running)
         WaitForSignal();
         if(running)
         {
-            if(CheckDataFullness())
+            std::shared_ptr<Session> session;
+            auto requests = GetNextRequests(session);
+            while(requests.empty() == false)
             {
-                auto request = GetNextRequest();
-                ProcessRequest(*request);
+                DispatchRequests(std::move(requests), session);
+                requests = GetNextRequests(session);
             }
         }
     }
@@ -284,17 +466,16 @@ void *HttpServer::RequestThread(bool &running)
     return nullptr;
 }
 
-void HttpServer::ProcessRequest(Request &request)
+void HttpServer::ProcessRequest(Request &request, Response &response)
 {
     bool processed = false;
     bool isFinal = false;
+    int authorized = -1; // the auth doesn't depend on the route, it's checked once per request
 
-    Response response(request.GetConnectionID(), m_config);
-    response.SetSession(request.GetSession());
-
-    if(m_config.GetKeepAliveTimeout() > 0)
+    if(request.GetBodyStream() != nullptr)
     {
-        KeepAliveTimer::SetTimer(m_config.GetKeepAliveTimeout(), request.GetConnectionID());
+        // the route function is called after the handler got the whole body
+        request.GetBodyStream()->Drain();
     }
 
     if(m_preRoute != nullptr)
@@ -304,32 +485,20 @@ void HttpServer::ProcessRequest(Request &request)
 
     if(processed == false)
     {
-        for(auto &route: m_routes)
+        // only the routes the path matches are visited, in the order they were added
+        std::vector<RouteTree::Match> matches;
+        const std::string path = request.GetUrl().GetPath();
+        m_routeTree.Find(request.GetMethod(), path, matches);
+        for(auto &match: matches)
         {
-            if(route.IsMatch(request))
+            auto &route = m_routes[match.index];
+            if(match.verify == false || route.IsMatch(request))
             {
-                if(route.IsUseAuth() == true)
+                RouteTree::SetArgs(match, path, request);
+                if(route.IsUseAuth() == true && IsAuthorized(request, authorized) == false)
                 {
-                    auto session = request.GetSession();
-                    if(session->authProvider.IsInitialized() == false)
-                    {
-                        session->authProvider.Init();
-                    }
-                    bool authSuccessful = false;
-
-                    if(request.CheckAuth() == true)
-                    {
-                        if(m_authHandler != nullptr)
-                        {
-                            authSuccessful = m_authHandler(request, session->authProvider.GetPreferred());
-                        }
-                    }
-
-                    if(authSuccessful == false)
-                    {
-                        response.NotAuthenticated();
-                        isFinal = true;
-                    }
+                    response.NotAuthenticated();
+                    isFinal = true;
                 }
                 auto &f = route.GetFunction();
                 if(f != nullptr)
@@ -361,15 +530,152 @@ void HttpServer::ProcessRequest(Request &request)
     }
 
     LOG("#" + std::to_string(request.GetConnectionID()) + ": " +  request.GetUrl().GetPath() + (processed ? ", processed" : ", not processed"), LogWriter::LogType::Access);
+}
+
+bool HttpServer::CheckAuth(Request &request)
+{
+    auto session = request.GetSession();
+    Lock lock(session->authMutex);
+    if(session->authProvider.IsInitialized() == false)
+    {
+        session->authProvider.Init();
+    }
+
+    if(request.CheckAuth() == true && m_authHandler != nullptr)
+    {
+        return m_authHandler(request, session->authProvider.GetPreferred());
+    }
+
+    return false;
+}
+
+bool HttpServer::IsAuthorized(Request &request, int &authorized)
+{
+    if(authorized == -1)
+    {
+        // a streaming route has checked it already
+        bool passed = false;
+        auto stream = request.GetBodyStream();
+        if(stream == nullptr || stream->GetCheckResult(passed) == false)
+        {
+            passed = CheckAuth(request);
+        }
+        authorized = (passed ? 1 : 0);
+    }
 
-    SendResponse(response);
+    return (authorized == 1);
 }
 
-void HttpServer::ProcessKeepAlive(int connID)
+void HttpServer::SendResponses(int connID, const std::vector<std::unique_ptr<Response>> &responses)
 {
+    if(m_config.GetWriteTimeout() > 0)
+    {
+        m_timers.SetTimer(connID, TimerWheel::Type::Write, m_config.GetWriteTimeout());
+    }
 
-    m_server->CloseConnection(connID);
-    RemoveFromQueue(connID);
+    // the responses to the pipelined requests are gathered and written with one call,
+    // a file goes after everything gathered before it
+    std::vector<struct iovec> buffers;
+    std::string date = FileSystem::GetDateTime();
+    for(auto &response: responses)
+    {
+        if(response->IsShouldSend() == false)
+        {
+            continue;
+        }
+        response->AddHeader(HttpHeader::HeaderType::Date, date);
+        response->AppendBuffers(buffers);
+        if(response->HasFile())
+        {
+            if(m_server->Write(connID, buffers) == false)
+            {
+                LOG("Error sending response: " + m_server->GetLastError(), LogWriter::LogType::Error);
+            }
+            buffers.clear();
+            if(response->SendFile(m_server.get()) == false)
+            {
+                LOG("Error sending response: " + response->GetLastError(), LogWriter::LogType::Error);
+            }
+        }
+    }
+    if(buffers.empty() == false && m_server->Write(connID, buffers) == false)
+    {
+        LOG("Error sending response: " + m_server->GetLastError(), LogWriter::LogType::Error);
+    }
+
+    if(m_server->IsWritePending(connID) == false)
+    {
+        m_timers.CancelTimer(connID, TimerWheel::Type::Write);
+    }
+}
+
+void HttpServer::UpdateReceiveTimers(int connID, SessionManager::ReceiveState state)
+{
+    if(state != SessionManager::ReceiveState::Idle)
+    {
+        // the keep-alive timer is started again when the last response is sent
+        m_timers.CancelTimer(connID, TimerWheel::Type::KeepAlive);
+    }
+
+    switch(state)
+    {
+        case SessionManager::ReceiveState::Idle:
+            m_timers.CancelTimer(connID, TimerWheel::Type::Header);
+            m_timers.CancelTimer(connID, TimerWheel::Type::Read);
+            if(m_config.GetKeepAliveTimeout() > 0)
+            {
+                m_timers.SetTimer(connID, TimerWheel::Type::KeepAlive, m_config.GetKeepAliveTimeout());
+            }
+            break;
+        case SessionManager::ReceiveState::Header:
+            if(m_config.GetHeaderTimeout() > 0)
+            {
+                // started once for the first bytes of a request, a slow client can't prolong it
+                m_timers.SetTimer(connID, TimerWheel::Type::Header, m_config.GetHeaderTimeout(), false);
+            }
+            if(m_config.GetReadTimeout() > 0)
+            {
+                m_timers.SetTimer(connID, TimerWheel::Type::Read, m_config.GetReadTimeout());
+            }
+            break;
+        case SessionManager::ReceiveState::Body:
+            m_timers.CancelTimer(connID, TimerWheel::Type::Header);
+            if(m_config.GetReadTimeout() > 0)
+            {
+                m_timers.SetTimer(connID, TimerWheel::Type::Read, m_config.GetReadTimeout());
+            }
+            break;
+        default:
+            m_timers.CancelTimer(connID, TimerWheel::Type::Header);
+            m_timers.CancelTimer(connID, TimerWheel::Type::Read);
+            break;
+    }
+}
+
+void HttpServer::ProcessTimeout(int connID, TimerWheel::Type type)
+{
+    if(type == TimerWheel::Type::KeepAlive && m_server->IsWritePending(connID))
+    {
+        // a big response is still being sent, the connection isn't idle
+        m_timers.SetTimer(connID, type, m_config.GetKeepAliveTimeout());
+        return;
+    }
+    if(type == TimerWheel::Type::Write)
+    {
+        // the response is queued, the connection is closed only if the client stopped taking it
+        if(m_server->IsWritePending(connID) == false)
+        {
+            return;
+        }
+        if(m_server->GetWriteProgress(connID) > 0)
+        {
+            m_timers.SetTimer(connID, type, m_config.GetWriteTimeout());
+            return;
+        }
+    }
+
+    LOG("#" + std::to_string(connID) + ": " + TimerWheel::Type2String(type) + " timeout, closing the connection", LogWriter::LogType::Access);
+    m_server->CloseConnection(connID); // OnClosed() cleans the session up
 }
 
 std::string HttpServer::ToString() const
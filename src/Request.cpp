@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstring>
 #include "Request.h"
 #include "IHttp.h"
 #include "Session.h"
@@ -17,64 +18,202 @@ Request::Request():
 }
 
 bool Request::Parse(const ByteArray &data)
+{
+    size_t consumed;
+    ParseResult result;
+    do
+    {
+        result = Parse(data, consumed);
+    }
+    while(result == ParseResult::Header);
+    return (result == ParseResult::Complete);
+}
+
+Request::ParseResult Request::Parse(const ByteArray &data, size_t &consumed)
 {
     ClearError();
+    consumed = 0;
 
-    if(m_requestLineLength == 0)
+    // the request line and the header are parsed line by line, the position
+    // is saved so the next call only looks at the data appended since
+    size_t maxHeaderSize = HttpConfig::Instance().GetMaxHeaderSize();
+    while(m_parseState == ParseState::RequestLine || m_parseState == ParseState::Header)
     {
-        if(ParseRequestLine(data, m_requestLineLength) == false)
+        const void *ptr = nullptr;
+        if(m_parsePos < data.size())
         {
-            SetLastError("Request: error parsing request line: " + GetLastError());
-            return false;
+            ptr = memchr(data.data() + m_parsePos, LF, data.size() - m_parsePos);
+        }
+        // a header that never ends isn't kept growing until the timeout
+        size_t end = (ptr == nullptr ? data.size() : static_cast<const uint8_t *>(ptr) - data.data() + 1);
+        if(end > maxHeaderSize)
+        {
+            SetLastError("Request: the header is larger than " + std::to_string(maxHeaderSize) + " bytes");
+            m_parseError = 431;
+            m_parseState = ParseState::Error;
+            break;
+        }
+        if(ptr == nullptr)
+        {
+            m_parsePos = data.size();
+            return ParseResult::NeedMore;
+        }
+
+        size_t lineStart = m_lineStart;
+        size_t lineEnd = static_cast<const uint8_t *>(ptr) - data.data();
+        m_lineStart = m_parsePos = lineEnd + 1;
+        if(lineEnd > lineStart && data[lineEnd - 1] == CR)
+        {
+            lineEnd --;
+        }
+
+        if(m_parseState == ParseState::RequestLine)
+        {
+            if(lineEnd == lineStart) // empty lines before the request line are ignored
+            {
+                continue;
+            }
+            if(ParseRequestLine(data, lineStart, lineEnd) == false)
+            {
+                SetLastError("Request: error parsing request line: " + GetLastError());
+                m_parseState = ParseState::Error;
+                break;
+            }
+            m_requestLineLength = lineEnd - lineStart;
+            m_headerStart = m_lineStart;
+            m_parseState = ParseState::Header;
+        }
+        else if(lineEnd == lineStart) // empty line, the end of the header
+        {
+            m_header.SetComplete(lineStart > m_headerStart ? lineStart - EOL_LENGTH - m_headerStart : 0);
+            m_bodyOffset = m_lineStart;
+            m_parseState = ParseState::Body;
+            m_chunked = IsChunked();
+            if(m_chunked || m_header.GetBodySize() > 0)
+            {
+                // the caller can route the body before it's parsed
+                m_parseState = ParseState::BodyBegin;
+                return ParseResult::Header;
+            }
+        }
+        else
+        {
+            m_header.ParseLine(data, StringUtil::Range { lineStart, lineEnd - 1 });
         }
     }
-    if(m_header.IsComplete() == false)
+
+    if(m_parseState == ParseState::BodyBegin)
     {
-        if(m_header.Parse(data, m_requestLineLength + EOL_LENGTH) == false)
+        if(m_bodyStream == nullptr && BeginBody() == false)
         {
-            SetLastError("Request: error parsing header: " + GetLastError());
-            return false;
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
         }
+        m_parseState = ParseState::Body;
     }
 
-    if(m_header.GetBodySize() > 0)
+    if(m_parseState == ParseState::Body && m_chunked)
     {
-        return ParseBody(data, m_requestLineLength + EOL_LENGTH + m_header.GetHeaderSize() + ENTRY_DELIMITER_LENGTH);
+        // the chunks are decoded in place, the wire bytes used so far are consumed
+        // while an incomplete size line stays in the data until the rest arrives
+        size_t pos = m_bodyOffset + m_bodyReceived - m_released;
+        size_t used = 0;
+        auto result = m_chunkedDecoder.Decode(data, pos, data.size() - pos, used,
+                                              std::bind(&Request::PassBody, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        m_bodyReceived += used;
+        consumed = pos + used;
+        m_released += consumed;
+
+        if(result == ChunkedDecoder::Result::Error)
+        {
+            if(GetLastError().empty())
+            {
+                SetLastError("chunked body error: " + m_chunkedDecoder.GetLastError());
+            }
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
+        }
+        if(result == ChunkedDecoder::Result::NeedMore)
+        {
+            return ParseResult::NeedMore;
+        }
+
+        m_header.SetChunckedSize(m_chunkedDecoder.GetDecodedSize());
+        if(m_bodyStream == nullptr && m_requestBody.EndParse() == false)
+        {
+            SetLastError("body parsing error: " + m_requestBody.GetLastError());
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
+        }
+        m_parseState = ParseState::Complete;
+        return ParseResult::Complete;
     }
 
-    return true;
+    if(m_parseState == ParseState::Body)
+    {
+        // the body is parsed as it arrives, the bytes passed to the parser
+        // are reported as consumed so the caller can release them
+        size_t bodySize = m_header.GetBodySize();
+        size_t pos = m_bodyOffset + m_bodyReceived - m_released;
+        size_t size = std::min(data.size() - pos, bodySize - m_bodyReceived);
+        if(size > 0 && PassBody(data, pos, size) == false)
+        {
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
+        }
+        m_bodyReceived += size;
+        consumed = pos + size;
+        m_released += consumed;
+
+        if(m_bodyReceived < bodySize)
+        {
+            return ParseResult::NeedMore;
+        }
+
+        if(bodySize > 0 && m_bodyStream == nullptr && m_requestBody.EndParse() == false)
+        {
+            SetLastError("body parsing error: " + m_requestBody.GetLastError());
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
+        }
+        m_parseState = ParseState::Complete;
+        return ParseResult::Complete;
+    }
+
+    if(m_parseState == ParseState::Complete)
+    {
+        return ParseResult::Complete; // all the bytes were already reported
+    }
+
+    return ParseResult::Error;
 }
 
-bool Request::ParseRequestLine(const ByteArray &data, size_t &pos)
+bool Request::ParseRequestLine(const ByteArray &data, size_t start, size_t end)
 {
-    pos = StringUtil::SearchPosition(data, { CR, LF });
-    if(pos != SIZE_MAX) // request line presents
+    auto ranges = StringUtil::Split(data, { ' ' }, start, end - 1);
+    if(ranges.size() == 3)
     {
-        auto ranges = StringUtil::Split(data, { ' ' }, 0, pos);
-        if(ranges.size() == 3)
-        {                  
-            m_method = Http::String2Method(std::string(data.begin() + ranges[0].start, data.begin() + ranges[0].end + 1));
-            if(m_method == Http::Method::Undefined)
-            {
-                SetLastError("wrong method");
-                return false;
-            }
-            m_url.Parse(std::string(data.begin() + ranges[1].start, data.begin() + ranges[1].end + 1), false);
-            if(m_url.IsInitiaized() == false)
-            {
-                SetLastError("wrong URL");
-                return false;
-            }
-            m_httpVersion = std::string(data.begin() + ranges[2].start, data.begin() + ranges[2].end + 1);
-            StringUtil::Trim(m_httpVersion);
-            return true;
+        m_method = Http::String2Method(std::string(data.begin() + ranges[0].start, data.begin() + ranges[0].end + 1));
+        if(m_method == Http::Method::Undefined)
+        {
+            SetLastError("wrong method");
+            return false;
+        }
+        m_url.Parse(std::string(data.begin() + ranges[1].start, data.begin() + ranges[1].end + 1), false);
+        if(m_url.IsInitiaized() == false)
+        {
+            SetLastError("wrong URL");
+            return false;
         }
+        m_httpVersion = std::string(data.begin() + ranges[2].start, data.begin() + ranges[2].end + 1);
+        StringUtil::Trim(m_httpVersion);
+        return true;
     }
 
+    SetLastError("wrong format");
     return false;
 }
 
-
 Request::Request(int connID, const std::string &remote):
     m_connID(connID),
     m_header(HttpHeader::HeaderRole::Request)
@@ -127,11 +266,23 @@ std::string Request::GetHttpVersion() const
 }
 
 
-bool Request::ParseBody(const ByteArray &data, size_t headerSize)
+bool Request::BeginBody()
 {
     WebCpp::HttpConfig &config = WebCpp::HttpConfig::Instance();
     auto contentType = m_header.GetHeader(HttpHeader::HeaderType::ContentType);
-    if(m_requestBody.Parse(data, headerSize, ByteArray(contentType.begin(), contentType.end()), config.GetTempFile()) == false)
+    if(m_requestBody.BeginParse(ByteArray(contentType.begin(), contentType.end()), config.GetTempFile(),
+                                config.GetMaxBodyFileSize(), config.GetMaxBodySize()) == false)
+    {
+        SetLastError("body parsing error: " + m_requestBody.GetLastError());
+        return false;
+    }
+
+    return true;
+}
+
+bool Request::ParseBody(const ByteArray &data, size_t offset, size_t size)
+{
+    if(m_requestBody.ParseChunk(data, offset, size) == false)
     {
         SetLastError("body parsing error: " + m_requestBody.GetLastError());
         return false;
@@ -140,6 +291,25 @@ bool Request::ParseBody(const ByteArray &data, size_t headerSize)
     return true;
 }
 
+bool Request::PassBody(const ByteArray &data, size_t offset, size_t size)
+{
+    if(m_bodyStream != nullptr)
+    {
+        m_bodyStream->Push(data, offset, size);
+        return true;
+    }
+
+    return ParseBody(data, offset, size);
+}
+
+bool Request::IsChunked() const
+{
+    // chunked has priority over Content-Length (RFC 7230, 3.3.3)
+    std::string encoding = m_header.GetHeader(HttpHeader::HeaderType::TransferEncoding);
+    StringUtil::ToLower(encoding);
+    return encoding.find("chunked") != std::string::npos;
+}
+
 const RequestBody &Request::GetRequestBody() const
 {
     return m_requestBody;
@@ -150,6 +320,16 @@ RequestBody &Request::GetRequestBody()
     return m_requestBody;
 }
 
+void Request::SetBodyStream(const std::shared_ptr<BodyStream> &stream)
+{
+    m_bodyStream = stream;
+}
+
+const std::shared_ptr<BodyStream> &Request::GetBodyStream() const
+{
+    return m_bodyStream;
+}
+
 void Request::SetArg(const std::string &name, const std::string &value)
 {
     m_args[name] = value;
@@ -172,10 +352,20 @@ size_t Request::GetRequestLineLength() const
 
 size_t Request::GetRequestSize() const
 {
+    if(m_bodyOffset > 0)
+    {
+        // everything before the body as it was received + Body
+        return m_bodyOffset + (m_chunked ? m_bodyReceived : m_header.GetBodySize());
+    }
     // Request line + CRLF (2 bytes) + Header + CRLFCRLF (4 bytes) + Body
     return m_requestLineLength + EOL_LENGTH + m_header.GetHeaderSize() + ENTRY_DELIMITER_LENGTH + m_header.GetBodySize();
 }
 
+uint16_t Request::GetParseError() const
+{
+    return (m_parseState == ParseState::Error ? m_parseError : 0);
+}
+
 std::string Request::GetRemote() const
 {
     return m_remote;
@@ -252,8 +442,19 @@ void Request::Clear()
     m_url.Clear();
     m_header.Clear();
     m_requestLineLength = 0;
+    m_parseState = ParseState::RequestLine;
+    m_parseError = 400;
+    m_parsePos = 0;
+    m_lineStart = 0;
+    m_headerStart = 0;
+    m_bodyOffset = 0;
+    m_bodyReceived = 0;
+    m_released = 0;
+    m_chunked = false;
+    m_chunkedDecoder.Reset();
     m_args.clear();
     m_requestBody.Clear();
+    m_bodyStream.reset();
     m_remote = "";
     m_session = nullptr;
 }
@@ -290,15 +491,7 @@ ByteArray Request::BuildRequestLine() const
 
 ByteArray Request::BuildHeaders() const
 {
-    auto &header = GetHeader();
-
-    std::string headers;
-    for(auto &entry: header.GetHeaders())
-    {
-        headers += entry.name + ": " + entry.value + CR + LF;
-    }
-
-    return ByteArray(headers.begin(), headers.end());
+    return GetHeader().ToByteArray();
 }
 
 std::string Request::ToString() const
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "common_webcpp.h"
 //#include <fstream>
 #include "StringUtil.h"
@@ -6,10 +7,56 @@
 #include "File.h"
 
 #define WRITE_BIFFER_SIZE 1024
+#define EOL_LENGTH 2
+#define MAX_PART_HEADER_SIZE 8192
 
 
 using namespace WebCpp;
 
+struct RequestBody::ParseContext
+{
+    enum class State
+    {
+        Preamble = 0,
+        Boundary,
+        PartHeader,
+        PartData,
+        Epilogue,
+    };
+
+    State state = State::Preamble;
+    ByteArray contentType;
+    ByteArray boundary;  // "--" boundary
+    ByteArray delimiter; // CRLF "--" boundary
+    ByteArray buffer;    // the tail of the previous chunk that can't be parsed yet
+    ByteArray pending;   // not multipart body, parsed when it's complete
+    bool useTempFile = false;
+    size_t maxFileSize = SIZE_MAX;
+    size_t maxValueSize = SIZE_MAX;
+    std::unique_ptr<File> file; // the temporary file of the current part
+    size_t partSize = 0;
+    bool isFile = false;
+    bool skip = false;
+};
+
+static const ByteArray HeaderDelimiter = { CRLFCRLF };
+
+// the position of a possible partial delimiter at the end of the chunk, the bytes
+// from it are kept until the next chunk shows whether the delimiter is there
+static size_t HoldBack(const ByteArray &data, size_t pos, size_t end, const ByteArray &delimiter)
+{
+    size_t start = (end - pos >= delimiter.size()) ? end - delimiter.size() + 1 : pos;
+    for(size_t i = start;i < end;i ++)
+    {
+        if(data[i] == delimiter[0] && memcmp(data.data() + i, delimiter.data(), end - i) == 0)
+        {
+            return i;
+        }
+    }
+
+    return end;
+}
+
 RequestBody::ContentValue RequestBody::ContentValue::defaultValue = {};
 
 RequestBody::RequestBody()
@@ -19,6 +66,7 @@ RequestBody::RequestBody()
 
 RequestBody::~RequestBody()
 {
+    m_context.reset();
     if(!m_tempFolder.empty() && FileSystem::IsFileExist(m_tempFolder))
     {
         FileSystem::DeleteFolder(m_tempFolder);
@@ -30,6 +78,7 @@ RequestBody::RequestBody(RequestBody &&other)
     m_values = std::move(other.m_values);
     m_contentType = other.m_contentType;
     m_tempFolder = other.m_tempFolder;
+    m_context = std::move(other.m_context);
 
     other.m_contentType = ContentType::Undefined;
     other.m_tempFolder = "";
@@ -40,6 +89,7 @@ RequestBody &RequestBody::operator=(RequestBody &&other)
     m_values = std::move(other.m_values);
     m_contentType = other.m_contentType;
     m_tempFolder = other.m_tempFolder;
+    m_context = std::move(other.m_context);
 
     other.m_values.clear();
     other.m_values.shrink_to_fit();
@@ -49,10 +99,28 @@ RequestBody &RequestBody::operator=(RequestBody &&other)
     return *this;
 }
 
-bool RequestBody::Parse(const ByteArray &data, size_t offset, const ByteArray &contentType, bool useTempFile)
+bool RequestBody::Parse(const ByteArray &data, size_t offset, size_t size, const ByteArray &contentType, bool useTempFile)
 {
     ClearError();
-    bool retval = false;
+
+    if(size == 0 || offset + size > data.size())
+    {
+        SetLastError("wrong body size");
+        return false;
+    }
+
+    return BeginParse(contentType, useTempFile) && ParseChunk(data, offset, size) && EndParse();
+}
+
+bool RequestBody::BeginParse(const ByteArray &contentType, bool useTempFile, size_t maxFileSize, size_t maxValueSize)
+{
+    ClearError();
+
+    m_context.reset(new ParseContext());
+    m_context->contentType = contentType;
+    m_context->useTempFile = useTempFile;
+    m_context->maxFileSize = maxFileSize;
+    m_context->maxValueSize = maxValueSize;
 
     if(useTempFile)
     {
@@ -64,109 +132,323 @@ bool RequestBody::Parse(const ByteArray &data, size_t offset, const ByteArray &c
         }
     }
 
-    auto type = ParseContentType(contentType);
+    m_contentType = ParseContentType(contentType);
+    if(m_contentType == ContentType::FormData)
+    {
+        auto headers = ParseFields(contentType);
+        auto boundary = GetHeader("boundary", headers);
+        if(boundary.empty())
+        {
+            // nothing can be parsed, the body is skipped
+            SetLastError("boundary not defined");
+            m_context->state = ParseContext::State::Epilogue;
+            return true;
+        }
+
+        std::string delimiter = std::string { CRLF } + "--" + boundary;
+        m_context->delimiter = ByteArray(delimiter.begin(), delimiter.end());
+        m_context->boundary = ByteArray(delimiter.begin() + EOL_LENGTH, delimiter.end());
+    }
 
-    switch(type)
+    return true;
+}
+
+bool RequestBody::ParseChunk(const ByteArray &data, size_t offset, size_t size)
+{
+    if(m_context == nullptr)
+    {
+        SetLastError("parsing isn't started");
+        return false;
+    }
+    if(offset + size > data.size())
+    {
+        SetLastError("wrong body size");
+        return false;
+    }
+
+    if(m_contentType != ContentType::FormData)
+    {
+        // the other types are parsed when the body is complete
+        m_context->pending.insert(m_context->pending.end(), data.begin() + offset, data.begin() + offset + size);
+        return true;
+    }
+
+    // the chunk is parsed in place, only the bytes that can't be
+    // processed yet (a partial delimiter or part header) are copied
+    ByteArray &buffer = m_context->buffer;
+    if(buffer.empty())
+    {
+        size_t pos = offset;
+        if(ParseFormData(data, pos, offset + size) == false)
+        {
+            return false;
+        }
+        buffer.assign(data.begin() + pos, data.begin() + offset + size);
+    }
+    else
+    {
+        buffer.insert(buffer.end(), data.begin() + offset, data.begin() + offset + size);
+        size_t pos = 0;
+        if(ParseFormData(buffer, pos, buffer.size()) == false)
+        {
+            return false;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + pos);
+    }
+
+    return true;
+}
+
+bool RequestBody::EndParse()
+{
+    if(m_context == nullptr)
+    {
+        SetLastError("parsing isn't started");
+        return false;
+    }
+
+    bool retval = true;
+    ParseContext &context = *m_context;
+
+    switch(m_contentType)
     {
         case ContentType::FormData:
-            retval = ParseFormData(data, offset, contentType, useTempFile);
+            // the body has no final delimiter, the part received so far is kept
+            if(context.state == ParseContext::State::PartData)
+            {
+                EndPart();
+            }
             break;
-        case  ContentType::UrlEncoded:
-            retval = ParseUrlEncoded(data, offset, contentType);
+        case ContentType::UrlEncoded:
+            if(!context.pending.empty())
+            {
+                retval = ParseUrlEncoded(context.pending, 0, context.pending.size(), context.contentType);
+            }
             break;
         case ContentType::Text:
-            retval = ParseText(data, offset, contentType);
-        default:
-            SetLastError("undefined content type");
+        default: // JSON, binary etc. are kept as is
+            m_contentType = ContentType::Text;
+            m_values.push_back(ContentValue {
+                                   "",
+                                   std::string(context.contentType.begin(), context.contentType.end()),
+                                   "",
+                                   std::move(context.pending)
+                               });
             break;
-
     }
 
+    m_context.reset();
     return retval;
 }
 
-bool RequestBody::ParseFormData(const ByteArray &data, size_t offset, const ByteArray &contentType, bool useTempFile)
+bool RequestBody::ParseFormData(const ByteArray &data, size_t &pos, size_t end)
 {
-    bool retval = true;
+    ParseContext &context = *m_context;
 
-    m_contentType = ContentType::FormData;
-    auto headers = ParseFields(contentType);
-    auto boundary = GetHeader("boundary", headers);
-
-    if(!boundary.empty())
+    while(pos < end)
     {
-        std::string commonBoundary =  "--" + boundary + std::string { CRLF };
-        std::string finalBoundary = "--" + boundary + "--";
-        size_t end = StringUtil::SearchPositionReverse(data, ByteArray(finalBoundary.begin(), finalBoundary.end()));
-        if(end != SIZE_MAX)
+        switch(context.state)
         {
-            end = end - 1;
-        }
-
-        auto ranges = StringUtil::SplitReverse(data, ByteArray(commonBoundary.begin(), commonBoundary.end()), offset, end);
-        for(auto &range: ranges)
-        {
-            if(range.end > range.start)
+            case ParseContext::State::Preamble:
+            {
+                // the first boundary has no CRLF before it, the preamble is ignored
+                size_t found = StringUtil::SearchPosition(data, context.boundary, pos, end - 1);
+                if(found == SIZE_MAX)
+                {
+                    pos = HoldBack(data, pos, end, context.boundary);
+                    return true;
+                }
+                pos = found + context.boundary.size();
+                context.state = ParseContext::State::Boundary;
+                break;
+            }
+            case ParseContext::State::Boundary:
             {
-                auto chunkHeaderPos = StringUtil::SearchPosition(data, ByteArray{ CRLFCRLF }, range.start, range.end);
-                if(chunkHeaderPos != SIZE_MAX)
+                // the boundary is followed by "--" for the last part or by CRLF
+                if(end - pos < 2)
                 {
-                    auto chunkHeader = ByteArray(data.begin() + range.start, data.begin() + chunkHeaderPos);
-                    auto chunkHeaders = ParseHeaders(chunkHeader);
-                    std::string name,filename;
-                    std::string contentType = GetHeader("Content-Type", chunkHeaders);
-                    auto contentDisposition = GetHeader("Content-Disposition", chunkHeaders);
-                    if(!contentDisposition.empty())
+                    return true;
+                }
+                if(data[pos] == '-' && data[pos + 1] == '-')
+                {
+                    context.state = ParseContext::State::Epilogue;
+                    break;
+                }
+                const void *ptr = memchr(data.data() + pos, LF, end - pos);
+                if(ptr == nullptr)
+                {
+                    if(end - pos > MAX_PART_HEADER_SIZE)
                     {
-                        auto contentDispositionFields = ParseFields(ByteArray(contentDisposition.begin(), contentDisposition.end()));
-                        name = GetHeader("name", contentDispositionFields);
-                        filename = GetHeader("filename", contentDispositionFields);
-                        StringUtil::Trim(filename,"\" ");
-
-                        if(useTempFile && !filename.empty())
-                        {
-                            File file(m_tempFolder + "/" + filename, File::Mode::Write);
-                            file.Write(reinterpret_cast<const char*>(data.data() + chunkHeaderPos + 4), range.end - 1 - (chunkHeaderPos + 4));
-
-                            m_values.push_back(ContentValue {
-                                                   name,
-                                                   contentType,
-                                                   filename,
-                                                   {} });
-                        }
-                        else
+                        SetLastError("wrong boundary line");
+                        return false;
+                    }
+                    return true;
+                }
+                pos = static_cast<const uint8_t *>(ptr) - data.data() + 1;
+                context.state = ParseContext::State::PartHeader;
+                break;
+            }
+            case ParseContext::State::PartHeader:
+            {
+                size_t headerEnd, dataStart;
+                if(end - pos >= EOL_LENGTH && data[pos] == CR && data[pos + 1] == LF)
+                {
+                    // the part has no header
+                    headerEnd = pos;
+                    dataStart = pos + EOL_LENGTH;
+                }
+                else
+                {
+                    size_t found = StringUtil::SearchPosition(data, HeaderDelimiter, pos, end - 1);
+                    if(found == SIZE_MAX)
+                    {
+                        if(end - pos > MAX_PART_HEADER_SIZE)
                         {
-                            m_values.push_back(ContentValue {
-                                                   name,
-                                                   contentType,
-                                                   filename,
-                                                   ByteArray(data.begin() + chunkHeaderPos + 4, data.begin() + range.end - 1) });
+                            SetLastError("part header too large");
+                            return false;
                         }
+                        return true;
                     }
+                    headerEnd = found;
+                    dataStart = found + HeaderDelimiter.size();
+                }
+                if(BeginPart(data, pos, headerEnd) == false)
+                {
+                    return false;
                 }
+                pos = dataStart;
+                context.state = ParseContext::State::PartData;
+                break;
             }
+            case ParseContext::State::PartData:
+            {
+                size_t found = StringUtil::SearchPosition(data, context.delimiter, pos, end - 1);
+                if(found == SIZE_MAX)
+                {
+                    size_t keep = HoldBack(data, pos, end, context.delimiter);
+                    bool retval = WritePart(data, pos, keep);
+                    pos = keep;
+                    return retval;
+                }
+                if(WritePart(data, pos, found) == false)
+                {
+                    return false;
+                }
+                EndPart();
+                pos = found + context.delimiter.size();
+                context.state = ParseContext::State::Boundary;
+                break;
+            }
+            case ParseContext::State::Epilogue:
+                pos = end;
+                break;
+        }
+    }
+
+    return true;
+}
+
+bool RequestBody::BeginPart(const ByteArray &data, size_t start, size_t end)
+{
+    ParseContext &context = *m_context;
+
+    auto headers = ParseHeaders(ByteArray(data.begin() + start, data.begin() + end));
+    auto contentDisposition = GetHeader("Content-Disposition", headers);
+    context.skip = contentDisposition.empty();
+    context.partSize = 0;
+    if(context.skip)
+    {
+        return true;
+    }
+
+    auto contentDispositionFields = ParseFields(ByteArray(contentDisposition.begin(), contentDisposition.end()));
+    std::string name = GetHeader("name", contentDispositionFields);
+    std::string filename = GetHeader("filename", contentDispositionFields);
+    StringUtil::Trim(filename,"\" ");
+    context.isFile = !filename.empty();
+
+    if(context.useTempFile && context.isFile)
+    {
+        // the file is written while the part is received
+        std::string path = m_tempFolder + FileSystem::PathDelimiter() + FileSystem::ExtractFileName(filename);
+        context.file.reset(new File(path, File::Mode::Write));
+        if(context.file->IsOpened() == false)
+        {
+            SetLastError("error creating temporary file: " + context.file->GetLastError());
+            context.file.reset();
+            return false;
+        }
+    }
+
+    m_values.push_back(ContentValue {
+                           name,
+                           GetHeader("Content-Type", headers),
+                           filename,
+                           {} });
+
+    return true;
+}
+
+bool RequestBody::WritePart(const ByteArray &data, size_t start, size_t end)
+{
+    ParseContext &context = *m_context;
+    if(context.skip || start >= end)
+    {
+        return true;
+    }
+
+    size_t size = end - start;
+    context.partSize += size;
+    if(context.partSize > (context.isFile ? context.maxFileSize : context.maxValueSize))
+    {
+        SetLastError(context.isFile ? "file too large" : "value too large");
+        return false;
+    }
+
+    if(context.file != nullptr)
+    {
+        if(context.file->Write(reinterpret_cast<const char *>(data.data() + start), size) != size)
+        {
+            SetLastError("error writing temporary file");
+            return false;
         }
     }
     else
     {
-        SetLastError("boundary not defined");
+        auto &value = m_values.back().data;
+        value.insert(value.end(), data.begin() + start, data.begin() + end);
     }
 
-    return retval;
+    return true;
 }
 
-bool RequestBody::ParseUrlEncoded(const ByteArray &data, size_t offset, const ByteArray &contentType)
+void RequestBody::EndPart()
+{
+    m_context->file.reset();
+    m_context->skip = false;
+    m_context->isFile = false;
+}
+
+bool RequestBody::ParseUrlEncoded(const ByteArray &data, size_t offset, size_t size, const ByteArray &contentType)
 {
     bool retval = true;
 
     m_contentType = ContentType::UrlEncoded;
-    auto end = StringUtil::SearchPositionReverse(data, { CRLF }, offset);
+    auto end = StringUtil::SearchPositionReverse(data, { CRLF }, offset, offset + size - 1);
+    if(end == SIZE_MAX)
+    {
+        end = offset + size - 1;
+    }
     auto values = StringUtil::Split(data, {'&'}, offset, end);
     if(values.size() > 0)
     {
         for(auto &value: values)
         {
             auto pair = StringUtil::Split(data, {'='}, value.start, value.end);
+            if(pair.empty())
+            {
+                continue;
+            }
 
             std::string name(data.begin() + pair.at(0).start ,data.begin() + pair.at(0).end + 1);
             std::string val = pair.size() > 1 ? std::string(data.begin() + pair.at(1).start ,data.begin() + pair.at(1).end + 1) : "";
@@ -183,21 +465,6 @@ bool RequestBody::ParseUrlEncoded(const ByteArray &data, size_t offset, const By
     return retval;
 }
 
-bool RequestBody::ParseText(const ByteArray &data, size_t offset, const ByteArray &contentType)
-{
-    bool retval = true;
-
-    m_contentType = ContentType::Text;
-    m_values.push_back(ContentValue {
-                           "",
-                           std::string(contentType.begin(), contentType.end()),
-                           "",
-                           ByteArray(data.begin() + offset, data.end())
-                       });
-    retval = true;
-    return retval;
-}
-
 RequestBody::ContentType RequestBody::GetContentType() const
 {
     return m_contentType;
@@ -290,6 +557,7 @@ void RequestBody::Clear()
     m_contentType = ContentType::Undefined;
     m_tempFolder = "";
     m_boundary = "";
+    m_context.reset();
 }
 
 ByteArray RequestBody::GetDataUrlUncoded() const
@@ -1,14 +1,22 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include "common_webcpp.h"
 #include "defines_webcpp.h"
 #include "FileSystem.h"
-#include "File.h"
 #include "Response.h"
+#include "Request.h"
 #include "IHttp.h"
-#include "Data.h"
 #include "SessionManager.h"
 #include "DebugPrint.h"
+#include "Platform.h"
+#include "CompressionCache.h"
+#include "StringUtil.h"
+#include "Lock.h"
 
-#define WRITE_BIFFER_SIZE 1024
+
+#define EOL_LENGTH 2
 
 
 using namespace WebCpp;
@@ -33,7 +41,7 @@ void Response::AddHeader(const std::string &name, const std::string &value)
 
 void Response::AddHeader(HttpHeader::HeaderType header, const std::string &value)
 {
-    AddHeader(HttpHeader::HeaderType2String(header), value);
+    m_header.SetHeader(header, value);
 }
 
 void Response::Write(const ByteArray &data, size_t start)
@@ -49,34 +57,96 @@ void Response::Write(const std::string &data)
 
 bool Response::AddFile(const std::string &file, const std::string &charset)
 {
-    bool retval = false;
-    std::string path;
+    // the metadata and a small file itself come from the cache, a hit costs no file I/O
+    auto &cache = FileCache::Instance();
+    auto entry = cache.Get(file);
+    if(entry == nullptr)
+    {
+        entry = cache.Get(FileSystem::NormalizePath(m_config.GetRoot()) + file);
+    }
+    if(entry == nullptr)
+    {
+        SetLastError("file not exist");
+        return false;
+    }
 
-    if(FileSystem::IsFileExist(file) == false)
+    auto content = entry;
+    std::string etag = entry->etag;
+    bool ranged = (m_conditional && m_range.empty() == false);
+    AddHeader(HttpHeader::HeaderType::ContentType, entry->mimeType + ";charset=" + charset);
+    AddHeader(HttpHeader::HeaderType::LastModified, entry->lastModified);
+#ifdef WITH_ZLIB
+    // a text file is sent as its gzip variant, it's compressed only once.
+    // The ranges are always of the file itself
+    bool negotiable = (IsCompressionNegotiable() &&
+                       entry->size >= m_config.GetCompressionMinSize() && entry->size <= m_config.GetCompressionMaxFileSize());
+    if(negotiable)
     {
-        std::string root = FileSystem::NormalizePath(m_config.GetRoot());
-        path = root + file;
+        // the identity and the 304 responses depend on Accept-Encoding as well
+        AddHeader(HttpHeader::HeaderType::Vary, "Accept-Encoding");
     }
-    else
+    if(negotiable && ranged == false && m_encoding == EncodingType::Gzip)
+    {
+        std::string variant = CompressionCache::Instance().Get(entry->path, entry->size, entry->modified);
+        if(variant.empty() == false)
+        {
+            auto compressed = cache.Get(variant);
+            if(compressed != nullptr)
+            {
+                AddHeader(HttpHeader::HeaderType::ContentEncoding, EncodingType2String(m_encoding));
+                etag.insert(etag.size() - 1, "-gz"); // another representation has another tag
+                content = compressed;
+            }
+            else
+            {
+                CompressionCache::Instance().Remove(entry->path); // deleted, it's compressed again next time
+            }
+        }
+    }
+#endif
+    AddHeader(HttpHeader::HeaderType::ETag, etag);
+
+    if(IsNotModified(etag, entry->modified))
+    {
+        SetResponseCode(304);
+        m_header.RemoveHeader(HttpHeader::HeaderType::ContentType);
+        m_header.RemoveHeader(HttpHeader::HeaderType::ContentEncoding);
+        return true;
+    }
+
+    size_t length = content->size;
+    AddHeader(HttpHeader::HeaderType::AcceptRanges, "bytes");
+    if(ranged && IsRangeAllowed(etag, entry->lastModified))
     {
-        path = file;
+        switch(ParseRange(m_range, content->size))
+        {
+            case RangeResult::Unsatisfiable:
+                SetResponseCode(416);
+                m_header.RemoveHeader(HttpHeader::HeaderType::ContentType);
+                AddHeader(HttpHeader::HeaderType::ContentRange, "bytes */" + std::to_string(content->size));
+                AddHeader(HttpHeader::HeaderType::ContentLength, "0");
+                return true;
+            case RangeResult::Partial:
+                SetResponseCode(206);
+                length = PrepareRanges(content->size, m_header.GetHeader(HttpHeader::HeaderType::ContentType));
+                break;
+            default:
+                break;
+        }
     }
 
-    if(FileSystem::IsFileExist(path))
+    AddHeader(HttpHeader::HeaderType::ContentLength, std::to_string(length));
+    if(content->loaded)
     {
-        std::string ext = FileSystem::ExtractFileExtension(path);
-        AddHeader(HttpHeader::HeaderType::ContentType, Response::Extension2MimeType(ext) + ";charset=" + charset);
-        AddHeader(HttpHeader::HeaderType::ContentLength, std::to_string(FileSystem::GetFileSize(path)));
-        AddHeader(HttpHeader::HeaderType::LastModified, FileSystem::GetFileModifiedTime(path));
-        m_file = path;
-        retval = true;
+        m_cachedFile = content;
     }
     else
     {
-        SetLastError("file not exist");
+        m_file = content->path;
+        m_fileSize = content->size;
     }
 
-    return retval;
+    return true;
 }
 
 bool Response::NotFound()
@@ -111,6 +181,7 @@ bool Response::NotAuthenticated()
 
     if(m_session != nullptr)
     {
+        Lock lock(m_session->authMutex);
         auto &list = m_session->authProvider;
         for(auto &auth: list.Get())
         {
@@ -170,206 +241,885 @@ void Response::SetShouldSend(bool value)
 
 bool Response::Send(ICommunicationServer *communication)
 {
-    ByteArray header;
+    std::vector<struct iovec> buffers;
+    AppendBuffers(buffers);
 
-    const ByteArray &sl = BuildStatusLine();
-    header.insert(header.end(), sl.begin(), sl.end());
+    if(communication->Write(m_connID, buffers) == false)
+    {
+        SetLastError("error sending response: " + communication->GetLastError());
+        return false;
+    }
 
-    const ByteArray &hdr = BuildHeaders();
-    header.insert(header.end(), hdr.begin(), hdr.end());
-    header.push_back(CR);
-    header.push_back(LF);
+    return SendFile(communication);
+}
+
+bool Response::HasFile() const
+{
+    return !m_file.empty();
+}
 
-    if(communication->Write(m_connID, header) == false)
+void Response::AppendBuffers(std::vector<struct iovec> &buffers)
+{
+    if(m_file.empty() && m_body.size() >= m_config.GetCompressionMinSize() && IsCompressionNegotiable())
     {
-        SetLastError("error sending header: " + communication->GetLastError());
-        return false;
+        // the body varies on Accept-Encoding even if this client gets it uncompressed
+        AddHeader(HttpHeader::HeaderType::Vary, "Accept-Encoding");
+        if(m_encoding != EncodingType::Undefined)
+        {
+            CompressBody();
+        }
     }
 
-    if(!m_file.empty())
+    // the buffers point to the response data so it must stay unchanged until they are written
+    m_headerData.clear();
+    AppendStatusLine(m_headerData);
+    m_header.Serialize(m_headerData);
+    m_headerData.push_back(CR);
+    m_headerData.push_back(LF);
+
+    struct iovec buffer;
+    buffer.iov_base = m_headerData.data();
+    buffer.iov_len = m_headerData.size();
+    buffers.push_back(buffer);
+
+    if(m_cachedFile != nullptr)
     {
-        ByteArray buffer(WRITE_BIFFER_SIZE);
-        if(FileSystem::IsFileExist(m_file))
+        uint8_t *content = const_cast<uint8_t *>(m_cachedFile->content.data());
+        if(m_ranges.empty())
         {
-            size_t size = FileSystem::GetFileSize(m_file);
-            File file(m_file, File::Mode::Read);
-            if(file.IsOpened())
+            if(m_cachedFile->size > 0)
             {
-                size_t pos = 0;
-                while(pos < size)
+                buffer.iov_base = content;
+                buffer.iov_len = m_cachedFile->content.size();
+                buffers.push_back(buffer);
+            }
+        }
+        else
+        {
+            for(auto &range: m_ranges)
+            {
+                if(range.headerSize > 0)
                 {
-                    ssize_t bytes = file.Read(reinterpret_cast<char *>(buffer.data()), WRITE_BIFFER_SIZE);
-                    if(bytes == ERROR)
-                    {
-                        break;
-                    }
-                    pos += bytes;
-                    if(communication->Write(m_connID, buffer, bytes) == false)
-                    {
-                        SetLastError("error sending file: " + communication->GetLastError());
-                        return false;
-                    }
+                    buffer.iov_base = m_rangeData.data() + range.header;
+                    buffer.iov_len = range.headerSize;
+                    buffers.push_back(buffer);
                 }
+                buffer.iov_base = content + range.offset;
+                buffer.iov_len = range.size;
+                buffers.push_back(buffer);
             }
-            else
+            size_t tail = m_ranges.back().header + m_ranges.back().headerSize;
+            if(tail < m_rangeData.size())
             {
-                SetLastError("file " + m_file + " failed to open");
-                return false;
+                buffer.iov_base = m_rangeData.data() + tail;
+                buffer.iov_len = m_rangeData.size() - tail;
+                buffers.push_back(buffer);
             }
         }
-        else
+    }
+    else if(m_file.empty() && m_body.size() > 0)
+    {
+        buffer.iov_base = m_body.data();
+        buffer.iov_len = m_body.size();
+        buffers.push_back(buffer);
+    }
+}
+
+bool Response::SendFile(ICommunicationServer *communication)
+{
+    if(m_file.empty())
+    {
+        return true;
+    }
+
+    // the file isn't read here, the connection sends it straight from the page cache,
+    // the size is the one the header was made with
+    if(m_ranges.empty())
+    {
+        if(m_fileSize > 0 && communication->WriteFile(m_connID, m_file, 0, m_fileSize) == false)
         {
-            SetLastError("file " + m_file + " not exists");
+            SetLastError("error sending file: " + communication->GetLastError());
             return false;
         }
+        return true;
     }
-    else if(m_body.size() > 0)
+
+    // the part headers are queued between the pieces of the file
+    std::vector<struct iovec> buffers(1);
+    for(auto &range: m_ranges)
     {
-        if(communication->Write(m_connID, m_body) == false)
+        buffers[0].iov_base = m_rangeData.data() + range.header;
+        buffers[0].iov_len = range.headerSize;
+        if((range.headerSize > 0 && communication->Write(m_connID, buffers) == false) ||
+           communication->WriteFile(m_connID, m_file, range.offset, range.size) == false)
         {
-            SetLastError("error sending body: " + communication->GetLastError());
+            SetLastError("error sending file: " + communication->GetLastError());
             return false;
         }
     }
+    size_t tail = m_ranges.back().header + m_ranges.back().headerSize;
+    buffers[0].iov_base = m_rangeData.data() + tail;
+    buffers[0].iov_len = m_rangeData.size() - tail;
+    if(tail < m_rangeData.size() && communication->Write(m_connID, buffers) == false)
+    {
+        SetLastError("error sending file: " + communication->GetLastError());
+        return false;
+    }
 
     return true;
 }
 
-bool Response::Parse(const ByteArray &data, size_t* all, size_t* downoaded)
+void Response::SetStream(ICommunicationServer *communication, const std::function<void()> &flush)
+{
+    m_communication = communication;
+    m_flush = flush;
+}
+
+bool Response::WriteChunk(const ByteArray &data, size_t start)
 {
     ClearError();
-    size_t pos;
 
-    if(ParseStatusLine(data, pos) == false)
+    bool withHeader = false;
+    if(m_streaming == false)
+    {
+        if(BeginStream() == false)
+        {
+            return false;
+        }
+        withHeader = true;
+    }
+
+    if(start >= data.size())
+    {
+        // nothing to send, but the header goes out anyway
+        return withHeader ? SendChunk(nullptr, 0, true) : true;
+    }
+
+    return SendChunk(data.data() + start, data.size() - start, withHeader);
+}
+
+bool Response::WriteChunk(const std::string &data)
+{
+    return WriteChunk(ByteArray(data.begin(), data.end()));
+}
+
+bool Response::End()
+{
+    if(m_streaming == false)
+    {
+        return true;
+    }
+
+    // the last chunk, there are no trailers
+    m_streaming = false;
+    m_shouldSend = false;
+    ByteArray last;
+#ifdef WITH_ZLIB
+    if(m_compressor != nullptr)
     {
-        SetLastError("error parsing status line: " + GetLastError());
+        // the rest of the compressed data goes before it
+        ByteArray tail;
+        m_compressor->Finish(tail);
+        m_compressor.reset();
+        char size[32];
+        int length = snprintf(size, sizeof(size), "%zx\r\n", tail.size());
+        last.insert(last.end(), size, size + length);
+        last.insert(last.end(), tail.begin(), tail.end());
+        last.push_back(CR);
+        last.push_back(LF);
+    }
+#endif
+    last.push_back('0');
+    last.push_back(CR);
+    last.push_back(LF);
+    last.push_back(CR);
+    last.push_back(LF);
+    if(m_communication->Write(m_connID, last) == false)
+    {
+        SetLastError("error sending last chunk: " + m_communication->GetLastError());
         return false;
     }
 
-    if(m_header.IsComplete() == false)
+    return true;
+}
+
+bool Response::IsStreaming() const
+{
+    return m_streaming;
+}
+
+void Response::SetAcceptEncoding(const std::string &value)
+{
+    m_encoding = NegotiateEncoding(value);
+}
+
+void Response::SetRequest(const Request &request)
+{
+    const HttpHeader &header = request.GetHeader();
+    SetAcceptEncoding(header.GetHeader(HttpHeader::HeaderType::AcceptEncoding));
+    m_conditional = (request.GetMethod() == Http::Method::GET || request.GetMethod() == Http::Method::HEAD);
+    m_ifNoneMatch = header.GetHeader(HttpHeader::HeaderType::IfNoneMatch);
+    m_ifModifiedSince = header.GetHeader(HttpHeader::HeaderType::IfModifiedSince);
+    m_range = header.GetHeader(HttpHeader::HeaderType::Range);
+    m_ifRange = header.GetHeader(HttpHeader::HeaderType::IfRange);
+}
+
+bool Response::IsNotModified(const std::string &etag, int64_t modified) const
+{
+    if(m_conditional == false)
     {
-        if(m_header.Parse(data, pos + 2) == false)
+        return false;
+    }
+
+    if(m_ifNoneMatch.empty() == false)
+    {
+        // If-Modified-Since is ignored if there is If-None-Match, the tags are compared weakly
+        for(auto &item: StringUtil::Split(m_ifNoneMatch, ','))
         {
-            SetLastError("error parsing headers");
-            return false;
+            std::string tag = item;
+            StringUtil::Trim(tag);
+            if(tag.compare(0, 2, "W/") == 0)
+            {
+                tag.erase(0, 2);
+            }
+            if(tag == "*" || tag == etag)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if(m_ifModifiedSince.empty() == false)
+    {
+        struct tm timeinfo;
+        memset(&timeinfo, 0, sizeof(timeinfo));
+        if(strptime(m_ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &timeinfo) != nullptr)
+        {
+            return (modified / 1000000000 <= static_cast<int64_t>(timegm(&timeinfo)));
         }
+    }
+
+    return false;
+}
+
+bool Response::IsRangeAllowed(const std::string &etag, const std::string &lastModified) const
+{
+    // If-Range: the ranges are sent only if the client has the same file,
+    // otherwise it gets the whole one. A weak tag never matches
+    if(m_ifRange.empty())
+    {
+        return true;
+    }
+    if(m_ifRange[0] == '"' || m_ifRange.compare(0, 2, "W/") == 0)
+    {
+        return (m_ifRange == etag);
+    }
+
+    return (m_ifRange == lastModified);
+}
+
+Response::RangeResult Response::ParseRange(const std::string &value, size_t size)
+{
+    // bytes=0-499, bytes=500-, bytes=-500 and a list of them
+    m_ranges.clear();
+    std::string unit = value.substr(0, 6);
+    StringUtil::ToLower(unit);
+    if(unit != "bytes=")
+    {
+        return RangeResult::Ignored;
+    }
 
-        size_t allSize = pos + 2 + m_header.GetRequestSize();
-        if(all != nullptr)
+    size_t count = 0;
+    for(auto &item: StringUtil::Split(value.substr(6), ','))
+    {
+        std::string spec = item;
+        StringUtil::Trim(spec);
+        if(spec.empty())
         {
-            *all = m_header.GetBodySize();
+            continue;
         }
-        if(downoaded != nullptr)
+        size_t dash = spec.find('-');
+        if(dash == std::string::npos || (++ count) > MAX_RANGE_COUNT)
         {
-            *downoaded = data.size() - (m_header.GetHeaderSize() + pos + 2);
+            m_ranges.clear();
+            return RangeResult::Ignored;
         }
 
-        if(data.size() >= allSize)
+        std::string firstStr = spec.substr(0, dash);
+        std::string lastStr = spec.substr(dash + 1);
+        bool hasFirst = (firstStr.empty() == false);
+        uint64_t first = 0, last = UINT64_MAX;
+        if((hasFirst == false && lastStr.empty()) ||
+           (hasFirst && String2Position(firstStr, first) == false) ||
+           (lastStr.empty() == false && String2Position(lastStr, last) == false) ||
+           last < first)
         {
-            auto transferEncoding = m_header.GetHeader(HttpHeader::HeaderType::TransferEncoding);
-            auto contentEncoding = String2EncodingType(m_header.GetHeader(HttpHeader::HeaderType::ContentEncoding));
+            m_ranges.clear();
+            return RangeResult::Ignored;
+        }
 
-            /* some servers send 'chunked' inside Content-Encoding but according to the
-             * https://datatracker.ietf.org/doc/html/rfc2616#section-3.5 it's incorrect
-             * and should only be sent in the Transfer-Encoding, so we ignore that here */
-            if(transferEncoding == "chunked")
+        Range range = { 0, 0, 0, 0 };
+        if(hasFirst == false)
+        {
+            // the last bytes of the file
+            if(last == 0 || size == 0)
             {
-                try
-                {
-                    ByteArray tail(data.end() - 5, data.end());
-                    if(StringUtil::Compare(tail, { '0', CR, LF, CR, LF})) // all data received
-                    {
-                        DecodeBody(EncodingType::Chunked, data, pos);
-                        if(contentEncoding != EncodingType::Undefined)
-                        {
-                            if(DecodeBody(contentEncoding, m_body, 0) == false)
-                            {
-                                return false;
-                            }
-                        }
-
-                        m_header.SetChunckedSize(m_body.size());
-
-                        return true;
-                    }
-                }
-                catch(...)
-                {
-                    return false;
-                }
+                continue;
             }
-
-            else
+            range.size = static_cast<size_t>(std::min<uint64_t>(last, size));
+            range.offset = size - range.size;
+        }
+        else
+        {
+            if(first >= size)
             {
-                if(pos + 2 + m_header.GetRequestSize() == data.size())
-                {
-                    size_t dataStart = pos + 2 + m_header.GetHeaderSize() + 4;
-                    if(data.size() > dataStart)
-                    {
-                        if(DecodeBody(contentEncoding, data, dataStart) == false)
-                        {
-                            return false;
-                        }
-                    }
-                    return true;
-                }
+                continue;
             }
+            range.offset = static_cast<size_t>(first);
+            range.size = static_cast<size_t>(std::min<uint64_t>(last, size - 1)) - range.offset + 1;
         }
+        m_ranges.push_back(range);
     }
 
+    if(m_ranges.empty())
+    {
+        return (count > 0 ? RangeResult::Unsatisfiable : RangeResult::Ignored);
+    }
+
+    // overlapping ranges that add up to more than the file get the file once
+    size_t total = 0;
+    for(auto &range: m_ranges)
+    {
+        total += range.size;
+    }
+    if(m_ranges.size() > 1 && total > size)
+    {
+        m_ranges.clear();
+        return RangeResult::Ignored;
+    }
+
+    return RangeResult::Partial;
+}
+
+bool Response::String2Position(const std::string &str, uint64_t &value)
+{
+    value = 0;
+    for(char ch: str)
+    {
+        if(ch < '0' || ch > '9' || value > (UINT64_MAX - 9) / 10)
+        {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(ch - '0');
+    }
+
+    return true;
+}
+
+size_t Response::PrepareRanges(size_t size, const std::string &contentType)
+{
+    char buffer[96];
+    if(m_ranges.size() == 1)
+    {
+        snprintf(buffer, sizeof(buffer), "bytes %zu-%zu/%zu", m_ranges[0].offset, m_ranges[0].offset + m_ranges[0].size - 1, size);
+        AddHeader(HttpHeader::HeaderType::ContentRange, buffer);
+        return m_ranges[0].size;
+    }
+
+    // multipart/byteranges, every part has its own header
+    std::string boundary = StringUtil::GenerateRandomString(RANGE_BOUNDARY_LENGTH, true, false);
+    AddHeader(HttpHeader::HeaderType::ContentType, "multipart/byteranges; boundary=" + boundary);
+    size_t length = 0;
+    m_rangeData.clear();
+    for(auto &range: m_ranges)
+    {
+        snprintf(buffer, sizeof(buffer), "bytes %zu-%zu/%zu", range.offset, range.offset + range.size - 1, size);
+        std::string header = std::string(m_rangeData.empty() ? "" : "\r\n") + "--" + boundary + "\r\n" +
+                             "Content-Type: " + contentType + "\r\n" +
+                             "Content-Range: " + buffer + "\r\n\r\n";
+        range.header = m_rangeData.size();
+        range.headerSize = header.size();
+        m_rangeData.insert(m_rangeData.end(), header.begin(), header.end());
+        length += header.size() + range.size;
+    }
+    std::string closing = "\r\n--" + boundary + "--\r\n";
+    m_rangeData.insert(m_rangeData.end(), closing.begin(), closing.end());
+
+    return length + closing.size();
+}
+
+bool Response::IsCompressible() const
+{
+    return m_encoding != EncodingType::Undefined && IsCompressionNegotiable();
+}
+
+bool Response::IsCompressionNegotiable() const
+{
+#ifndef WITH_ZLIB
     return false;
+#endif
+    if(m_config.GetCompression() == false ||
+       m_header.GetHeader(HttpHeader::HeaderType::ContentEncoding).empty() == false)
+    {
+        return false;
+    }
+    if(m_responseCode < 200 || m_responseCode == 204 || m_responseCode == 206 || m_responseCode == 304)
+    {
+        return false;
+    }
+
+    // images, archives and so on are compressed already
+    std::string type = m_header.GetHeader(HttpHeader::HeaderType::ContentType);
+    StringUtil::ToLower(type);
+    return type.compare(0, 5, "text/") == 0 ||
+           type.find("json") != std::string::npos ||
+           type.find("javascript") != std::string::npos ||
+           type.find("xml") != std::string::npos ||
+           type.find("wasm") != std::string::npos;
 }
 
-bool Response::DecodeBody(EncodingType type, const ByteArray& data, size_t pos)
+void Response::CompressBody()
 {
-    switch(type)
+#ifdef WITH_ZLIB
+    Compressor compressor;
+    ByteArray compressed;
+    compressed.reserve(m_body.size() / 2);
+    if(compressor.Init(m_encoding == EncodingType::Gzip ? Compressor::Format::Gzip : Compressor::Format::Deflate, m_config.GetCompressionLevel()) &&
+       compressor.Compress(m_body.data(), m_body.size(), compressed) &&
+       compressor.Finish(compressed) &&
+       compressed.size() < m_body.size())
+    {
+        m_body.swap(compressed);
+        AddHeader(HttpHeader::HeaderType::ContentLength, std::to_string(m_body.size()));
+        AddHeader(HttpHeader::HeaderType::ContentEncoding, EncodingType2String(m_encoding));
+    }
+#endif
+}
+
+bool Response::BeginStream()
+{
+    if(m_communication == nullptr)
+    {
+        SetLastError("streaming isn't available for this response");
+        return false;
+    }
+    if(m_file.empty() == false)
     {
-        case EncodingType::Chunked:
+        SetLastError("the response already has a file");
+        return false;
+    }
+
+    // the responses to the previous pipelined requests must go first
+    if(m_flush != nullptr)
+    {
+        m_flush();
+    }
+
+    m_header.RemoveHeader(HttpHeader::HeaderType::ContentLength);
+    AddHeader(HttpHeader::HeaderType::TransferEncoding, "chunked");
+#ifdef WITH_ZLIB
+    if(IsCompressionNegotiable())
+    {
+        AddHeader(HttpHeader::HeaderType::Vary, "Accept-Encoding");
+    }
+    if(IsCompressible())
+    {
+        m_compressor.reset(new Compressor());
+        if(m_compressor->Init(m_encoding == EncodingType::Gzip ? Compressor::Format::Gzip : Compressor::Format::Deflate, m_config.GetCompressionLevel()))
+        {
+            AddHeader(HttpHeader::HeaderType::ContentEncoding, EncodingType2String(m_encoding));
+        }
+        else
+        {
+            m_compressor.reset();
+        }
+    }
+#endif
+    AddHeader(HttpHeader::HeaderType::Date, FileSystem::GetDateTime());
+    m_headerData.clear();
+    AppendStatusLine(m_headerData);
+    m_header.Serialize(m_headerData);
+    m_headerData.push_back(CR);
+    m_headerData.push_back(LF);
+    m_streaming = true;
+    m_shouldSend = false;
+
+    return true;
+}
+
+bool Response::SendChunk(const uint8_t *data, size_t size, bool withHeader)
+{
+    if(WaitForRoom() == false)
+    {
+        return false;
+    }
+
+#ifdef WITH_ZLIB
+    if(m_compressor != nullptr)
+    {
+        // the body written before and the chunk go as one compressed chunk,
+        // it's flushed so the client can decode everything sent so far
+        m_chunkData.clear();
+        if(withHeader && m_body.size() > 0)
+        {
+            m_compressor->Compress(m_body.data(), m_body.size(), m_chunkData);
+            m_body.clear();
+        }
+        if(m_compressor->Compress(data, size, m_chunkData, true) == false)
+        {
+            SetLastError("error compressing chunk: " + m_compressor->GetLastError());
+            return false;
+        }
+        data = m_chunkData.data();
+        size = m_chunkData.size();
+    }
+#endif
+
+    // the header, the body written before streaming started and the chunk
+    // are gathered into one write, the chunk data isn't copied
+    std::vector<struct iovec> buffers;
+    struct iovec buffer;
+    char bodySize[32];
+    char chunkSize[32];
+    char eol[] = { CR, LF };
+    if(withHeader)
+    {
+        buffer.iov_base = m_headerData.data();
+        buffer.iov_len = m_headerData.size();
+        buffers.push_back(buffer);
+        if(m_body.size() > 0)
+        {
+            buffer.iov_base = bodySize;
+            buffer.iov_len = snprintf(bodySize, sizeof(bodySize), "%zx\r\n", m_body.size());
+            buffers.push_back(buffer);
+            buffer.iov_base = m_body.data();
+            buffer.iov_len = m_body.size();
+            buffers.push_back(buffer);
+            buffer.iov_base = eol;
+            buffer.iov_len = sizeof(eol);
+            buffers.push_back(buffer);
+        }
+    }
+    if(size > 0)
+    {
+        buffer.iov_base = chunkSize;
+        buffer.iov_len = snprintf(chunkSize, sizeof(chunkSize), "%zx\r\n", size);
+        buffers.push_back(buffer);
+        buffer.iov_base = const_cast<uint8_t *>(data);
+        buffer.iov_len = size;
+        buffers.push_back(buffer);
+        buffer.iov_base = eol;
+        buffer.iov_len = sizeof(eol);
+        buffers.push_back(buffer);
+    }
+
+    bool retval = m_communication->Write(m_connID, buffers);
+    if(withHeader)
+    {
+        m_headerData.clear();
+        m_body.clear();
+    }
+    if(retval == false)
+    {
+        SetLastError("error sending chunk: " + m_communication->GetLastError());
+    }
+
+    return retval;
+}
+
+bool Response::WaitForRoom()
+{
+    // the handler is slowed down to the client's pace instead of queueing
+    // the whole body, it fails when the client doesn't read anything for too long
+    if(m_communication->WaitForRoom(m_connID, static_cast<uint32_t>(std::max(m_config.GetWriteTimeout(), 0))) == false)
+    {
+        SetLastError("write timeout or the connection is closed");
+        return false;
+    }
+
+    return true;
+}
+
+bool Response::Parse(const ByteArray &data, size_t* all, size_t* downoaded)
+{
+    // the whole response is expected in the data
+    size_t consumed;
+    ParseResult result;
+    do
+    {
+        result = Parse(data, consumed);
+    }
+    while(result == ParseResult::Header);
+
+    if(result == ParseResult::NeedMore && m_untilClose)
+    {
+        result = Finish();
+    }
+
+    if(all != nullptr)
+    {
+        *all = m_bodySize;
+    }
+    if(downoaded != nullptr)
+    {
+        *downoaded = m_bodyReceived;
+    }
+
+    return (result == ParseResult::Complete);
+}
+
+Response::ParseResult Response::Parse(const ByteArray &data, size_t &consumed)
+{
+    ClearError();
+    consumed = 0;
+
+    // the same way as a request is parsed on the server, the header line by line
+    // and the body as it arrives, the caller releases the consumed bytes
+    while(m_parseState == ParseState::StatusLine || m_parseState == ParseState::Header)
+    {
+        const void *ptr = nullptr;
+        if(m_parsePos < data.size())
+        {
+            ptr = memchr(data.data() + m_parsePos, LF, data.size() - m_parsePos);
+        }
+        if(ptr == nullptr)
+        {
+            m_parsePos = data.size();
+            return ParseResult::NeedMore;
+        }
+
+        size_t lineStart = m_lineStart;
+        size_t lineEnd = static_cast<const uint8_t *>(ptr) - data.data();
+        m_lineStart = m_parsePos = lineEnd + 1;
+        if(lineEnd > lineStart && data[lineEnd - 1] == CR)
+        {
+            lineEnd --;
+        }
+
+        if(m_parseState == ParseState::StatusLine)
+        {
+            if(lineEnd == lineStart)
+            {
+                continue;
+            }
+            if(ParseStatusLine(data, lineStart, lineEnd) == false)
+            {
+                SetLastError("error parsing status line: " + GetLastError());
+                m_parseState = ParseState::Error;
+                return ParseResult::Error;
+            }
+            m_headerStart = m_lineStart;
+            m_parseState = ParseState::Header;
+        }
+        else if(lineEnd == lineStart)
+        {
+            m_header.SetComplete(lineStart > m_headerStart ? lineStart - EOL_LENGTH - m_headerStart : 0);
+            m_bodyOffset = m_lineStart;
+            BeginBody();
+            if(m_parseState == ParseState::Body)
+            {
+                return ParseResult::Header;
+            }
+        }
+        else
+        {
+            m_header.ParseLine(data, StringUtil::Range { lineStart, lineEnd - 1 });
+        }
+    }
+
+    if(m_parseState == ParseState::Body)
+    {
+        size_t pos = m_bodyOffset + m_bodyReceived - m_released;
+        size_t used = 0;
+        bool complete = false;
+        if(m_chunked)
+        {
+            auto result = m_chunkedDecoder.Decode(data, pos, data.size() - pos, used,
+                                                  std::bind(&Response::PassBody, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+            if(result == ChunkedDecoder::Result::Error)
             {
-                m_body.clear();
-                size_t dataStart = pos + 2 + m_header.GetHeaderSize() + 4; // status line + CRLF (2 bytes) + headers + CRLFCRLF (4 bytes)
-                size_t dataLength = data.size() - 5; // data w/o trailing chunk
-                while(dataStart < dataLength)
+                if(GetLastError().empty())
                 {
-                    auto pos = StringUtil::SearchPosition(data, {CR, LF}, dataStart); // end of length string
-                    std::string temp(data.begin() + dataStart,data.begin() + pos);
-                    int n = std::stoi(temp, nullptr, 16);
-                    size_t chunkEnd = pos + 2 + n; // end of lenght string + 2 bytes(CRLF) + data length
-                    if(chunkEnd <= dataLength)
-                    {
-                        m_body.insert(m_body.end(), data.begin() + pos + 2, data.begin() + chunkEnd);
-                        dataStart = chunkEnd + 2; // end of data + 2 bytes (CRLF)
-                    }
-                    else
-                    {
-                        return false;
-                    }
+                    SetLastError("chunked body error: " + m_chunkedDecoder.GetLastError());
                 }
+                m_parseState = ParseState::Error;
+                return ParseResult::Error;
             }
-            break;
-#ifdef WITH_ZLIB
-        case EncodingType::Gzip:
+            complete = (result == ChunkedDecoder::Result::Complete);
+        }
+        else
+        {
+            used = m_untilClose ? data.size() - pos : std::min(data.size() - pos, m_bodySize - m_bodyReceived);
+            if(used > 0 && PassBody(data, pos, used) == false)
             {
-                ByteArray encoded(data.begin() + pos, data.end());
-                ByteArray decoded = Data::Unzip(encoded);
-                m_body.clear();
-                m_body.insert(m_body.begin(), decoded.begin(), decoded.end());
+                m_parseState = ParseState::Error;
+                return ParseResult::Error;
             }
-            break;
-        case EncodingType::Deflate:
+            complete = (m_untilClose == false && m_bodyReceived + used == m_bodySize);
+        }
+        m_bodyReceived += used;
+        consumed = pos + used;
+        m_released += consumed;
+
+        if(complete == false)
+        {
+            return ParseResult::NeedMore;
+        }
+        if(EndBody() == false)
+        {
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
+        }
+    }
+
+    if(m_parseState == ParseState::Complete)
+    {
+        return ParseResult::Complete;
+    }
+
+    return ParseResult::Error;
+}
+
+Response::ParseResult Response::Finish()
+{
+    // the connection is closed, that ends only a body without a size
+    if(m_parseState == ParseState::Body && m_untilClose)
+    {
+        if(EndBody() == false)
+        {
+            m_parseState = ParseState::Error;
+            return ParseResult::Error;
+        }
+    }
+
+    if(m_parseState == ParseState::Complete)
+    {
+        return ParseResult::Complete;
+    }
+
+    SetLastError("the connection closed before the response was complete");
+    m_parseState = ParseState::Error;
+    return ParseResult::Error;
+}
+
+void Response::SetBodyFunction(const BodyFunc &f)
+{
+    m_bodyFunc = f;
+}
+
+size_t Response::GetBodyReceived() const
+{
+    return m_bodyReceived;
+}
+
+#ifdef WITH_ZLIB
+void Response::SetDecompressor(Decompressor *decompressor)
+{
+    // the client passes its own one so the stream is allocated once per connection
+    m_decompressor = decompressor;
+}
+#endif
+
+void Response::BeginBody()
+{
+    m_body.clear();
+    m_bodySize = 0;
+    m_bodyReceived = 0;
+    m_chunkedDecoder.Reset();
+
+    std::string transferEncoding = m_header.GetHeader(HttpHeader::HeaderType::TransferEncoding);
+    StringUtil::ToLower(transferEncoding);
+    m_chunked = (transferEncoding.find("chunked") != std::string::npos);
+    m_untilClose = false;
+
+    // 1xx, 204 and 304 never have a body
+    if((m_responseCode >= 100 && m_responseCode < 200) || m_responseCode == 204 || m_responseCode == 304)
+    {
+        m_chunked = false;
+    }
+    else if(m_chunked == false)
+    {
+        m_bodySize = m_header.GetBodySize();
+        m_untilClose = m_header.GetHeader(HttpHeader::HeaderType::ContentLength).empty();
+    }
+
+    m_parseState = (m_chunked || m_untilClose || m_bodySize > 0) ? ParseState::Body : ParseState::Complete;
+
+#ifdef WITH_ZLIB
+    /* some servers send 'chunked' inside Content-Encoding but according to the
+     * https://datatracker.ietf.org/doc/html/rfc2616#section-3.5 it's incorrect
+     * and should only be sent in the Transfer-Encoding, so we ignore that here */
+    std::string contentEncoding = m_header.GetHeader(HttpHeader::HeaderType::ContentEncoding);
+    StringUtil::ToLower(contentEncoding);
+    auto encoding = String2EncodingType(contentEncoding);
+    m_decoding = (m_parseState == ParseState::Body && (encoding == EncodingType::Gzip || encoding == EncodingType::Deflate));
+    if(m_decoding)
+    {
+        if(m_decompressor == nullptr)
+        {
+            m_ownDecompressor.reset(new Decompressor());
+            m_decompressor = m_ownDecompressor.get();
+        }
+        m_decompressor->Init(encoding == EncodingType::Gzip ? Decompressor::Format::Gzip : Decompressor::Format::Deflate);
+    }
+#endif
+}
+
+bool Response::PassBody(const ByteArray &data, size_t offset, size_t size)
+{
+#ifdef WITH_ZLIB
+    if(m_decoding)
+    {
+        // only the decoder's buffer is used, the encoded body isn't kept
+        if(m_decompressor->Decompress(data.data() + offset, size,
+                                      std::bind(&Response::StoreBody, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)) == false)
+        {
+            if(GetLastError().empty())
             {
-                ByteArray encoded(data.begin() + pos, data.end());
-                ByteArray decoded = Data::Uncompress(encoded);
-                m_body.clear();
-                m_body.insert(m_body.begin(), decoded.begin(), decoded.end());
+                SetLastError("error decoding body: " + m_decompressor->GetLastError());
             }
-            break;
+            return false;
+        }
+        return true;
+    }
 #endif
-        default:
-            m_body.insert(m_body.end(), data.begin() + pos, data.end());
-            break;
+
+    return StoreBody(data, offset, size);
+}
+
+bool Response::StoreBody(const ByteArray &data, size_t offset, size_t size)
+{
+    if(m_bodyFunc != nullptr)
+    {
+        if(m_bodyFunc(*this, data, offset, size) == false)
+        {
+            SetLastError("the body isn't accepted");
+            return false;
+        }
+        return true;
+    }
+
+    m_body.insert(m_body.end(), data.begin() + offset, data.begin() + offset + size);
+    return true;
+}
+
+bool Response::EndBody()
+{
+    if(m_chunked)
+    {
+        m_header.SetChunckedSize(m_chunkedDecoder.GetDecodedSize());
+    }
+
+#ifdef WITH_ZLIB
+    if(m_decoding && m_decompressor->IsFinished() == false)
+    {
+        SetLastError("the compressed body is incomplete");
+        return false;
     }
+#endif
 
+    m_parseState = ParseState::Complete;
     return true;
 }
 
@@ -388,44 +1138,112 @@ Response::EncodingType Response::String2EncodingType(const std::string &str)
     return Response::EncodingType::Undefined;
 }
 
-bool Response::ParseStatusLine(const ByteArray &data, size_t &pos)
+Response::EncodingType Response::NegotiateEncoding(const std::string &value)
 {
-    pos = StringUtil::SearchPosition(data, { CR, LF });
-    if(pos != SIZE_MAX) // status line presents
+#ifdef WITH_ZLIB
+    // "gzip, deflate;q=0.5, br", q=0 excludes a coding, '*' is any other
+    double gzip = -1.0;
+    double deflate = -1.0;
+    double any = -1.0;
+    for(auto &token: StringUtil::Split(value, ','))
     {
-        auto ranges = StringUtil::Split(data, { ' ' }, 0, pos);
-        if(ranges.size() >= 3)
+        auto params = StringUtil::Split(token, ';');
+        if(params.empty())
         {
-            m_version = std::string(data.begin() + ranges[0].start, data.begin() + ranges[0].end + 1);
-            StringUtil::Trim(m_version);
-
-            std::string temp = std::string(data.begin() + ranges[1].start, data.begin() + ranges[1].end + 1);
-            int i;
-            if(StringUtil::String2int(temp, i))
-            {
-                m_responseCode = i;
-            }
-            else
+            continue;
+        }
+        std::string name = params[0];
+        StringUtil::Trim(name);
+        StringUtil::ToLower(name);
+        double q = 1.0;
+        for(size_t i = 1;i < params.size();i ++)
+        {
+            std::string param = params[i];
+            StringUtil::Trim(param);
+            if(param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
             {
-                SetLastError("response code parsing error");
-                return false;
+                q = strtod(param.c_str() + 2, nullptr);
             }
+        }
 
-            for(size_t i = 2;i < ranges.size();i ++)
-            {
-                m_responsePhrase += (m_responsePhrase.empty() ? "" : " ") + std::string(data.begin() + ranges[i].start, data.begin() + ranges[i].end + 1);
-            }
+        if(name == "gzip" || name == "x-gzip")
+        {
+            gzip = q;
+        }
+        else if(name == "deflate")
+        {
+            deflate = q;
+        }
+        else if(name == "*")
+        {
+            any = q;
+        }
+    }
 
-            StringUtil::Trim(m_responsePhrase);
+    gzip = (gzip < 0) ? any : gzip;
+    deflate = (deflate < 0) ? any : deflate;
+    if(gzip > 0 && gzip >= deflate)
+    {
+        return EncodingType::Gzip;
+    }
+    if(deflate > 0)
+    {
+        return EncodingType::Deflate;
+    }
+#else
+    (void)value;
+#endif
 
-            return true;
-        }
+    return EncodingType::Undefined;
+}
+
+std::string Response::EncodingType2String(EncodingType type)
+{
+    switch(type)
+    {
+        case EncodingType::Gzip: return "gzip";
+        case EncodingType::Deflate: return "deflate";
+        case EncodingType::Chunked: return "chunked";
+        case EncodingType::Compress: return "compress";
+        case EncodingType::Brotli: return "br";
+        default: break;
     }
-    else
+
+    return "";
+}
+
+bool Response::ParseStatusLine(const ByteArray &data, size_t start, size_t end)
+{
+    auto ranges = StringUtil::Split(data, { ' ' }, start, end - 1);
+    if(ranges.size() >= 3)
     {
-        SetLastError("status line not found");
+        m_version = std::string(data.begin() + ranges[0].start, data.begin() + ranges[0].end + 1);
+        StringUtil::Trim(m_version);
+
+        std::string temp = std::string(data.begin() + ranges[1].start, data.begin() + ranges[1].end + 1);
+        int i;
+        if(StringUtil::String2int(temp, i))
+        {
+            m_responseCode = i;
+        }
+        else
+        {
+            SetLastError("response code parsing error");
+            return false;
+        }
+
+        m_responsePhrase = "";
+        for(size_t i = 2;i < ranges.size();i ++)
+        {
+            m_responsePhrase += (m_responsePhrase.empty() ? "" : " ") + std::string(data.begin() + ranges[i].start, data.begin() + ranges[i].end + 1);
+        }
+
+        StringUtil::Trim(m_responsePhrase);
+
+        return true;
     }
 
+    SetLastError("wrong format");
     return false;
 }
 
@@ -466,6 +1284,7 @@ std::string Response::ResponseCode2String(int code)
         case 415: return "Unsupported Media Type";
         case 416: return "Requested range not satisfiable";
         case 417: return "Expectation Failed";
+        case 431: return "Request Header Fields Too Large";
         case 500: return "Internal Server Error";
         case 501: return "Not Implemented";
         case 502: return "Bad Gateway";
@@ -564,19 +1383,22 @@ void Response::InitDefault()
 {
     m_version = "HTTP/1.1";
     m_responseCode = 200;
+    m_responsePhrase = Response::ResponseCode2String(m_responseCode);
     m_mimeType = "text/plain";
     AddHeader(HttpHeader::HeaderType::Server, m_config.GetServerName());
 }
 
-ByteArray Response::BuildStatusLine() const
+void Response::AppendStatusLine(ByteArray &buffer) const
 {
-    std::string statusLine = m_version + " " + std::to_string(m_responseCode) + " " + m_responsePhrase + CR + LF;
-    return ByteArray(statusLine.begin(), statusLine.end());
-}
+    char code[8];
+    int length = snprintf(code, sizeof(code), " %u ", static_cast<unsigned int>(m_responseCode));
 
-ByteArray Response::BuildHeaders() const
-{
-    return m_header.ToByteArray();
+    buffer.reserve(buffer.size() + m_version.size() + length + m_responsePhrase.size() + 2);
+    buffer.insert(buffer.end(), m_version.begin(), m_version.end());
+    buffer.insert(buffer.end(), code, code + length);
+    buffer.insert(buffer.end(), m_responsePhrase.begin(), m_responsePhrase.end());
+    buffer.push_back(CR);
+    buffer.push_back(LF);
 }
 
 void Response::SetSession(Session *session)
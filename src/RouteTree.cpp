@@ -0,0 +1,253 @@
+#include <algorithm>
+#include "RouteTree.h"
+
+
+using namespace WebCpp;
+
+void RouteTree::Add(size_t index, const Route &route)
+{
+    auto &root = m_roots[route.m_method];
+    if(root == nullptr)
+    {
+        root.reset(new Node());
+    }
+
+    std::vector<Part> current;
+    std::vector<std::vector<Part>> variants;
+    Expand(route.m_tokens, 0, current, variants);
+    if(variants.size() > MAX_ROUTE_VARIANTS)
+    {
+        // too many combinations, the route is checked for every path
+        root->wildcards.push_back(Leaf{ index, 0, true });
+        return;
+    }
+
+    bool verify = false;
+    for(auto &token: route.m_tokens)
+    {
+        verify = verify || token.optional || token.type == Route::Token::Type::Group;
+    }
+    for(size_t i = 0;i < variants.size();i ++)
+    {
+        Insert(root.get(), variants[i], Leaf{ index, i, verify });
+    }
+}
+
+void RouteTree::Find(Http::Method method, const std::string &path, std::vector<Match> &matches) const
+{
+    matches.clear();
+    auto it = m_roots.find(method);
+    if(it == m_roots.end())
+    {
+        return;
+    }
+
+    std::vector<Arg> args;
+    Search(*it->second, path, 0, args, matches);
+
+    // a route can match by several variants, the preferred one is left
+    std::stable_sort(matches.begin(), matches.end(), [](const Match &first, const Match &second)
+    {
+        if(first.index != second.index)
+        {
+            return first.index < second.index;
+        }
+        return first.variant < second.variant;
+    });
+    matches.erase(std::unique(matches.begin(), matches.end(), [](const Match &first, const Match &second)
+    {
+        return first.index == second.index;
+    }), matches.end());
+}
+
+void RouteTree::SetArgs(const Match &match, const std::string &path, Request &request)
+{
+    for(auto &arg: match.args)
+    {
+        request.SetArg(*arg.name, path.substr(arg.offset, arg.size));
+    }
+}
+
+void RouteTree::Clear()
+{
+    m_roots.clear();
+}
+
+void RouteTree::Expand(const std::vector<Route::Token> &tokens, size_t i, std::vector<Part> &current, std::vector<std::vector<Part>> &variants) const
+{
+    if(variants.size() > MAX_ROUTE_VARIANTS)
+    {
+        return;
+    }
+    if(i == tokens.size())
+    {
+        variants.push_back(current);
+        return;
+    }
+
+    // every alternative of a group and an optional part both present and skipped become variants,
+    // the ones Route::IsMatch() wouldn't choose are filtered out by checking the route with it
+    auto &token = tokens[i];
+    switch(token.type)
+    {
+        case Route::Token::Type::Any:
+            current.push_back(Part{ Part::Type::Any, "", Route::Token::View::Default });
+            variants.push_back(current);
+            current.pop_back();
+            return;
+        case Route::Token::Type::Default:
+            current.push_back(Part{ Part::Type::Text, token.text, Route::Token::View::Default });
+            Expand(tokens, i + 1, current, variants);
+            current.pop_back();
+            break;
+        case Route::Token::Type::Group:
+            for(auto &str: token.group)
+            {
+                current.push_back(Part{ Part::Type::Text, str, Route::Token::View::Default });
+                Expand(tokens, i + 1, current, variants);
+                current.pop_back();
+            }
+            break;
+        case Route::Token::Type::Variable:
+            current.push_back(Part{ Part::Type::Param, token.text, token.view });
+            Expand(tokens, i + 1, current, variants);
+            current.pop_back();
+            break;
+    }
+
+    if(token.optional)
+    {
+        Expand(tokens, i + 1, current, variants);
+    }
+}
+
+void RouteTree::Insert(Node *node, const std::vector<Part> &parts, const Leaf &leaf)
+{
+    std::string text;
+    for(auto &part: parts)
+    {
+        switch(part.type)
+        {
+            case Part::Type::Text:
+                text += part.text;
+                break;
+            case Part::Type::Param:
+                node = InsertParam(InsertText(node, text), part);
+                text.clear();
+                break;
+            case Part::Type::Any:
+                // the rest of the pattern isn't compiled
+                InsertText(node, text)->wildcards.push_back(leaf);
+                return;
+        }
+    }
+
+    InsertText(node, text)->routes.push_back(leaf);
+}
+
+RouteTree::Node *RouteTree::InsertText(Node *node, const std::string &text)
+{
+    size_t pos = 0;
+    while(pos < text.size())
+    {
+        auto it = node->children.find(text[pos]);
+        if(it == node->children.end())
+        {
+            std::unique_ptr<Node> child(new Node());
+            child->text = text.substr(pos);
+            Node *ptr = child.get();
+            node->children[text[pos]] = std::move(child);
+            return ptr;
+        }
+
+        Node *child = it->second.get();
+        size_t common = 0;
+        while(common < child->text.size() && pos + common < text.size() && child->text[common] == text[pos + common])
+        {
+            common ++;
+        }
+        if(common < child->text.size())
+        {
+            // the edge is split where the texts differ
+            std::unique_ptr<Node> middle(new Node());
+            middle->text = child->text.substr(0, common);
+            child->text.erase(0, common);
+            middle->children[child->text[0]] = std::move(it->second);
+            it->second = std::move(middle);
+            child = it->second.get();
+        }
+        node = child;
+        pos += common;
+    }
+
+    return node;
+}
+
+RouteTree::Node *RouteTree::InsertParam(Node *node, const Part &part)
+{
+    for(auto &param: node->params)
+    {
+        if(param.view == part.view && param.name == part.text)
+        {
+            return param.node.get();
+        }
+    }
+
+    // the characters a variable of this type takes, the same as Route::IsMatch() does
+    Param param;
+    param.view = part.view;
+    param.name = part.text;
+    param.node.reset(new Node());
+    Route::Token token;
+    token.type = Route::Token::Type::Variable;
+    token.view = part.view;
+    for(size_t i = 0;i < param.chars.size();i ++)
+    {
+        char ch = static_cast<char>(i);
+        size_t length = 0;
+        param.chars[i] = token.IsMatch(&ch, 1, length);
+    }
+
+    node->params.push_back(std::move(param));
+    return node->params.back().node.get();
+}
+
+void RouteTree::Search(const Node &node, const std::string &path, size_t pos, std::vector<Arg> &args, std::vector<Match> &matches) const
+{
+    for(auto &leaf: node.wildcards)
+    {
+        matches.push_back(Match{ leaf.index, leaf.variant, true, std::vector<Arg>() });
+    }
+
+    if(pos == path.size())
+    {
+        for(auto &leaf: node.routes)
+        {
+            // the arguments of a checked route are set by Route::IsMatch()
+            matches.push_back(Match{ leaf.index, leaf.variant, leaf.verify, leaf.verify ? std::vector<Arg>() : args });
+        }
+        return;
+    }
+
+    auto it = node.children.find(path[pos]);
+    if(it != node.children.end() && path.compare(pos, it->second->text.size(), it->second->text) == 0)
+    {
+        Search(*it->second, path, pos + it->second->text.size(), args, matches);
+    }
+
+    // a variable takes all the characters of its type, as Route::IsMatch() does
+    for(auto &param: node.params)
+    {
+        size_t end = pos;
+        while(end < path.size() && param.chars[static_cast<uint8_t>(path[end])])
+        {
+            end ++;
+        }
+        if(end > pos)
+        {
+            args.push_back(Arg{ &param.name, pos, end - pos });
+            Search(*param.node, path, end, args, matches);
+            args.pop_back();
+        }
+    }
+}
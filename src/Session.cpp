@@ -8,9 +8,14 @@ Session::Session(int connID, const std::string &remote):
     request(new Request()),
     authProvider(AuthProvider::Type::Server)
 {
+    this->connID = connID;
     this->remote = remote;
     request->SetConnectionID(connID);
     request->SetRemote(remote);
     request->SetSession(this);
-    readyForDispatch = false;
+    busy = false;
+    queued = false;
+    closed = false;
+    paused = false;
+    failed = false;
 }
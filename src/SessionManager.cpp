@@ -1,5 +1,6 @@
 #include "SessionManager.h"
 #include "AuthFactory.h"
+#include "Lock.h"
 
 
 using namespace WebCpp;
@@ -9,88 +10,163 @@ SessionManager::SessionManager()
 
 }
 
+void SessionManager::SetHeaderCallback(const HeaderCallback &callback)
+{
+    m_headerCallback = callback;
+}
+
 bool SessionManager::AddNewSession(int connID, const std::string &remote)
 {
     auto it = m_sesions.find(connID);
     if(it == m_sesions.end())
     {
-        m_sesions.insert(std::pair<int, Session>(connID, Session(connID, remote)));
+        m_sesions.insert(std::make_pair(connID, std::make_shared<Session>(connID, remote)));
         return true;
     }
 
     return false;
 }
 
-bool SessionManager::AppendData(int connID, const ByteArray &data)
+bool SessionManager::AppendData(int connID, ByteArray &data)
 {
     auto it = m_sesions.find(connID);
     if(it != m_sesions.end())
     {
         auto &session = it->second;
+        if(session->failed)
+        {
+            return true; // nothing after a broken request is read
+        }
 
-        session.data.insert(session.data.end(), data.begin(), data.end());
-        if(session.request == nullptr)
+        if(session->data.empty())
         {
-            session.request.reset(new Request(connID, session.remote));
-            session.request->SetSession(&session);
+            session->data.swap(data); // take the receive buffer as is
         }
+        else
+        {
+            session->data.insert(session->data.end(), data.begin(), data.end());
+        }
+
+        Parse(session);
+        PushReady(session);
         return true;
     }
 
     return false;
 }
 
-bool SessionManager::Process()
+SessionManager::ReceiveState SessionManager::GetReceiveState(int connID) const
 {
-    bool retval = false;
-    ClearError();
+    auto it = m_sesions.find(connID);
+    if(it != m_sesions.end())
+    {
+        auto &session = *it->second;
+        // the data left after a full pipeline isn't parsed yet, the client is not waited for.
+        // A request with the body being parsed can have no data kept, it's passed on as it arrives
+        bool receiving = session.request != nullptr && (session.data.size() > 0 || session.request->GetHeader().IsComplete());
+        if(receiving && session.ready.size() < MAX_PIPELINED_REQUESTS)
+        {
+            return session.request->GetHeader().IsComplete() ? ReceiveState::Body : ReceiveState::Header;
+        }
+        if(session.busy || session.ready.size() > 0)
+        {
+            return ReceiveState::Processing;
+        }
+    }
+
+    return ReceiveState::Idle;
+}
 
-    for(auto& it: m_sesions)
+bool SessionManager::UpdatePause(int connID, bool &pause)
+{
+    // nothing is parsed while the pipeline is full, the data isn't read either
+    // until the requests are answered. Returns true if reading should be paused or resumed
+    auto it = m_sesions.find(connID);
+    if(it != m_sesions.end())
     {
-        auto &session = it.second;
-        if(session.request != nullptr && session.data.size() > 0)
+        auto &session = *it->second;
+        pause = (session.ready.size() >= MAX_PIPELINED_REQUESTS);
+        if(pause != session.paused)
         {
-            if(session.request->Parse(session.data))
-            {
-                size_t size = session.request->GetRequestSize();
-                if(session.data.size() >= size)
-                {
-                    session.readyForDispatch = true;
-                    session.data.clear();
-                    retval = true;
-                    break;
-                }
-            }
-            else
-            {
-                SetLastError("parsing error: " + session.request->GetLastError());
-            }
+            session.paused = pause;
+            return true;
         }
     }
 
-    return retval;
+    return false;
+}
+
+bool SessionManager::HasReadyRequests() const
+{
+    return !m_readyQueue.empty();
 }
 
-std::unique_ptr<Request> SessionManager::GetReadyRequest()
+std::vector<std::unique_ptr<Request>> SessionManager::GetReadyRequests(std::shared_ptr<Session> &session)
 {
-    for(auto& it: m_sesions)
+    std::vector<std::unique_ptr<Request>> requests;
+
+    while(!m_readyQueue.empty())
     {
-        auto &session = it.second;
-        if(session.readyForDispatch == true)
+        session = std::move(m_readyQueue.front());
+        m_readyQueue.pop_front();
+        session->queued = false;
+
+        // the session could be removed or get busy since it was queued
+        // all the pipelined requests of the connection are taken at once, their responses are sent together
+        if(session->closed == false && session->busy == false && session->ready.empty() == false)
         {
-            session.readyForDispatch = false;
-            return std::unique_ptr<Request>(std::move(session.request));
+            while(session->ready.empty() == false)
+            {
+                requests.push_back(std::move(session->ready.front()));
+                session->ready.pop_front();
+            }
+            session->busy = true;
+            return requests;
         }
     }
 
+    session.reset();
+    return requests;
+}
+
+std::shared_ptr<Session> SessionManager::GetSession(int connID) const
+{
+    auto it = m_sesions.find(connID);
+    if(it != m_sesions.end())
+    {
+        return it->second;
+    }
+
     return nullptr;
 }
 
+bool SessionManager::ReleaseSession(const Session *session)
+{
+    // the connection could be closed and its ID reused while the request was processed
+    auto it = m_sesions.find(session->connID);
+    if(it != m_sesions.end() && it->second.get() == session)
+    {
+        it->second->busy = false;
+        // the session goes to the tail of the queue, so the other connections are served first
+        Parse(it->second);
+        PushReady(it->second);
+        return true;
+    }
+
+    return false;
+}
+
 bool SessionManager::RemoveSession(int connID)
 {
     auto it = m_sesions.find(connID);
-    if(it == m_sesions.end())
+    if(it != m_sesions.end())
     {
+        // the session can still be in the ready queue, it will be skipped there. The requests
+        // aren't released here, a streamed body can still be passed to its handler
+        {
+            Lock lock(it->second->pauseMutex);
+            it->second->closed = true;
+        }
         m_sesions.erase(it);
         return true;
     }
@@ -102,3 +178,58 @@ bool SessionManager::IsEmpty() const
 {
     return m_sesions.empty();
 }
+
+void SessionManager::Parse(const std::shared_ptr<Session> &session)
+{
+    // a pipelining client can send several requests at once, all of them are parsed
+    // and queued, the bytes after a complete request belong to the next one
+    while(session->data.size() > 0 && session->ready.size() < MAX_PIPELINED_REQUESTS && session->failed == false)
+    {
+        if(session->request == nullptr)
+        {
+            session->request.reset(new Request(session->connID, session->remote));
+            session->request->SetSession(session.get());
+        }
+
+        size_t consumed;
+        auto result = session->request->Parse(session->data, consumed);
+        if(result == Request::ParseResult::Complete)
+        {
+            session->data.erase(session->data.begin(), session->data.begin() + consumed);
+            session->ready.push_back(std::move(session->request));
+        }
+        else if(result == Request::ParseResult::Header)
+        {
+            // the body can be routed to a streaming handler before it's parsed
+            if(m_headerCallback != nullptr)
+            {
+                m_headerCallback(session, *session->request);
+            }
+        }
+        else if(result == Request::ParseResult::Error)
+        {
+            // the rest of the data can't be trusted, drop it. The request is queued after
+            // the ones before it, answered with an error and the connection is closed
+            SetLastError("parsing error: " + session->request->GetLastError());
+            session->failed = true;
+            session->data.clear();
+            session->ready.push_back(std::move(session->request));
+        }
+        else
+        {
+            // the body bytes already passed to the parser aren't kept
+            session->data.erase(session->data.begin(), session->data.begin() + consumed);
+            break;
+        }
+    }
+}
+
+void SessionManager::PushReady(const std::shared_ptr<Session> &session)
+{
+    // the next request is dispatched only when the previous one was answered
+    if(session->queued == false && session->busy == false && session->ready.empty() == false)
+    {
+        session->queued = true;
+        m_readyQueue.push_back(session);
+    }
+}
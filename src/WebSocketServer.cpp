@@ -53,6 +53,9 @@ bool WebSocketServer::Init()
     }
 
     m_server->SetPort(m_config.GetWsServerPort());
+    m_server->SetMaxConnections(m_config.GetMaxConnections());
+    m_server->SetReactorCount(m_config.GetReactorCount());
+    m_server->SetWriteWatermarks(m_config.GetWriteHighWatermark(), m_config.GetWriteLowWatermark());
     if(!m_server->Init())
     {
         SetLastError("WebSocketServer init failed");
@@ -240,7 +243,14 @@ void WebSocketServer::PutToQueue(int connID, ByteArray &data)
     {
         if(req.connID == connID)
         {
-            req.data.insert(req.data.end(), data.begin(), data.end());
+            if(req.data.empty())
+            {
+                req.data.swap(data); // take the receive buffer as is
+            }
+            else
+            {
+                req.data.insert(req.data.end(), data.begin(), data.end());
+            }
             break;
         }
     }
@@ -298,17 +308,24 @@ bool WebSocketServer::CheckWsHeader(RequestData& requestData)
 {
     bool retval = false;
 
-    if(requestData.request.Parse(requestData.data))
+    size_t size;
+    auto result = requestData.request.Parse(requestData.data, size);
+    if(result == Request::ParseResult::Header)
     {
-        size_t size = requestData.request.GetRequestSize();
-        if(requestData.data.size() >= size)
-        {
-            requestData.request.SetMethod(Http::Method::WEBSOCKET);
-            requestData.data.erase(requestData.data.begin(), requestData.data.begin() + size);
-            requestData.readyForDispatch = true;
-            requestData.handshake = false;
-            retval = true;
-        }
+        // there are no streaming routes here, the body is parsed as usual
+        result = requestData.request.Parse(requestData.data, size);
+    }
+    if(result != Request::ParseResult::Error)
+    {
+        // a partial body is parsed as it arrives, its bytes are consumed too
+        requestData.data.erase(requestData.data.begin(), requestData.data.begin() + size);
+    }
+    if(result == Request::ParseResult::Complete)
+    {
+        requestData.request.SetMethod(Http::Method::WEBSOCKET);
+        requestData.readyForDispatch = true;
+        requestData.handshake = false;
+        retval = true;
     }
 
     return retval;
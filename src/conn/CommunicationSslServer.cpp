@@ -20,11 +20,12 @@ using namespace WebCpp;
 CommunicationSslServer::CommunicationSslServer(const std::string &cert, const std::string &key) noexcept:
     ICommunicationServer(SocketPool::Domain::Inet,
                          SocketPool::Type::Stream,
-                         SocketPool::Options::ReuseAddr | SocketPool::Options::Ssl)
+                         SocketPool::Options::ReuseAddr | SocketPool::Options::Ssl | SocketPool::Options::NoDelay)
 {
-    m_sockets.SetSslCredentials(cert, key);
-    m_sockets.SetPort(DEFAULT_SSL_PORT);
-    m_sockets.SetHost(DEFAULT_SSL_HOST);
+    m_cert = cert;
+    m_key = key;
+    m_port = DEFAULT_SSL_PORT;
+    m_host = DEFAULT_SSL_HOST;
 }
 
 bool CommunicationSslServer::Init()
@@ -57,4 +58,9 @@ bool CommunicationSslServer::Connect(const std::string &address, int port)
     return m_connected;
 }
 
+void CommunicationSslServer::InitSockets(SocketPool &sockets)
+{
+    sockets.SetSslCredentials(m_cert, m_key);
+}
+
 #endif
@@ -23,10 +23,10 @@ using namespace WebCpp;
 CommunicationTcpServer::CommunicationTcpServer() noexcept:
     ICommunicationServer(SocketPool::Domain::Inet,
                          SocketPool::Type::Stream,
-                         SocketPool::Options::ReuseAddr)
+                         SocketPool::Options::ReuseAddr | SocketPool::Options::NoDelay)
 {
-    m_sockets.SetPort(DEFAULT_HTTP_PORT);
-    m_sockets.SetHost(DEFAULT_HTTP_HOST);
+    m_port = DEFAULT_HTTP_PORT;
+    m_host = DEFAULT_HTTP_HOST;
 }
 
 CommunicationTcpServer::~CommunicationTcpServer()
@@ -4,6 +4,8 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <numeric>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include "DebugPrint.h"
@@ -13,32 +15,124 @@
 
 using namespace WebCpp;
 
+ICommunicationServer::Reactor::Reactor(size_t id, size_t maxCount, SocketPool::Domain domain, SocketPool::Type type, SocketPool::Options options):
+    id(id),
+    sockets(maxCount, SocketPool::Service::Server, domain, type, options)
+{
+
+}
+
+ICommunicationServer::WriteItem::WriteItem(WriteItem &&other) noexcept:
+    data(std::move(other.data)),
+    position(other.position),
+    file(other.file),
+    offset(other.offset),
+    size(other.size)
+{
+    other.file = (-1);
+}
+
+ICommunicationServer::WriteItem &ICommunicationServer::WriteItem::operator=(WriteItem &&other) noexcept
+{
+    if(this != &other)
+    {
+        if(file != (-1))
+        {
+            close(file);
+        }
+        data = std::move(other.data);
+        position = other.position;
+        file = other.file;
+        offset = other.offset;
+        size = other.size;
+        other.file = (-1);
+    }
+    return *this;
+}
+
+ICommunicationServer::WriteItem::~WriteItem()
+{
+    if(file != (-1))
+    {
+        close(file);
+    }
+}
+
 ICommunicationServer::ICommunicationServer(SocketPool::Domain domain,
                                            SocketPool::Type type,
                                            SocketPool::Options options):
-    m_sockets(MAX_CLIENTS + 1, SocketPool::Service::Server, domain, type, options)
+    m_domain(domain),
+    m_type(type),
+    m_options(options),
+    m_host(DEFAULT_HOST),
+    m_port(DEFAULT_PORT)
 {
 
 }
 
 void ICommunicationServer::SetPort(int port)
 {
-    m_sockets.SetPort(port);
+    m_port = port;
 }
 
 int ICommunicationServer::GetPort() const
 {
-    return m_sockets.GetPort();
+    return m_port;
 }
 
 void ICommunicationServer::SetHost(const std::string &host)
 {
-    m_sockets.SetHost(host);
+    m_host = host;
 }
 
 std::string ICommunicationServer::GetHost() const
 {
-    return m_sockets.GetHost();
+    return m_host;
+}
+
+void ICommunicationServer::SetMaxConnections(size_t count)
+{
+    m_maxConnections = count;
+}
+
+size_t ICommunicationServer::GetMaxConnections() const
+{
+    return m_maxConnections;
+}
+
+size_t ICommunicationServer::GetConnectionsCount() const
+{
+    return std::accumulate(m_reactors.begin(), m_reactors.end(), static_cast<size_t>(0),
+                           [](size_t count, const std::unique_ptr<Reactor> &reactor) { return count + reactor->sockets.GetActiveCount(); });
+}
+
+void ICommunicationServer::SetPollMode(SocketPool::PollMode mode)
+{
+    m_pollMode = mode;
+    for(auto &reactor: m_reactors)
+    {
+        reactor->sockets.SetPollMode(mode);
+    }
+}
+
+SocketPool::PollMode ICommunicationServer::GetPollMode() const
+{
+    return m_pollMode;
+}
+
+void ICommunicationServer::SetReactorCount(size_t count)
+{
+    if(count == 0) // one reactor per CPU core
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (cores > 0) ? static_cast<size_t>(cores) : DEFAULT_REACTOR_COUNT;
+    }
+    m_reactorCount = count;
+}
+
+size_t ICommunicationServer::GetReactorCount() const
+{
+    return m_reactorCount;
 }
 
 bool ICommunicationServer::Init()
@@ -48,10 +142,36 @@ bool ICommunicationServer::Init()
 
     try
     {
-        if(m_sockets.Create(true) == ERROR)
+        size_t count = m_reactorCount;
+#ifndef SO_REUSEPORT
+        if(count > 1)
         {
-            SetLastError(std::string("server socket create error: ") + m_sockets.GetLastError());
-            throw std::runtime_error(GetLastError());
+            DebugPrint() << "CommunicationServer::Init: SO_REUSEPORT isn't supported, fallback to single reactor" << std::endl;
+            count = 1;
+        }
+#endif
+        SocketPool::Options options = m_options;
+        if(count > 1)
+        {
+            options = options | SocketPool::Options::ReusePort;
+        }
+
+        // the limit is shared between the reactors, +1 is the listening socket
+        size_t maxCount = (m_maxConnections + count - 1) / count + 1;
+        for(size_t i = 0;i < count;i ++)
+        {
+            std::unique_ptr<Reactor> reactor(new Reactor(i, maxCount, m_domain, m_type, options));
+            reactor->sockets.SetPort(m_port);
+            reactor->sockets.SetHost(m_host);
+            reactor->sockets.SetPollMode(m_pollMode);
+            InitSockets(reactor->sockets);
+            m_reactors.push_back(std::move(reactor));
+
+            if(m_reactors.back()->sockets.Create(true) == ERROR)
+            {
+                SetLastError(std::string("server socket create error: ") + m_reactors.back()->sockets.GetLastError());
+                throw std::runtime_error(GetLastError());
+            }
         }
 
         retval = true;
@@ -59,7 +179,8 @@ bool ICommunicationServer::Init()
 
     catch(...)
     {
-        CloseConnection(0);
+        CloseConnections();
+        m_reactors.clear();
         DebugPrint() << "CommunicationServer::Init error: " << GetLastError() << std::endl;
         retval = false;
     }
@@ -73,12 +194,26 @@ bool ICommunicationServer::Run()
 
     try
     {
-        auto f = std::bind(&ICommunicationServer::ReadThread, this, std::placeholders::_1);
-        m_readThread.SetFunction(f);
-        m_running = m_readThread.Start();
+        m_running = true;
+        for(auto &reactor: m_reactors)
+        {
+            auto f = std::bind(&ICommunicationServer::ReadThread, this, reactor.get(), std::placeholders::_1);
+            reactor->thread.SetFunction(f);
+            reactor->exited = false;
+            if(reactor->thread.Start() == false)
+            {
+                SetLastError(reactor->thread.GetLastError());
+                m_running = false;
+                break;
+            }
+        }
+
         if(m_running == false)
         {
-            SetLastError(m_readThread.GetLastError());
+            for(auto &reactor: m_reactors)
+            {
+                reactor->thread.Stop(true);
+            }
         }
     }
     catch(...)
@@ -91,7 +226,10 @@ bool ICommunicationServer::Run()
 
 bool ICommunicationServer::WaitFor()
 {
-    m_readThread.Wait();
+    for(auto &reactor: m_reactors)
+    {
+        reactor->thread.Wait();
+    }
     return true;
 }
 
@@ -101,16 +239,20 @@ bool ICommunicationServer::Connect(const std::string &host, int port)
 
     try
     {
-        if(m_sockets.Bind(host, port) == false)
+        // every reactor has its own listening socket bound to the same address
+        for(auto &reactor: m_reactors)
         {
-            SetLastError(std::string("socket bind error: ") + m_sockets.GetLastError());
-            throw std::runtime_error(GetLastError());
-        }
+            if(reactor->sockets.Bind(host, port) == false)
+            {
+                SetLastError(std::string("socket bind error: ") + reactor->sockets.GetLastError());
+                throw std::runtime_error(GetLastError());
+            }
 
-        if(m_sockets.Listen() == false)
-        {
-            SetLastError(std::string("socket listen error: ") + m_sockets.GetLastError());
-            throw std::runtime_error(GetLastError());
+            if(reactor->sockets.Listen() == false)
+            {
+                SetLastError(std::string("socket listen error: ") + reactor->sockets.GetLastError());
+                throw std::runtime_error(GetLastError());
+            }
         }
 
         return true;
@@ -118,7 +260,7 @@ bool ICommunicationServer::Connect(const std::string &host, int port)
 
     catch(...)
     {
-        CloseConnection(0);
+        CloseConnections();
         DebugPrint() << "CommunicationServer::Connect error: " << GetLastError() << std::endl;
         return false;
     }
@@ -128,7 +270,26 @@ bool ICommunicationServer::Close(bool wait)
 {
     if(m_running == true)
     {
-        m_readThread.Stop(false);
+        for(auto &reactor: m_reactors)
+        {
+            reactor->thread.Stop(false);
+        }
+        if(wait)
+        {
+            // no callback is called after that, the owner can release what they use.
+            // The threads aren't joined here, WaitFor() can be joining them
+            for(auto &reactor: m_reactors)
+            {
+                if(reactor->thread.IsCurrent() == false)
+                {
+                    Lock lock(reactor->exitMutex);
+                    while(reactor->exited == false)
+                    {
+                        reactor->exit.Wait(reactor->exitMutex);
+                    }
+                }
+            }
+        }
         m_running = false;
 
         CloseConnections();
@@ -138,22 +299,102 @@ bool ICommunicationServer::Close(bool wait)
 }
 
 bool ICommunicationServer::CloseConnection(int connID)
-{   
-    bool retval = m_sockets.CloseSocket(connID);
+{
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return false;
+    }
+
+    // the index can be taken by a new connection as soon as the slot is released,
+    // so its queue and whatever the callback cleans up go first
+    bool retval = reactor->sockets.CloseSocket(index, false);
     if(retval)
     {
+        std::shared_ptr<Outbound> outbound;
+        {
+            Lock lock(reactor->outboundMutex);
+            auto it = reactor->outbound.find(index);
+            if(it != reactor->outbound.end())
+            {
+                outbound = it->second;
+                reactor->outbound.erase(it);
+            }
+        }
+        if(outbound != nullptr)
+        {
+            // a writer waiting for room gives up
+            Lock lock(outbound->mutex);
+            outbound->closed = true;
+            outbound->room.FireAll();
+        }
+
         if(m_closeConnectionCallback != nullptr)
         {
             m_closeConnectionCallback(connID);
         }
+        reactor->sockets.ReleaseSlot(index);
     }
 
     return retval;
 }
 
+bool ICommunicationServer::CloseAfterWrite(int connID)
+{
+    // nothing is read anymore, the queued data is sent first
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return false;
+    }
+
+    auto outbound = GetOutbound(*reactor, index, true);
+    {
+        Lock lock(outbound->mutex);
+        outbound->closing = true;
+        outbound->stopped ++;
+        if(outbound->items.empty() == false)
+        {
+            return reactor->sockets.SetPollEvents(index, false, true);
+        }
+    }
+
+    return CloseConnection(connID);
+}
+
+void ICommunicationServer::InitSockets(SocketPool &)
+{
+
+}
+
 void ICommunicationServer::CloseConnections()
-{  
-    m_sockets.CloseSockets();
+{
+    for(auto &reactor: m_reactors)
+    {
+        reactor->sockets.CloseSockets();
+        Lock lock(reactor->outboundMutex);
+        reactor->outbound.clear();
+    }
+}
+
+int ICommunicationServer::ToConnID(const Reactor &reactor, size_t index) const
+{
+    // the IDs are interleaved so with the only reactor the ID is the socket index
+    return static_cast<int>(index * m_reactors.size() + reactor.id);
+}
+
+ICommunicationServer::Reactor* ICommunicationServer::FromConnID(int connID, size_t &index) const
+{
+    if(connID < 0 || m_reactors.empty())
+    {
+        return nullptr;
+    }
+
+    size_t id = static_cast<size_t>(connID);
+    index = id / m_reactors.size();
+    return m_reactors[id % m_reactors.size()].get();
 }
 
 bool ICommunicationServer::Write(int connID, ByteArray &data)
@@ -162,6 +403,15 @@ bool ICommunicationServer::Write(int connID, ByteArray &data)
 }
 
 bool ICommunicationServer::Write(int connID, ByteArray &data, size_t size)
+{
+    std::vector<struct iovec> buffers(1);
+    buffers[0].iov_base = data.data();
+    buffers[0].iov_len = std::min(size, data.size());
+
+    return Write(connID, buffers);
+}
+
+bool ICommunicationServer::Write(int connID, const std::vector<struct iovec> &buffers)
 {
     ClearError();
 
@@ -172,16 +422,67 @@ bool ICommunicationServer::Write(int connID, ByteArray &data, size_t size)
     }
 
     bool retval = false;
-    Lock lock(m_writeMutex);
 
     try
     {
-        auto pos = m_sockets.Write(data.data(), size, connID);
-        retval = (pos == size);
-        if(retval == false)
+        size_t index;
+        Reactor *reactor = FromConnID(connID, index);
+        if(reactor == nullptr)
+        {
+            throw std::runtime_error("wrong connection ID: " + std::to_string(connID));
+        }
+
+        auto outbound = GetOutbound(*reactor, index, true);
+        Lock lock(outbound->mutex);
+
+        // the buffers are gathered into as few system calls as possible,
+        // what the socket doesn't take right now is queued as one item
+        std::vector<struct iovec> pending(buffers);
+        size_t first = 0;
+        if(outbound->items.empty())
+        {
+            while(first < pending.size())
+            {
+                if(pending[first].iov_len == 0)
+                {
+                    first ++;
+                    continue;
+                }
+                size_t sent = reactor->sockets.WriteNoWait(pending.data() + first, pending.size() - first, index);
+                if(sent == static_cast<size_t>(ERROR))
+                {
+                    throw std::runtime_error(reactor->sockets.GetLastError());
+                }
+                if(sent == 0)
+                {
+                    break;
+                }
+                while(sent > 0 && first < pending.size())
+                {
+                    size_t part = std::min(sent, pending[first].iov_len);
+                    pending[first].iov_base = static_cast<char *>(pending[first].iov_base) + part;
+                    pending[first].iov_len -= part;
+                    sent -= part;
+                    if(pending[first].iov_len == 0)
+                    {
+                        first ++;
+                    }
+                }
+            }
+        }
+
+        WriteItem item;
+        for(size_t i = first;i < pending.size();i ++)
         {
-            SetLastError("send " + std::to_string(pos) + " of " + std::to_string(size) + " bytes");
+            const char *ptr = static_cast<const char *>(pending[i].iov_base);
+            item.data.insert(item.data.end(), ptr, ptr + pending[i].iov_len);
         }
+        if(item.data.empty() == false)
+        {
+            item.size = item.data.size();
+            Enqueue(*reactor, index, *outbound, std::move(item));
+        }
+        retval = true;
     }
     catch(const std::exception &ex)
     {
@@ -192,51 +493,227 @@ bool ICommunicationServer::Write(int connID, ByteArray &data, size_t size)
     return retval;
 }
 
-void *ICommunicationServer::ReadThread(bool &running)
+bool ICommunicationServer::WriteFile(int connID, const std::string &path, size_t offset, size_t size)
+{
+    ClearError();
+
+    if(m_initialized == false || m_connected == false)
+    {
+        SetLastError("not initialized or not connected");
+        return false;
+    }
+
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        SetLastError("wrong connection ID: " + std::to_string(connID));
+        return false;
+    }
+
+    WriteItem item;
+    item.file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(item.file == (-1))
+    {
+        SetLastError("file " + path + " failed to open: " + strerror(errno));
+        return false;
+    }
+    item.offset = static_cast<off_t>(offset);
+    item.size = size;
+
+    auto outbound = GetOutbound(*reactor, index, true);
+    Lock lock(outbound->mutex);
+    if(outbound->items.empty())
+    {
+        // send what the socket takes right now, the rest is sent by the reactor
+        while(item.size > 0)
+        {
+            size_t sent = SendItem(reactor->sockets, index, item);
+            if(sent == static_cast<size_t>(ERROR))
+            {
+                SetLastError("error sending file: " + reactor->sockets.GetLastError());
+                return false;
+            }
+            if(sent == 0)
+            {
+                break;
+            }
+        }
+        if(item.size == 0)
+        {
+            return true;
+        }
+    }
+
+    Enqueue(*reactor, index, *outbound, std::move(item));
+
+    return true;
+}
+
+bool ICommunicationServer::IsWritePending(int connID) const
+{
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return false;
+    }
+
+    auto outbound = GetOutbound(*reactor, index, false);
+    if(outbound == nullptr)
+    {
+        return false;
+    }
+
+    Lock lock(outbound->mutex);
+    return (outbound->items.empty() == false);
+}
+
+size_t ICommunicationServer::GetWriteQueueSize(int connID) const
+{
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return 0;
+    }
+
+    auto outbound = GetOutbound(*reactor, index, false);
+    if(outbound == nullptr)
+    {
+        return 0;
+    }
+
+    Lock lock(outbound->mutex);
+    return outbound->size;
+}
+
+size_t ICommunicationServer::GetWriteProgress(int connID) const
 {
-    int retval = (-1);
+    // returns the bytes sent from the queue since the previous call
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return 0;
+    }
+
+    auto outbound = GetOutbound(*reactor, index, false);
+    if(outbound == nullptr)
+    {
+        return 0;
+    }
+
+    Lock lock(outbound->mutex);
+    size_t progress = outbound->progress;
+    outbound->progress = 0;
+    return progress;
+}
+
+bool ICommunicationServer::WaitForRoom(int connID, uint32_t timeout)
+{
+    // the writer sleeps until the reactor sends the queue down to the low watermark,
+    // it fails if the client takes nothing for the timeout (0 - no limit) or goes away
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return false;
+    }
+
+    auto outbound = GetOutbound(*reactor, index, false);
+    if(outbound == nullptr)
+    {
+        return true;
+    }
+
+    Lock lock(outbound->mutex);
+    size_t queued = outbound->size;
+    while(outbound->size > m_writeHighWatermark && outbound->closed == false)
+    {
+        if(timeout == 0)
+        {
+            outbound->room.Wait(outbound->mutex);
+        }
+        else if(outbound->room.Wait(outbound->mutex, timeout) == false && outbound->size >= queued)
+        {
+            return false;
+        }
+        queued = outbound->size;
+    }
+
+    return (outbound->closed == false);
+}
+
+void ICommunicationServer::SetWriteWatermarks(size_t high, size_t low)
+{
+    m_writeHighWatermark = high;
+    m_writeLowWatermark = std::min(low, high);
+}
+
+bool ICommunicationServer::PauseReading(int connID, bool pause)
+{
+    // the data is read but can't be processed as fast, the client isn't read until it's resumed.
+    // The pauses are counted, reading goes on when all those who paused it resumed
+    size_t index;
+    Reactor *reactor = FromConnID(connID, index);
+    if(reactor == nullptr)
+    {
+        return false;
+    }
+
+    auto outbound = GetOutbound(*reactor, index, pause);
+    if(outbound == nullptr)
+    {
+        return false;
+    }
+
+    Lock lock(outbound->mutex);
+    if(pause)
+    {
+        outbound->stopped ++;
+    }
+    else if(outbound->stopped > 0)
+    {
+        outbound->stopped --;
+    }
+    return reactor->sockets.SetPollEvents(index, !outbound->paused && !outbound->stopped, !outbound->items.empty());
+}
+
+void *ICommunicationServer::ReadThread(Reactor *reactor, bool &running)
+{
+    SocketPool &sockets = reactor->sockets;
 
     try
     {
-        m_sockets.SetPollRead();
+        sockets.SetPollRead();
         while(running)
         {
-            if(m_sockets.Poll())
+            if(sockets.Poll())
             {
-                for (int i = 0; i < m_sockets.GetCount(); i++)
+                // only the sockets that have pending events are reported
+                for(size_t i = 0;i < sockets.GetReadyCount();i ++)
                 {
-                    if(m_sockets.IsPollError(i))
+                    size_t index = sockets.GetReadyIndex(i);
+                    if(sockets.IsPollError(index))
                     {
-                        CloseConnection(i);
+                        CloseConnection(ToConnID(*reactor, index));
                     }
-                    else if(m_sockets.HasData(i))
+                    else
                     {
-                        if (i == 0) // new client connected
+                        if(index != 0 && sockets.CanWrite(index))
                         {
-                            int id = m_sockets.Accept();
-                            if(id != ERROR)
-                            {
-                                if(m_newConnectionCallback != nullptr)
-                                {
-                                    m_newConnectionCallback(id, m_sockets.GetRemoteAddress(id));
-                                }
-                            }
+                            WriteConnection(*reactor, index);
                         }
-                        else // existing socket data received
+                        if(sockets.HasData(index))
                         {
-                            auto readBytes = m_sockets.Read(m_readBuffer, READ_BUFFER_SIZE, i);
-                            if(readBytes != ERROR)
+                            if (index == 0) // new client connected
                             {
-                                if(m_dataReadyCallback != nullptr)
-                                {
-                                    ByteArray data;
-                                    data.insert(data.end(), m_readBuffer, m_readBuffer + readBytes);
-                                    m_dataReadyCallback(i, data);
-                                }
+                                AcceptConnections(*reactor);
                             }
-                            else
+                            else // existing socket data received
                             {
-                                CloseConnection(i);
+                                ReadConnection(*reactor, index);
                             }
                         }
                     }
@@ -249,5 +726,231 @@ void *ICommunicationServer::ReadThread(bool &running)
         DebugPrint() << "critical unexpected error occured in the read thread" << std::endl;
     }
 
+    Lock lock(reactor->exitMutex);
+    reactor->exited = true;
+    reactor->exit.FireAll();
     return nullptr;
 }
+
+void ICommunicationServer::AcceptConnections(Reactor &reactor)
+{
+    // in the edge-triggered mode we get only one notification for all pending connections
+    do
+    {
+        size_t index = reactor.sockets.Accept();
+        if(index == static_cast<size_t>(ERROR))
+        {
+            break;
+        }
+
+        if(m_newConnectionCallback != nullptr)
+        {
+            m_newConnectionCallback(ToConnID(reactor, index), reactor.sockets.GetRemoteAddress(index));
+        }
+    }
+    while(reactor.sockets.IsEdgeTriggered());
+}
+
+void ICommunicationServer::ReadConnection(Reactor &reactor, size_t index)
+{
+    // the socket is read straight into the buffer that is handed over to the consumer,
+    // it can take the buffer instead of copying it, so the buffer is empty or reused afterwards
+    ByteArray &buffer = reactor.readBuffer;
+    int connID = ToConnID(reactor, index);
+    size_t size = 0;
+    bool closed = false;
+
+    while(true)
+    {
+        if(buffer.size() - size < READ_CHUNK_SIZE)
+        {
+            buffer.resize(std::max(size * 2, size + READ_CHUNK_SIZE));
+        }
+
+        size_t room = buffer.size() - size;
+        auto readBytes = reactor.sockets.Read(buffer.data() + size, room, index);
+        if(readBytes == static_cast<size_t>(ERROR))
+        {
+            closed = true;
+            break;
+        }
+
+        if(readBytes == 0) // EAGAIN, the socket is drained
+        {
+            break;
+        }
+
+        size += readBytes;
+        if(size >= MAX_READ_SIZE) // don't keep the whole upload here
+        {
+            buffer.resize(size);
+            if(m_dataReadyCallback != nullptr)
+            {
+                m_dataReadyCallback(connID, buffer);
+            }
+            buffer.clear();
+            size = 0;
+
+            // the consumer can't take more now, the rest is read when it resumes
+            if(IsReadPaused(reactor, index))
+            {
+                break;
+            }
+        }
+
+        // level-triggered poll notifies again if there is something left
+        if(reactor.sockets.IsEdgeTriggered() == false && readBytes < room)
+        {
+            break;
+        }
+    }
+
+    buffer.resize(size);
+    if(size > 0 && m_dataReadyCallback != nullptr)
+    {
+        m_dataReadyCallback(connID, buffer);
+    }
+    buffer.clear();
+
+    if(closed)
+    {
+        CloseConnection(connID);
+    }
+}
+
+void ICommunicationServer::WriteConnection(Reactor &reactor, size_t index)
+{
+    auto outbound = GetOutbound(reactor, index, false);
+    if(outbound == nullptr)
+    {
+        reactor.sockets.SetPollEvents(index, true, false);
+        return;
+    }
+
+    bool failed = false;
+    bool close = false;
+    {
+        Lock lock(outbound->mutex);
+        while(outbound->items.empty() == false)
+        {
+            WriteItem &item = outbound->items.front();
+            size_t sent = SendItem(reactor.sockets, index, item);
+            if(sent == static_cast<size_t>(ERROR))
+            {
+                failed = true;
+                break;
+            }
+            outbound->size -= sent;
+            outbound->progress += sent;
+            if(item.size == 0)
+            {
+                outbound->items.pop_front();
+            }
+            else if(sent == 0) // the socket is full, wait for the next notification
+            {
+                break;
+            }
+        }
+
+        bool resume = (outbound->paused && outbound->size <= m_writeLowWatermark);
+        if(resume)
+        {
+            outbound->paused = false;
+            outbound->room.FireAll();
+        }
+        if(outbound->items.empty() || resume)
+        {
+            reactor.sockets.SetPollEvents(index, !outbound->paused && !outbound->stopped, !outbound->items.empty());
+        }
+        close = (outbound->closing && outbound->items.empty());
+    }
+
+    if(failed || close)
+    {
+        CloseConnection(ToConnID(reactor, index));
+    }
+}
+
+std::shared_ptr<ICommunicationServer::Outbound> ICommunicationServer::GetOutbound(Reactor &reactor, size_t index, bool create) const
+{
+    Lock lock(reactor.outboundMutex);
+    auto it = reactor.outbound.find(index);
+    if(it != reactor.outbound.end())
+    {
+        return it->second;
+    }
+
+    if(create == false)
+    {
+        return nullptr;
+    }
+
+    auto outbound = std::make_shared<Outbound>();
+    reactor.outbound.insert(std::make_pair(index, outbound));
+    return outbound;
+}
+
+bool ICommunicationServer::IsReadPaused(Reactor &reactor, size_t index) const
+{
+    auto outbound = GetOutbound(reactor, index, false);
+    if(outbound == nullptr)
+    {
+        return false;
+    }
+
+    Lock lock(outbound->mutex);
+    return outbound->paused || outbound->stopped > 0;
+}
+
+size_t ICommunicationServer::SendItem(SocketPool &sockets, size_t index, WriteItem &item)
+{
+    size_t sent;
+    if(item.file != (-1) && (m_options & SocketPool::Options::Ssl) != SocketPool::Options::Ssl)
+    {
+        sent = sockets.SendFile(item.file, item.offset, item.size, index);
+    }
+    else
+    {
+        // the data has to be encrypted so the file is read by chunks, a chunk is kept
+        // until it's sent as a whole since an unfinished SSL write is continued with the same data
+        if(item.file != (-1) && item.position == item.data.size())
+        {
+            item.data.resize(std::min(item.size, static_cast<size_t>(WRITE_FILE_CHUNK_SIZE)));
+            ssize_t bytes = pread(item.file, item.data.data(), item.data.size(), item.offset);
+            if(bytes <= 0)
+            {
+                SetLastError("file read error");
+                return ERROR;
+            }
+            item.data.resize(static_cast<size_t>(bytes));
+            item.position = 0;
+            item.offset += bytes;
+        }
+
+        sent = sockets.WriteNoWait(item.data.data() + item.position, item.data.size() - item.position, index);
+        if(sent != static_cast<size_t>(ERROR))
+        {
+            item.position += sent;
+        }
+    }
+
+    if(sent != static_cast<size_t>(ERROR))
+    {
+        item.size -= sent;
+    }
+
+    return sent;
+}
+
+void ICommunicationServer::Enqueue(Reactor &reactor, size_t index, Outbound &outbound, WriteItem &&item)
+{
+    // the caller holds the outbound lock
+    outbound.size += item.size;
+    outbound.items.push_back(std::move(item));
+    if(outbound.size > m_writeHighWatermark)
+    {
+        // the client doesn't take the responses, don't read its new requests for now
+        outbound.paused = true;
+    }
+    reactor.sockets.SetPollEvents(index, !outbound.paused && !outbound.stopped, true);
+}
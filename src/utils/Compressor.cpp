@@ -0,0 +1,105 @@
+#ifdef WITH_ZLIB
+#include <cstring>
+#include "Compressor.h"
+
+
+using namespace WebCpp;
+
+Compressor::~Compressor()
+{
+    if(m_initialized)
+    {
+        deflateEnd(&m_stream);
+    }
+}
+
+bool Compressor::Init(Format format, int level)
+{
+    ClearError();
+
+    if(m_initialized)
+    {
+        deflateEnd(&m_stream);
+        m_initialized = false;
+    }
+
+    memset(&m_stream, 0, sizeof(m_stream));
+    m_stream.zalloc = Z_NULL;
+    m_stream.zfree = Z_NULL;
+    m_stream.opaque = Z_NULL;
+
+    int windowBits = (format == Format::Gzip) ? 16 + MAX_WBITS : MAX_WBITS;
+    if(deflateInit2(&m_stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        SetLastError("deflate init failed");
+        return false;
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+bool Compressor::Compress(const uint8_t *data, size_t size, ByteArray &output, bool flush)
+{
+    // a flush makes everything passed so far decodable by the client,
+    // that's needed for a streamed response but costs some ratio
+    return Deflate(data, size, output, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+}
+
+bool Compressor::Finish(ByteArray &output)
+{
+    return Deflate(nullptr, 0, output, Z_FINISH);
+}
+
+bool Compressor::Reset()
+{
+    // the same stream is used for the next data without allocating it again
+    if(m_initialized == false || deflateReset(&m_stream) != Z_OK)
+    {
+        SetLastError("deflate reset failed");
+        return false;
+    }
+
+    return true;
+}
+
+bool Compressor::IsInitialized() const
+{
+    return m_initialized;
+}
+
+bool Compressor::Deflate(const uint8_t *data, size_t size, ByteArray &output, int flush)
+{
+    ClearError();
+
+    if(m_initialized == false)
+    {
+        SetLastError("not initialized");
+        return false;
+    }
+
+    m_stream.next_in = const_cast<uint8_t *>(data);
+    m_stream.avail_in = static_cast<uInt>(size);
+
+    // deflate() writes straight to the output, it's extended while it's filled
+    int err;
+    do
+    {
+        size_t used = output.size();
+        output.resize(used + COMPRESSOR_CHUNK_SIZE);
+        m_stream.next_out = output.data() + used;
+        m_stream.avail_out = COMPRESSOR_CHUNK_SIZE;
+        err = deflate(&m_stream, flush);
+        output.resize(used + COMPRESSOR_CHUNK_SIZE - m_stream.avail_out);
+        if(err == Z_STREAM_ERROR)
+        {
+            SetLastError("deflate failed");
+            return false;
+        }
+    }
+    while(m_stream.avail_out == 0 || (flush == Z_FINISH && err != Z_STREAM_END));
+
+    return true;
+}
+
+#endif // WITH_ZLIB
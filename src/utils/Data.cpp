@@ -127,69 +127,33 @@ std::string Data::Sha256(const std::string &string)
 
 #ifdef WITH_ZLIB
 #include "zlib.h"
-#define CHUNK 0x4000
+#include "Compressor.h"
+#include "Decompressor.h"
 
 ByteArray Data::Compress(const ByteArray &data)
 {
-    return data;
+    ByteArray retval;
+    WebCpp::Compressor compressor;
+    if(compressor.Init(WebCpp::Compressor::Format::Deflate) == false ||
+       compressor.Compress(data.data(), data.size(), retval) == false ||
+       compressor.Finish(retval) == false)
+    {
+        return ByteArray();
+    }
+
+    return retval;
 }
 
 ByteArray Data::Uncompress(const ByteArray &data)
 {
     ByteArray retval;
-
-    try
+    WebCpp::Decompressor decompressor;
+    decompressor.Init(WebCpp::Decompressor::Format::Deflate);
+    if(decompressor.Decompress(data.data(), data.size(), [&retval](const ByteArray &decoded, size_t offset, size_t size) -> bool
     {
-        z_stream strm = {0};
-        unsigned char out[CHUNK];
-
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-        strm.next_in = nullptr;
-        strm.avail_in = 0;
-
-        if(inflateInit2(&strm, -MAX_WBITS) != Z_OK)
-        {
-            throw std::runtime_error("");
-        }
-
-        bool done = false;
-        size_t pos = 0;
-        size_t sizeIn;
-        size_t sizeOut = 0;
-        uint8_t *ptr = const_cast<uint8_t *>(data.data());
-        size_t size = data.size();
-
-        while(!done)
-        {
-            sizeIn = ((size - pos) > CHUNK ? CHUNK : (size - pos));
-            strm.avail_in = sizeIn;
-            strm.next_in = ptr + pos;
-            strm.avail_out = CHUNK;
-            strm.next_out = out;
-            int err = inflate(&strm, Z_NO_FLUSH);
-            if (err == Z_STREAM_END)
-            {
-                done = true;
-            }
-            else if (err != Z_OK)
-            {
-                throw std::runtime_error("");
-            }
-            size_t chunkSize = strm.total_out - sizeOut;
-            sizeOut = strm.total_out;
-            retval.insert(retval.end(), out, out + chunkSize);
-            pos = strm.total_in;
-            if(pos >= size)
-            {
-                done = true;
-            }
-        }
-
-        inflateEnd(&strm);
-    }
-    catch(...)
+        retval.insert(retval.end(), decoded.begin() + offset, decoded.begin() + offset + size);
+        return true;
+    }) == false)
     {
         return ByteArray();
     }
@@ -199,65 +163,28 @@ ByteArray Data::Uncompress(const ByteArray &data)
 
 ByteArray Data::Zip(const ByteArray &data)
 {
-    return data;
+    ByteArray retval;
+    WebCpp::Compressor compressor;
+    if(compressor.Init(WebCpp::Compressor::Format::Gzip) == false ||
+       compressor.Compress(data.data(), data.size(), retval) == false ||
+       compressor.Finish(retval) == false)
+    {
+        return ByteArray();
+    }
+
+    return retval;
 }
 
 ByteArray Data::Unzip(const ByteArray &data)
 {
     ByteArray retval;
-
-    try
+    WebCpp::Decompressor decompressor;
+    decompressor.Init(WebCpp::Decompressor::Format::Gzip);
+    if(decompressor.Decompress(data.data(), data.size(), [&retval](const ByteArray &decoded, size_t offset, size_t size) -> bool
     {
-        z_stream strm = {0};
-        unsigned char out[CHUNK];
-
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-        strm.next_in = nullptr;
-        strm.avail_in = 0;
-
-        if(inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
-        {
-            throw std::runtime_error("");
-        }
-
-        bool done = false;
-        size_t pos = 0;
-        size_t sizeIn;
-        size_t sizeOut = 0;
-        uint8_t *ptr = const_cast<uint8_t *>(data.data());
-        size_t size = data.size();
-
-        while(!done)
-        {
-            sizeIn = ((size - pos) > CHUNK ? CHUNK : (size - pos));
-            strm.avail_in = sizeIn;
-            strm.next_in = ptr + pos;
-            strm.avail_out = CHUNK;
-            strm.next_out = out;
-            int err = inflate(&strm, Z_SYNC_FLUSH);
-            if (err == Z_STREAM_END)
-            {
-                done = true;
-            }
-            else if (err != Z_OK)
-            {
-                throw std::runtime_error("");
-            }
-            size_t chunkSize = strm.total_out - sizeOut;
-            sizeOut = strm.total_out;
-            retval.insert(retval.end(), out, out + chunkSize);
-            pos = strm.total_in;
-            if(pos >= size)
-            {
-                done = true;
-            }
-        }
-
-        inflateEnd(&strm);
-    }
-    catch(...)
+        retval.insert(retval.end(), decoded.begin() + offset, decoded.begin() + offset + size);
+        return true;
+    }) == false)
     {
         return ByteArray();
     }
@@ -0,0 +1,157 @@
+#ifdef WITH_ZLIB
+#include <cstring>
+#include "Decompressor.h"
+
+
+using namespace WebCpp;
+
+Decompressor::~Decompressor()
+{
+    if(m_allocated)
+    {
+        inflateEnd(&m_stream);
+    }
+}
+
+bool Decompressor::Init(Format format)
+{
+    ClearError();
+
+    // the stream itself is prepared with the first data, the format of a deflate body isn't known before
+    m_format = format;
+    m_started = false;
+    m_finished = false;
+    m_header.clear();
+
+    return true;
+}
+
+bool Decompressor::Decompress(const uint8_t *data, size_t size, const DataFunc &f)
+{
+    ClearError();
+
+    if(m_finished || size == 0)
+    {
+        return true; // anything after the end of the stream is ignored
+    }
+
+    if(m_started == false)
+    {
+        int windowBits = 16 + MAX_WBITS;
+        if(m_format == Format::Deflate)
+        {
+            // "deflate" should be zlib wrapped but some servers send raw deflate data
+            if(m_header.size() + size < 2)
+            {
+                m_header.insert(m_header.end(), data, data + size);
+                return true;
+            }
+            uint8_t first = m_header.empty() ? data[0] : m_header[0];
+            uint8_t second = m_header.empty() ? data[1] : data[0];
+            bool zlib = (first & 0x0F) == Z_DEFLATED && ((first << 8) | second) % 31 == 0;
+            windowBits = zlib ? MAX_WBITS : -MAX_WBITS;
+        }
+        if(Start(windowBits) == false)
+        {
+            return false;
+        }
+        if(m_header.empty() == false)
+        {
+            ByteArray header;
+            header.swap(m_header);
+            if(Inflate(header.data(), header.size(), f) == false)
+            {
+                return false;
+            }
+        }
+    }
+
+    return Inflate(data, size, f);
+}
+
+bool Decompressor::IsFinished() const
+{
+    return m_finished;
+}
+
+bool Decompressor::Start(int windowBits)
+{
+    // the allocated stream is reused when its window is the same
+    if(m_allocated && m_windowBits == windowBits)
+    {
+        if(inflateReset(&m_stream) != Z_OK)
+        {
+            SetLastError("inflate reset failed");
+            return false;
+        }
+    }
+    else
+    {
+        if(m_allocated)
+        {
+            inflateEnd(&m_stream);
+            m_allocated = false;
+        }
+        memset(&m_stream, 0, sizeof(m_stream));
+        m_stream.zalloc = Z_NULL;
+        m_stream.zfree = Z_NULL;
+        m_stream.opaque = Z_NULL;
+        if(inflateInit2(&m_stream, windowBits) != Z_OK)
+        {
+            SetLastError("inflate init failed");
+            return false;
+        }
+        m_allocated = true;
+        m_windowBits = windowBits;
+    }
+
+    if(m_buffer.size() != DECOMPRESSOR_CHUNK_SIZE)
+    {
+        m_buffer.resize(DECOMPRESSOR_CHUNK_SIZE);
+    }
+    m_started = true;
+    return true;
+}
+
+bool Decompressor::Inflate(const uint8_t *data, size_t size, const DataFunc &f)
+{
+    m_stream.next_in = const_cast<uint8_t *>(data);
+    m_stream.avail_in = static_cast<uInt>(size);
+
+    // the output is passed on every time the buffer is filled, it never grows
+    while(m_finished == false)
+    {
+        m_stream.next_out = m_buffer.data();
+        m_stream.avail_out = DECOMPRESSOR_CHUNK_SIZE;
+        int err = inflate(&m_stream, Z_NO_FLUSH);
+        if(err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+        {
+            SetLastError(std::string("inflate failed: ") + (m_stream.msg != nullptr ? m_stream.msg : std::to_string(err)));
+            return false;
+        }
+
+        size_t decoded = DECOMPRESSOR_CHUNK_SIZE - m_stream.avail_out;
+        if(decoded > 0 && f != nullptr && f(m_buffer, 0, decoded) == false)
+        {
+            SetLastError("the data isn't accepted");
+            return false;
+        }
+
+        if(err == Z_STREAM_END)
+        {
+            m_finished = true;
+        }
+        else if(m_stream.avail_in == 0 && m_stream.avail_out > 0)
+        {
+            break; // everything passed is decoded
+        }
+        else if(err == Z_BUF_ERROR && decoded == 0)
+        {
+            break;
+        }
+    }
+
+    return true;
+}
+
+#endif // WITH_ZLIB
@@ -123,6 +123,20 @@ int FileSystem::GetFileSize(const std::string &path)
     return fileSize;
 }
 
+bool FileSystem::GetFileStat(const std::string &path, size_t &size, int64_t &modified)
+{
+    // one call for the size and the modification time (nsec.) of a regular file
+    struct stat sb;
+    if(stat(path.c_str(), &sb) != 0 || S_ISREG(sb.st_mode) == false)
+    {
+        return false;
+    }
+
+    size = static_cast<size_t>(sb.st_size);
+    modified = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+    return true;
+}
+
 char FileSystem::PathDelimiter()
 {
 #ifdef _WIN32
@@ -298,15 +312,21 @@ bool FileSystem::DeleteFolder(const std::string &path)
 
 std::string FileSystem::GetDateTime()
 {
-    time_t tm;
-    struct tm * timeinfo;
-    char buffer[30];
-
-    time(&tm);
-    const time_t *t = &tm;
-    timeinfo = gmtime(t);
-    strftime(buffer, 30, "%a, %d %b %Y %H:%M:%S GMT", timeinfo);
-    return buffer;
+    // the string changes once per second, so each thread formats it
+    // only when the second changes and reuses it for all the responses in between
+    static thread_local time_t cachedTime = 0;
+    static thread_local char cached[30] = {};
+
+    time_t now = time(nullptr);
+    if(now != cachedTime)
+    {
+        struct tm timeinfo;
+        gmtime_r(&now, &timeinfo);
+        strftime(cached, sizeof(cached), "%a, %d %b %Y %H:%M:%S GMT", &timeinfo);
+        cachedTime = now;
+    }
+
+    return cached;
 }
 
 std::string FileSystem::GetFileModifiedTime(const std::string &file)
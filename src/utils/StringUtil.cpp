@@ -1,46 +1,291 @@
 #include <sstream>
 #include <algorithm>
+#include <cstring>
 #include "StringUtil.h"
 #include "iostream"
 #include <iomanip>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define WEBCPP_X86_SIMD
+#include <immintrin.h>
+#endif
 
-size_t StringUtil::SearchPosition(const ByteArray &str, const ByteArray&substring, size_t start, size_t end)
+
+#ifdef WEBCPP_X86_SIMD
+static void ScanBlockSse2(const uint8_t *str, uint64_t &lf, uint64_t &colon)
 {
-    if(str.size() <= 0 || substring.size() <= 0)
+    const __m128i lfs = _mm_set1_epi8(LF);
+    const __m128i colons = _mm_set1_epi8(':');
+    lf = 0;
+    colon = 0;
+    for(size_t i = 0;i < 64;i += 16)
     {
-        return SIZE_MAX;
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        lf |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, lfs)))) << i;
+        colon |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, colons)))) << i;
     }
+}
 
-    const uint8_t* pstr = str.data();
-    const uint8_t* psubstring = substring.data();
-    size_t substringLen = substring.size();
-    if(end == SIZE_MAX)
+__attribute__((target("avx2")))
+static void ScanBlockAvx2(const uint8_t *str, uint64_t &lf, uint64_t &colon)
+{
+    const __m256i lfs = _mm256_set1_epi8(LF);
+    const __m256i colons = _mm256_set1_epi8(':');
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + 32));
+    lf = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, lfs))) |
+            (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, lfs)))) << 32);
+    colon = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, colons))) |
+            (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, colons)))) << 32);
+}
+#else
+static void ScanBlockScalar(const uint8_t *str, uint64_t &lf, uint64_t &colon)
+{
+    lf = 0;
+    colon = 0;
+    for(size_t i = 0;i < 64;i ++)
     {
-        end = str.size() - 1;
+        lf |= static_cast<uint64_t>(str[i] == LF) << i;
+        colon |= static_cast<uint64_t>(str[i] == ':') << i;
     }
+}
+#endif
 
-    for(size_t pos1 = start;pos1 <= end - substringLen + 1; pos1++)
+/* the substring search looks only at the candidates, the positions where the first byte
+ * of the substring matches (memchr) or both the first and the last one do (SIMD filter),
+ * the rest of the substring is compared for them only. 'last' is the last position
+ * the substring can start at, so the loads never go beyond last + size - 1 */
+static size_t SearchScalar(const uint8_t *str, size_t pos, size_t last, const uint8_t *substring, size_t size)
+{
+    const uint8_t *ptr = str + pos;
+    const uint8_t *stop = str + last + 1;
+    while(ptr < stop)
     {
-        size_t pos2;
-        for(pos2 = 0; pos2 < substringLen; pos2++)
+        ptr = static_cast<const uint8_t *>(memchr(ptr, substring[0], stop - ptr));
+        if(ptr == nullptr)
         {
-            if(pstr[pos1 + pos2] == psubstring[pos2])
-            {
-                continue;
-            }
             break;
         }
+        if(memcmp(ptr + 1, substring + 1, size - 1) == 0)
+        {
+            return ptr - str;
+        }
+        ptr ++;
+    }
 
-        if(pos2 == substringLen)
+    return SIZE_MAX;
+}
+
+static size_t SearchReverseScalar(const uint8_t *str, size_t first, size_t pos, const uint8_t *substring, size_t size)
+{
+    for(size_t i = pos + 1;i > first;)
+    {
+        i --;
+        if(str[i] == substring[0] && memcmp(str + i + 1, substring + 1, size - 1) == 0)
         {
-            return pos1;
+            return i;
         }
     }
 
     return SIZE_MAX;
 }
 
+#ifdef WEBCPP_X86_SIMD
+static bool HasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+static size_t SearchSse2(const uint8_t *str, size_t pos, size_t last, const uint8_t *substring, size_t size)
+{
+    const __m128i first = _mm_set1_epi8(static_cast<char>(substring[0]));
+    const __m128i lastByte = _mm_set1_epi8(static_cast<char>(substring[size - 1]));
+    for(;pos + 16 <= last + 1;pos += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + pos));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + pos + size - 1));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, lastByte))));
+        while(mask != 0)
+        {
+            size_t candidate = pos + __builtin_ctz(mask);
+            if(size <= 2 || memcmp(str + candidate + 1, substring + 1, size - 2) == 0)
+            {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return SearchScalar(str, pos, last, substring, size);
+}
+
+static size_t SearchReverseSse2(const uint8_t *str, size_t first, size_t pos, const uint8_t *substring, size_t size)
+{
+    const __m128i firstByte = _mm_set1_epi8(static_cast<char>(substring[0]));
+    const __m128i lastByte = _mm_set1_epi8(static_cast<char>(substring[size - 1]));
+    for(;pos + 1 >= first + 16;pos -= 16)
+    {
+        size_t base = pos - 15;
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + base));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + base + size - 1));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, firstByte), _mm_cmpeq_epi8(blockLast, lastByte))));
+        while(mask != 0)
+        {
+            unsigned int bit = 31 - __builtin_clz(mask);
+            size_t candidate = base + bit;
+            if(size <= 2 || memcmp(str + candidate + 1, substring + 1, size - 2) == 0)
+            {
+                return candidate;
+            }
+            mask &= ~(1u << bit);
+        }
+        if(base == 0)
+        {
+            return SIZE_MAX;
+        }
+    }
+
+    return SearchReverseScalar(str, first, pos, substring, size);
+}
+
+__attribute__((target("avx2")))
+static size_t SearchAvx2(const uint8_t *str, size_t pos, size_t last, const uint8_t *substring, size_t size)
+{
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(substring[0]));
+    const __m256i lastByte = _mm256_set1_epi8(static_cast<char>(substring[size - 1]));
+    for(;pos + 32 <= last + 1;pos += 32)
+    {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + pos));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + pos + size - 1));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, lastByte))));
+        while(mask != 0)
+        {
+            size_t candidate = pos + __builtin_ctz(mask);
+            if(size <= 2 || memcmp(str + candidate + 1, substring + 1, size - 2) == 0)
+            {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return SearchSse2(str, pos, last, substring, size);
+}
+
+__attribute__((target("avx2")))
+static size_t SearchReverseAvx2(const uint8_t *str, size_t first, size_t pos, const uint8_t *substring, size_t size)
+{
+    const __m256i firstByte = _mm256_set1_epi8(static_cast<char>(substring[0]));
+    const __m256i lastByte = _mm256_set1_epi8(static_cast<char>(substring[size - 1]));
+    for(;pos + 1 >= first + 32;pos -= 32)
+    {
+        size_t base = pos - 31;
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + base));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + base + size - 1));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, firstByte), _mm256_cmpeq_epi8(blockLast, lastByte))));
+        while(mask != 0)
+        {
+            unsigned int bit = 31 - __builtin_clz(mask);
+            size_t candidate = base + bit;
+            if(size <= 2 || memcmp(str + candidate + 1, substring + 1, size - 2) == 0)
+            {
+                return candidate;
+            }
+            mask &= ~(1u << bit);
+        }
+        if(base == 0)
+        {
+            return SIZE_MAX;
+        }
+    }
+
+    return SearchReverseSse2(str, first, pos, substring, size);
+}
+#endif
+
+using SearchFunction = size_t (*)(const uint8_t *, size_t, size_t, const uint8_t *, size_t);
+
+// picked once, by what the CPU has
+static SearchFunction GetSearch(bool reverse)
+{
+#ifdef WEBCPP_X86_SIMD
+    if(HasAvx2())
+    {
+        return reverse ? SearchReverseAvx2 : SearchAvx2;
+    }
+    return reverse ? SearchReverseSse2 : SearchSse2;
+#else
+    return reverse ? SearchReverseScalar : SearchScalar;
+#endif
+}
+
+size_t StringUtil::SearchPosition(const ByteArray &str, const ByteArray&substring, size_t start, size_t end)
+{
+    if(str.size() <= 0 || substring.size() <= 0)
+    {
+        return SIZE_MAX;
+    }
+
+    size_t substringLen = substring.size();
+    if(end == SIZE_MAX || end >= str.size())
+    {
+        end = str.size() - 1;
+    }
+    if(start > end || end - start + 1 < substringLen)
+    {
+        return SIZE_MAX;
+    }
+
+    size_t last = end - substringLen + 1;
+    if(substringLen == 1)
+    {
+        const void *ptr = memchr(str.data() + start, substring[0], last - start + 1);
+        return (ptr == nullptr) ? SIZE_MAX : static_cast<const uint8_t *>(ptr) - str.data();
+    }
+
+    static const SearchFunction search = GetSearch(false);
+    return search(str.data(), start, last, substring.data(), substringLen);
+}
+
+void StringUtil::ScanBlock(const ByteArray &str, size_t pos, size_t end, uint64_t &lf, uint64_t &colon)
+{
+    lf = 0;
+    colon = 0;
+    if(str.empty() || pos >= str.size())
+    {
+        return;
+    }
+    if(end == SIZE_MAX || end >= str.size())
+    {
+        end = str.size() - 1;
+    }
+    if(pos > end)
+    {
+        return;
+    }
+
+    // the last block shorter than 64 bytes is copied, nothing is read beyond the end
+    const uint8_t *ptr = str.data() + pos;
+    uint8_t tail[64];
+    size_t size = end - pos + 1;
+    if(size < 64)
+    {
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, ptr, size);
+        ptr = tail;
+    }
+
+#ifdef WEBCPP_X86_SIMD
+    // SSE2 is always there on x86-64, AVX2 is used if the CPU has it
+    using ScanFunction = void (*)(const uint8_t *, uint64_t &, uint64_t &);
+    static const ScanFunction scan = HasAvx2() ? ScanBlockAvx2 : ScanBlockSse2;
+    scan(ptr, lf, colon);
+#else
+    ScanBlockScalar(ptr, lf, colon);
+#endif
+}
+
 StringUtil::Ranges StringUtil::Split(const ByteArray &str, const ByteArray &delimiter, size_t start, size_t end)
 {
     Ranges retval;
@@ -74,38 +319,24 @@ StringUtil::Ranges StringUtil::Split(const ByteArray &str, const ByteArray &deli
 
 size_t StringUtil::SearchPositionReverse(const ByteArray &str, const ByteArray &substring, size_t start, size_t end)
 {
-    const uint8_t* pstr = str.data();
-    const uint8_t* psubstring = substring.data();
-    size_t substringLen = substring.size();
-    if(end == SIZE_MAX)
+    if(str.size() <= 0 || substring.size() <= 0)
     {
-        end = str.size() - 1;
+        return SIZE_MAX;
     }
 
-    if((end - start) < substringLen)
+    size_t substringLen = substring.size();
+    if(end == SIZE_MAX || end >= str.size())
     {
-        return SIZE_MAX;
+        end = str.size() - 1;
     }
 
-    for(size_t pos1 = end; pos1 >= start + substringLen - 1; pos1--)
+    if(start > end || end - start + 1 < substringLen)
     {
-        size_t pos2;
-        for(pos2 = substringLen; pos2 > 0; pos2--)
-        {
-            if(pstr[pos1 - (substringLen - pos2)] == psubstring[pos2 - 1])
-            {
-                continue;
-            }
-            break;
-        }
-
-        if(pos2 == 0)
-        {
-            return pos1 - substringLen + 1;
-        }
+        return SIZE_MAX;
     }
 
-    return SIZE_MAX;
+    static const SearchFunction search = GetSearch(true);
+    return search(str.data(), start, end - substringLen + 1, substring.data(), substringLen);
 }
 
 StringUtil::Ranges StringUtil::SplitReverse(const ByteArray &str, const ByteArray &delimiter, size_t start, size_t end)
@@ -114,7 +345,7 @@ StringUtil::Ranges StringUtil::SplitReverse(const ByteArray &str, const ByteArra
     size_t pos = SIZE_MAX;
     if(end == SIZE_MAX)
     {
-        end = str.size();
+        end = str.size() - 1;
     }
 
     while( (pos = SearchPositionReverse(str, delimiter,start, end)) != SIZE_MAX)
@@ -126,7 +357,7 @@ StringUtil::Ranges StringUtil::SplitReverse(const ByteArray &str, const ByteArra
         if(pos <= start + delimiter.size())
         {
             retval.push_back(Range{start, pos});
-            break;
+            return retval;
         }
         end = pos - 1;
     }
@@ -289,7 +520,7 @@ ByteArray StringUtil::String2ByteArray(const std::string &string)
 void StringUtil::UrlDecode(std::string &str)
 {
     size_t from = 0;
-    while((from = str.find('%', from)) != std::string::npos)
+    while((from = str.find('%', from)) != std::string::npos && from + 2 < str.size())
     {
         std::string value(str.begin() + from + 1, str.begin() + from + 3);
         int ascii;
@@ -298,6 +529,7 @@ void StringUtil::UrlDecode(std::string &str)
             str.erase(from, 3);
             str.insert(from, 1, static_cast<char>(ascii));
         }
+        from ++; // a wrong sequence is left as is
     }
 
     std::replace(str.begin(), str.end(), '+', ' ');
@@ -0,0 +1,219 @@
+#include <unistd.h>
+#include <time.h>
+#include "Lock.h"
+#include "DebugPrint.h"
+#include "ThreadPool.h"
+
+
+using namespace WebCpp;
+
+ThreadPool::ThreadPool(size_t count):
+    m_running(false),
+    m_pending(0),
+    m_processed(0),
+    m_stolen(0),
+    m_totalLatency(0),
+    m_maxLatency(0)
+{
+    SetThreadCount(count);
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+void ThreadPool::SetThreadCount(size_t count)
+{
+    if(count == 0) // one worker per CPU core
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (cores > 0) ? static_cast<size_t>(cores) : DEFAULT_POOL_SIZE;
+    }
+    m_count = count;
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return m_count;
+}
+
+bool ThreadPool::Start()
+{
+    ClearError();
+
+    if(m_running == true)
+    {
+        SetLastError("already started");
+        return false;
+    }
+
+    m_workers.clear();
+    for(size_t i = 0;i < m_count;i ++)
+    {
+        std::unique_ptr<Worker> worker(new Worker());
+        auto f = std::bind(&ThreadPool::WorkerThread, this, i, std::placeholders::_1);
+        worker->thread.SetFunction(f);
+        m_workers.push_back(std::move(worker));
+    }
+    m_pending = 0;
+    m_running = true;
+
+    for(auto &worker: m_workers)
+    {
+        if(worker->thread.Start() == false)
+        {
+            SetLastError("failed to start a worker: " + worker->thread.GetLastError());
+            Stop();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ThreadPool::Stop()
+{
+    if(m_running == false)
+    {
+        return;
+    }
+
+    m_running = false;
+    {
+        Lock lock(m_signalMutex);
+        m_signal.FireAll();
+    }
+
+    // the workers are kept until the next start or the destructor, a late Post()
+    // can still reach a queue, its task is dropped
+    for(auto &worker: m_workers)
+    {
+        worker->thread.Stop(true);
+        Lock lock(worker->mutex);
+        worker->tasks.clear();
+    }
+    m_pending = 0;
+}
+
+bool ThreadPool::IsRunning() const
+{
+    return m_running;
+}
+
+bool ThreadPool::Post(size_t key, const Task &task)
+{
+    // the workers change only in Start() while it isn't running, Stop() keeps them
+    if(m_running == false || m_workers.empty())
+    {
+        return false;
+    }
+
+    // counted together with queueing and taking, so a worker that sees
+    // a pending task finds it in some queue and otherwise sleeps
+    Worker &worker = *m_workers[key % m_workers.size()];
+    {
+        Lock lock(worker.mutex);
+        worker.tasks.push_back(task);
+        m_pending ++;
+    }
+
+    Lock lock(m_signalMutex);
+    m_signal.Fire();
+
+    return true;
+}
+
+ThreadPool::Metrics ThreadPool::GetMetrics() const
+{
+    Metrics metrics;
+    metrics.threads = (m_running ? m_workers.size() : 0);
+    metrics.queueDepth = m_pending;
+    metrics.processed = m_processed;
+    metrics.stolen = m_stolen;
+    metrics.averageLatency = (metrics.processed > 0) ? m_totalLatency / metrics.processed : 0;
+    metrics.maxLatency = m_maxLatency;
+
+    return metrics;
+}
+
+void *ThreadPool::WorkerThread(size_t id, bool &running)
+{
+    while(running && m_running)
+    {
+        {
+            Lock lock(m_signalMutex);
+            while(m_pending == 0 && m_running)
+            {
+                m_signal.Wait(m_signalMutex);
+            }
+        }
+
+        Task task;
+        if(PopTask(id, task) || StealTask(id, task))
+        {
+            uint64_t start = Now();
+            try
+            {
+                task();
+            }
+            catch(...)
+            {
+                DebugPrint() << "ThreadPool: unhandled exception in the task" << std::endl;
+            }
+            UpdateLatency(Now() - start);
+        }
+    }
+
+    return nullptr;
+}
+
+bool ThreadPool::PopTask(size_t id, Task &task)
+{
+    Worker &worker = *m_workers[id];
+    Lock lock(worker.mutex);
+    if(worker.tasks.empty())
+    {
+        return false;
+    }
+
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    m_pending --;
+    return true;
+}
+
+bool ThreadPool::StealTask(size_t id, Task &task)
+{
+    for(size_t i = 1;i < m_workers.size();i ++)
+    {
+        Worker &worker = *m_workers[(id + i) % m_workers.size()];
+        Lock lock(worker.mutex);
+        if(!worker.tasks.empty())
+        {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            m_pending --;
+            m_stolen ++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::UpdateLatency(uint64_t latency)
+{
+    m_processed ++;
+    m_totalLatency += latency;
+
+    uint64_t max = m_maxLatency;
+    while(latency > max && !m_maxLatency.compare_exchange_weak(max, latency));
+}
+
+uint64_t ThreadPool::Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
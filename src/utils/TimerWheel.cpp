@@ -0,0 +1,291 @@
+#include <time.h>
+#include "Lock.h"
+#include "Platform.h"
+#include "TimerWheel.h"
+
+
+using namespace WebCpp;
+
+TimerWheel::TimerWheel(uint32_t tick, size_t slots, size_t shards):
+    m_tick(tick > 0 ? tick : DEFAULT_TIMER_TICK),
+    m_slotCount(slots > 0 ? slots : DEFAULT_TIMER_SLOTS)
+{
+    if(shards == 0)
+    {
+        shards = 1;
+    }
+    for(size_t i = 0;i < shards;i ++)
+    {
+        std::unique_ptr<Shard> shard(new Shard());
+        shard->slots.resize(m_slotCount, nullptr);
+        m_shards.push_back(std::move(shard));
+    }
+}
+
+TimerWheel::~TimerWheel()
+{
+    Stop();
+}
+
+void TimerWheel::SetCallback(const Callback &callback)
+{
+    m_callback = callback;
+}
+
+bool TimerWheel::Start()
+{
+    ClearError();
+
+    if(m_thread.IsRunning())
+    {
+        SetLastError("already started");
+        return false;
+    }
+
+    auto f = std::bind(&TimerWheel::TimerThread, this, std::placeholders::_1);
+    m_thread.SetFunction(f);
+    if(m_thread.Start() == false)
+    {
+        SetLastError("failed to start the timer thread: " + m_thread.GetLastError());
+        return false;
+    }
+
+    return true;
+}
+
+void TimerWheel::Stop()
+{
+    m_thread.Stop(true);
+}
+
+bool TimerWheel::IsRunning() const
+{
+    return m_thread.IsRunning();
+}
+
+void TimerWheel::SetTimer(int connID, Type type, uint32_t delay, bool restart)
+{
+    Shard &shard = GetShard(connID);
+    Lock lock(shard.mutex);
+
+    uint64_t key = Key(connID, type);
+    auto it = shard.timers.find(key);
+    if(it == shard.timers.end())
+    {
+        std::unique_ptr<Timer> timer(new Timer());
+        timer->connID = connID;
+        timer->type = type;
+        Link(shard, timer.get(), delay);
+        shard.timers.insert(std::make_pair(key, std::move(timer)));
+    }
+    else if(restart)
+    {
+        Unlink(shard, it->second.get());
+        Link(shard, it->second.get(), delay);
+    }
+}
+
+void TimerWheel::CancelTimer(int connID, Type type)
+{
+    Shard &shard = GetShard(connID);
+    Lock lock(shard.mutex);
+    Cancel(shard, connID, type);
+}
+
+void TimerWheel::CancelTimers(int connID)
+{
+    Shard &shard = GetShard(connID);
+    Lock lock(shard.mutex);
+
+    // a callback being called for the connection could act on the next one the ID is given to,
+    // so closing waits for it to return. Closing from the callback itself doesn't wait
+    if(m_thread.IsCurrent() == false)
+    {
+        while(shard.firing == connID)
+        {
+            shard.fired.Wait(shard.mutex);
+        }
+    }
+
+    Cancel(shard, connID, Type::KeepAlive);
+    Cancel(shard, connID, Type::Header);
+    Cancel(shard, connID, Type::Read);
+    Cancel(shard, connID, Type::Write);
+}
+
+size_t TimerWheel::GetCount() const
+{
+    size_t count = 0;
+    for(auto &shard: m_shards)
+    {
+        Lock lock(shard->mutex);
+        count += shard->timers.size();
+    }
+
+    return count;
+}
+
+std::string TimerWheel::Type2String(Type type)
+{
+    switch(type)
+    {
+        case Type::KeepAlive: return "keep-alive";
+        case Type::Header:    return "header";
+        case Type::Read:      return "read";
+        case Type::Write:     return "write";
+    }
+
+    return "";
+}
+
+void *TimerWheel::TimerThread(bool &running)
+{
+    std::vector<Expired> expired;
+    uint64_t next = Now() + m_tick;
+
+    while(running)
+    {
+        uint64_t now = Now();
+        if(now < next)
+        {
+            WebCpp::SleepMs(static_cast<uint32_t>(next - now));
+            continue;
+        }
+
+        // the ticks missed while the thread was late are all processed now
+        while(next <= now)
+        {
+            for(size_t i = 0;i < m_shards.size();i ++)
+            {
+                Shard &shard = *m_shards[i];
+                {
+                    Lock lock(shard.mutex);
+                    Tick(shard, expired);
+                }
+
+                // the callbacks are called without the lock, they can set and cancel timers.
+                // A timer restarted after it was collected has another generation and stays
+                for(auto &entry: expired)
+                {
+                    int connID = -1;
+                    Type type = Type::KeepAlive;
+                    {
+                        Lock lock(shard.mutex);
+                        auto it = shard.timers.find(entry.key);
+                        if(it == shard.timers.end() || it->second->generation != entry.generation || it->second->slot != m_slotCount)
+                        {
+                            continue;
+                        }
+                        connID = it->second->connID;
+                        type = it->second->type;
+                        shard.timers.erase(it);
+                        shard.firing = connID;
+                    }
+                    if(m_callback != nullptr)
+                    {
+                        m_callback(connID, type);
+                    }
+                    Lock lock(shard.mutex);
+                    shard.firing = -1;
+                    shard.fired.FireAll();
+                }
+                expired.clear();
+            }
+            next += m_tick;
+        }
+    }
+
+    return nullptr;
+}
+
+void TimerWheel::Tick(Shard &shard, std::vector<Expired> &expired)
+{
+    shard.cursor = (shard.cursor + 1) % m_slotCount;
+
+    Timer *timer = shard.slots[shard.cursor];
+    while(timer != nullptr)
+    {
+        Timer *next = timer->next;
+        if(timer->rounds == 0)
+        {
+            Unlink(shard, timer);
+            timer->slot = m_slotCount; // not linked, expired
+            expired.push_back(Expired{Key(timer->connID, timer->type), timer->generation});
+        }
+        else
+        {
+            timer->rounds --;
+        }
+        timer = next;
+    }
+}
+
+TimerWheel::Shard &TimerWheel::GetShard(int connID) const
+{
+    return *m_shards[static_cast<size_t>(connID) % m_shards.size()];
+}
+
+void TimerWheel::Link(Shard &shard, Timer *timer, uint32_t delay)
+{
+    size_t ticks = (delay + m_tick - 1) / m_tick;
+    if(ticks == 0)
+    {
+        ticks = 1;
+    }
+
+    timer->slot = (shard.cursor + ticks) % m_slotCount;
+    timer->rounds = (ticks - 1) / m_slotCount;
+    timer->generation = ++ shard.generation;
+    timer->prev = nullptr;
+    timer->next = shard.slots[timer->slot];
+    if(timer->next != nullptr)
+    {
+        timer->next->prev = timer;
+    }
+    shard.slots[timer->slot] = timer;
+}
+
+void TimerWheel::Unlink(Shard &shard, Timer *timer)
+{
+    if(timer->slot >= m_slotCount)
+    {
+        return;
+    }
+
+    if(timer->prev != nullptr)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        shard.slots[timer->slot] = timer->next;
+    }
+    if(timer->next != nullptr)
+    {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = nullptr;
+    timer->next = nullptr;
+}
+
+void TimerWheel::Cancel(Shard &shard, int connID, Type type)
+{
+    auto it = shard.timers.find(Key(connID, type));
+    if(it != shard.timers.end())
+    {
+        Unlink(shard, it->second.get());
+        shard.timers.erase(it);
+    }
+}
+
+uint64_t TimerWheel::Key(int connID, Type type)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(connID)) << 8) | static_cast<uint64_t>(type);
+}
+
+uint64_t TimerWheel::Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
@@ -27,7 +27,7 @@ bool File::Open(const std::string &file,  Mode mode)
 
     m_file = file;
     m_mode = mode;
-    m_fd = open(m_file.c_str(), Mode2Flag(mode));
+    m_fd = open(m_file.c_str(), Mode2Flag(mode), 0644);
     if(m_fd == (-1))
     {
         SetLastError(strerror(errno));
@@ -78,7 +78,7 @@ int File::Mode2Flag(Mode mode)
     }
     else if(contains(mode, Mode::Write))
     {
-        return O_WRONLY | O_TRUNC;
+        return O_WRONLY | O_CREAT | O_TRUNC;
     }
 
     return O_RDONLY;
@@ -1,3 +1,4 @@
+#include <time.h>
 #include "Signal.h"
 
 
@@ -5,7 +6,17 @@ using namespace WebCpp;
 
 Signal::Signal()
 {
+    // the timeout doesn't depend on the system time changes
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_signalCondition, &attr);
+    pthread_condattr_destroy(&attr);
+}
 
+Signal::~Signal()
+{
+    pthread_cond_destroy(&m_signalCondition);
 }
 
 void Signal::Fire()
@@ -13,7 +24,27 @@ void Signal::Fire()
     pthread_cond_signal(&m_signalCondition);
 }
 
+void Signal::FireAll()
+{
+    pthread_cond_broadcast(&m_signalCondition);
+}
+
 void Signal::Wait(Mutex &mutex)
 {
     pthread_cond_wait(& m_signalCondition, mutex.GetMutex());
 }
+
+bool Signal::Wait(Mutex &mutex, uint32_t timeout)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += static_cast<long>(timeout % 1000) * 1000000;
+    if(ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec ++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    return (pthread_cond_timedwait(&m_signalCondition, mutex.GetMutex(), &ts) == 0);
+}
@@ -1,11 +1,21 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#include <climits>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include "SocketPool.h"
@@ -13,59 +23,42 @@
 #include "Lock.h"
 
 #define MAIN_SOCKET_INDEX 0
-#define QUEUE_SIZE 10
 
 
 using namespace WebCpp;
 
-SocketPool::SocketPool(size_t count, Service service, Domain domain, Type type, Options options):
-    m_count(count),
+SocketPool::SocketPool(size_t maxCount, Service service, Domain domain, Type type, Options options):
+    m_count(1),
+    m_maxCount(1),
     m_service(service),
     m_domain(domain),
     m_type(type),
     m_options(options)
 {
-    m_fds = new struct pollfd[count] { };
-    for(auto i = 0;i < count;i ++)
-    {
-        m_fds[i].fd = (-1);
-    }
-#ifdef WITH_OPENSSL
-    if(IsContains(m_options, Options::Ssl))
-    {
-        m_sslClient = new SSL*[count];
-    }
-#endif
+    SetMaxCount(maxCount);
+    // the first chunk always exists since the slot #0 is reserved for the main socket
+    m_slots.push_back(std::unique_ptr<Slot[]>(new Slot[SLOT_CHUNK_SIZE]));
 }
 
 SocketPool::~SocketPool()
 {
-    if(m_fds != nullptr)
-    {
-        delete []m_fds;
-        m_fds = nullptr;
-    }
-#ifdef WITH_OPENSSL
-    if(IsContains(m_options, Options::Ssl))
+    if(m_epoll != (-1))
     {
-        {
-            if(m_sslClient != nullptr)
-                delete []m_sslClient;
-            m_sslClient = nullptr;
-        }
+        close(m_epoll);
+        m_epoll = (-1);
     }
-#endif
 }
 
 int SocketPool::Create(bool main)
 {
     ClearError();
     int sock = (-1);
+    int index = ERROR;
 
     try
     {
-        size_t index = main ? MAIN_SOCKET_INDEX : FindEmpty();
-        if(index == (-1))
+        index = main ? MAIN_SOCKET_INDEX : FindEmpty();
+        if(index == ERROR)
         {
             SetLastError("No free room for socket");
             return (-1);
@@ -99,16 +92,35 @@ int SocketPool::Create(bool main)
             }
         }
 
+        if(IsContains(m_options, Options::ReusePort))
+        {
+#ifdef SO_REUSEPORT
+            int opt = 1;
+            if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == ERROR)
+            {
+                throw std::runtime_error(std::string("set socket option error: ") + strerror(errno));
+            }
+#else
+            throw std::runtime_error("SO_REUSEPORT isn't supported");
+#endif
+        }
+
         fcntl(sock, F_SETFL, O_NONBLOCK);
-        m_fds[index].fd = sock;
-        m_fds[index].events = POLLIN;
+        GetSlot(index).fd = sock;
+        GetSlot(index).events = m_pollEvents;
+        GetSlot(index).revents = 0;
+        if(PollAdd(index) == false)
+        {
+            GetSlot(index).fd = (-1);
+            throw std::runtime_error(GetLastError());
+        }
 
 #ifdef WITH_OPENSSL
         if(IsContains(m_options, Options::Ssl))
         {
             auto ssl = SSL_new(m_ctx);
             SSL_set_fd(ssl, sock);
-            m_sslClient[index] = ssl;
+            GetSlot(index).ssl = ssl;
             if(index == 0)
             {
                 if(m_service == Service::Client)
@@ -137,30 +149,41 @@ int SocketPool::Create(bool main)
     {
         close(sock);
     }
+    if(index != ERROR)
+    {
+        ReleaseSlot(index);
+    }
     return (-1);
 }
 
-bool SocketPool::CloseSocket(size_t index)
+bool SocketPool::CloseSocket(size_t index, bool release)
 {
     if(index < m_count)
     {
-        if(m_fds[index].fd != (-1))
+        if(GetSlot(index).fd != (-1))
         {
-            close(m_fds[index].fd);
-            m_fds[index].fd = (-1);
-            m_fds[index].events = 0;
+            // closing the descriptor also removes it from the epoll set
+            close(GetSlot(index).fd);
+            GetSlot(index).fd = (-1);
+            GetSlot(index).events = 0;
+            GetSlot(index).revents = 0;
 #ifdef WITH_OPENSSL
             if(IsContains(m_options, Options::Ssl))
             {
-                SSL *ssl = m_sslClient[index];
+                SSL *ssl = GetSlot(index).ssl;
                 if(ssl != nullptr)
                 {
                     SSL_shutdown(ssl);
                     SSL_free(ssl);
                 }
-                m_sslClient[index] = nullptr;
+                GetSlot(index).ssl = nullptr;
             }
 #endif
+            // the owner may still have state of the slot, it's released after that is cleaned up
+            if(release)
+            {
+                ReleaseSlot(index);
+            }
             return true;
         }
     }
@@ -170,7 +193,7 @@ bool SocketPool::CloseSocket(size_t index)
 
 bool SocketPool::CloseSockets()
 {
-    for(auto i = 0;i < m_count;i ++)
+    for(size_t i = 0;i < m_count;i ++)
     {
         CloseSocket(i);
     }
@@ -182,7 +205,7 @@ bool SocketPool::IsSocketValid(size_t index)
 {
     if(index < m_count)
     {
-        return (m_fds[index].fd != (-1));
+        return (GetSlot(index).fd != (-1));
     }
 
     return false;
@@ -194,7 +217,7 @@ bool SocketPool::Bind(const std::string &host, int port)
 
     try
     {
-        if(m_fds[MAIN_SOCKET_INDEX].fd == (-1))
+        if(GetSlot(MAIN_SOCKET_INDEX).fd == (-1))
         {
             SetLastError("create main socket first");
             return false;
@@ -222,7 +245,7 @@ bool SocketPool::Bind(const std::string &host, int port)
             server_sockaddr.sin_addr.s_addr = inet_addr(m_host.c_str());
         }
 
-        if(bind(m_fds[MAIN_SOCKET_INDEX].fd, (struct sockaddr* ) &server_sockaddr, sizeof(server_sockaddr)) == ERROR)
+        if(bind(GetSlot(MAIN_SOCKET_INDEX).fd, (struct sockaddr* ) &server_sockaddr, sizeof(server_sockaddr)) == ERROR)
         {
             throw std::runtime_error(std::string("socket bind error: ") + strerror(errno));
         }
@@ -247,13 +270,13 @@ bool SocketPool::Listen()
 
     try
     {
-        if(m_fds[MAIN_SOCKET_INDEX].fd == (-1))
+        if(GetSlot(MAIN_SOCKET_INDEX).fd == (-1))
         {
             SetLastError("create main socket first");
             return false;
         }
 
-        if(listen(m_fds[MAIN_SOCKET_INDEX].fd, QUEUE_SIZE) == ERROR)
+        if(listen(GetSlot(MAIN_SOCKET_INDEX).fd, SOMAXCONN) == ERROR)
         {
             throw std::runtime_error(std::string("socket listen error: ") + strerror(errno));
         }
@@ -278,20 +301,32 @@ size_t SocketPool::Accept()
 
     try
     {
-        if(m_fds[MAIN_SOCKET_INDEX].fd == (-1))
+        if(GetSlot(MAIN_SOCKET_INDEX).fd == (-1))
         {
             throw std::runtime_error("create main socket first");
         }
 
-        int new_socket = accept(m_fds[MAIN_SOCKET_INDEX].fd, NULL, NULL);
+        int new_socket = accept(GetSlot(MAIN_SOCKET_INDEX).fd, NULL, NULL);
         if(new_socket != ERROR)
         {
             int index = FindEmpty();
             if(index != ERROR)
             {
                 fcntl(new_socket, F_SETFL, O_NONBLOCK);
-                m_fds[index].fd = new_socket;
-                m_fds[index].events = POLLIN;
+                if(IsContains(m_options, Options::NoDelay))
+                {
+                    // a small response is written in pieces, don't hold them until the client's delayed ACK
+                    int opt = 1;
+                    setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+                }
+                GetSlot(index).fd = new_socket;
+                GetSlot(index).events = m_pollEvents;
+                GetSlot(index).revents = 0;
+                if(PollAdd(index) == false)
+                {
+                    CloseSocket(index);
+                    throw std::runtime_error(GetLastError());
+                }
 #ifdef WITH_OPENSSL
                 if(IsContains(m_options, Options::Ssl))
                 {
@@ -306,9 +341,16 @@ size_t SocketPool::Accept()
             }
             else
             {
+                close(new_socket);
                 throw std::runtime_error("no room for new connction");
             }
         }
+        else if(errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // the accept queue is drained, that's expected in the edge-triggered mode
+            SetLastError("no pending connections", errno);
+            return ERROR;
+        }
         else
         {
             throw std::runtime_error(std::string("socket accept error: ") + strerror(errno));
@@ -330,7 +372,7 @@ bool SocketPool::Connect(const std::string &host, int port)
 {
     ClearError();
 
-    if(m_fds[MAIN_SOCKET_INDEX].fd == (-1))
+    if(GetSlot(MAIN_SOCKET_INDEX).fd == (-1))
     {
         SetLastError("create main socket first");
         return false;
@@ -374,14 +416,16 @@ bool SocketPool::ConnectTcp(const std::string &host, int port)
         int ret = (-1);
         do
         {
-            ret = connect(m_fds[MAIN_SOCKET_INDEX].fd, (struct sockaddr *)&dest_addr, sizeof(struct sockaddr));
+            ret = connect(GetSlot(MAIN_SOCKET_INDEX).fd, (struct sockaddr *)&dest_addr, sizeof(struct sockaddr));
 
             if(ret == -1)
             {
                 if(errno == EINPROGRESS)
                 {
-                    m_fds[MAIN_SOCKET_INDEX].events = POLLOUT | POLLERR;
-                    int pollret = poll(&m_fds[MAIN_SOCKET_INDEX], 1, m_connectTimeout);
+                    struct pollfd fds = {};
+                    fds.fd = GetSlot(MAIN_SOCKET_INDEX).fd;
+                    fds.events = POLLOUT | POLLERR;
+                    int pollret = poll(&fds, 1, m_connectTimeout);
                     if(pollret == 0)
                     {
                         SetLastError(std::string("Socket connecting timeout"));
@@ -394,7 +438,7 @@ bool SocketPool::ConnectTcp(const std::string &host, int port)
                     }
                     else
                     {
-                        if((m_fds[MAIN_SOCKET_INDEX].revents & POLLOUT) == 0)
+                        if((fds.revents & POLLOUT) == 0)
                         {
                             SetLastError(std::string("Socket not available: ") + strerror(errno), errno);
                             throw std::runtime_error(GetLastError());
@@ -412,7 +456,7 @@ bool SocketPool::ConnectTcp(const std::string &host, int port)
 #ifdef WITH_OPENSSL
         if(IsContains(m_options, Options::Ssl))
         {
-            SSL *ssl = m_sslClient[MAIN_SOCKET_INDEX];
+            SSL *ssl = GetSlot(MAIN_SOCKET_INDEX).ssl;
             int status = (-1);
             do
             {
@@ -461,7 +505,7 @@ bool SocketPool::ConnectUnix(const std::string &host)
         //*addr.sun_path = '\0';
 
         len = static_cast<socklen_t>(__builtin_offsetof(struct sockaddr_un, sun_path) + m_host.length());
-        if(connect(m_fds[MAIN_SOCKET_INDEX].fd, reinterpret_cast<struct sockaddr *>(&addr), len) == (-1))
+        if(connect(GetSlot(MAIN_SOCKET_INDEX).fd, reinterpret_cast<struct sockaddr *>(&addr), len) == (-1))
         {
             SetLastError(std::string("Socket connecting error: ") + strerror(errno), errno);
             throw std::runtime_error(GetLastError());
@@ -489,7 +533,7 @@ size_t SocketPool::Write(const uint8_t *buffer, size_t size, size_t index)
     size_t total = 0;
     try
     {
-        int fd = m_fds[index].fd;
+        int fd = (index < m_count) ? GetSlot(index).fd : ERROR;
         if(fd == ERROR)
         {
             SetLastError("wrong socket");
@@ -501,17 +545,17 @@ size_t SocketPool::Write(const uint8_t *buffer, size_t size, size_t index)
         if(IsContains(m_options, Options::Ssl))
         {
 #ifdef WITH_OPENSSL
-            SSL *ssl = m_sslClient[index];
+            SSL *ssl = GetSlot(index).ssl;
             total = 0;
             do
             {
-                size_t sent = SSL_write(ssl, buffer + total, size - total);
+                int sent = SSL_write(ssl, buffer + total, size - total);
                 if(sent <= 0)
                 {
                     int errorCode = SSL_get_error(ssl, sent);
                     if(errorCode == SSL_ERROR_WANT_WRITE)
                     {
-                        again = true;
+                        again = WaitForWrite(fd);
                     }
                     else
                     {
@@ -522,14 +566,7 @@ size_t SocketPool::Write(const uint8_t *buffer, size_t size, size_t index)
                 else
                 {
                     total += sent;
-                    if(total >= size)
-                    {
-                        again = false;
-                    }
-                    else
-                    {
-                        again = false;
-                    }
+                    again = (total < size);
                 }
             }
             while(again);
@@ -540,10 +577,14 @@ size_t SocketPool::Write(const uint8_t *buffer, size_t size, size_t index)
             total = 0;
             do
             {
-                size_t sent = send(fd, buffer + total, size - total, MSG_NOSIGNAL);
+                ssize_t sent = send(fd, buffer + total, size - total, MSG_NOSIGNAL);
                 if(sent == ERROR)
                 {
-                    if(errno == EAGAIN)
+                    if(errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        again = WaitForWrite(fd);
+                    }
+                    else if(errno == EINTR)
                     {
                         again = true;
                     }
@@ -580,6 +621,179 @@ size_t SocketPool::Write(const uint8_t *buffer, size_t size, size_t index)
     return total;
 }
 
+size_t SocketPool::WriteNoWait(const uint8_t *buffer, size_t size, size_t index)
+{
+    // writes as much as the socket takes, returns 0 if it takes nothing now and ERROR on failure
+    ClearError();
+
+    try
+    {
+        int fd = (index < m_count) ? GetSlot(index).fd : ERROR;
+        if(fd == ERROR)
+        {
+            throw std::runtime_error("wrong socket");
+        }
+
+        if(IsContains(m_options, Options::Ssl))
+        {
+#ifdef WITH_OPENSSL
+            SSL *ssl = GetSlot(index).ssl;
+            int sent = SSL_write(ssl, buffer, size);
+            if(sent <= 0)
+            {
+                int errorCode = SSL_get_error(ssl, sent);
+                if(errorCode == SSL_ERROR_WANT_WRITE)
+                {
+                    return 0;
+                }
+                SetLastError(ERR_error_string(errorCode, nullptr));
+                throw std::runtime_error(std::string("SSL write error: ") + GetLastError());
+            }
+            return static_cast<size_t>(sent);
+#endif
+        }
+
+        while(true)
+        {
+            ssize_t sent = send(fd, buffer, size, MSG_NOSIGNAL);
+            if(sent >= 0)
+            {
+                return static_cast<size_t>(sent);
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+            if(errno != EINTR)
+            {
+                throw std::runtime_error(std::string("socket write error: ") + strerror(errno));
+            }
+        }
+    }
+    catch(const std::runtime_error &err)
+    {
+        SetLastError(err.what());
+    }
+
+    return ERROR;
+}
+
+size_t SocketPool::WriteNoWait(const struct iovec *buffers, size_t count, size_t index)
+{
+    // gathers the buffers in one call, returns the bytes the socket took, 0 if nothing and ERROR on failure
+    ClearError();
+
+    try
+    {
+        int fd = (index < m_count) ? GetSlot(index).fd : ERROR;
+        if(fd == ERROR)
+        {
+            throw std::runtime_error("wrong socket");
+        }
+
+        if(IsContains(m_options, Options::Ssl))
+        {
+            // SSL has no gathering write, the records are written one by one
+            size_t total = 0;
+            for(size_t i = 0;i < count;i ++)
+            {
+                if(buffers[i].iov_len == 0)
+                {
+                    continue;
+                }
+                size_t sent = WriteNoWait(static_cast<const uint8_t *>(buffers[i].iov_base), buffers[i].iov_len, index);
+                if(sent == static_cast<size_t>(ERROR))
+                {
+                    return (total > 0) ? total : ERROR;
+                }
+                total += sent;
+                if(sent < buffers[i].iov_len)
+                {
+                    break;
+                }
+            }
+            return total;
+        }
+
+        struct msghdr message = {};
+        message.msg_iov = const_cast<struct iovec *>(buffers);
+        message.msg_iovlen = std::min(count, static_cast<size_t>(IOV_MAX));
+        while(true)
+        {
+            ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+            if(sent >= 0)
+            {
+                return static_cast<size_t>(sent);
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+            if(errno != EINTR)
+            {
+                throw std::runtime_error(std::string("socket write error: ") + strerror(errno));
+            }
+        }
+    }
+    catch(const std::runtime_error &err)
+    {
+        SetLastError(err.what());
+    }
+
+    return ERROR;
+}
+
+size_t SocketPool::SendFile(int file, off_t &offset, size_t size, size_t index)
+{
+    // the file goes from the page cache to the socket without copying to the user space,
+    // returns 0 if the socket takes nothing now and ERROR on failure
+    ClearError();
+
+    try
+    {
+        int fd = (index < m_count) ? GetSlot(index).fd : ERROR;
+        if(fd == ERROR)
+        {
+            throw std::runtime_error("wrong socket");
+        }
+        if(IsContains(m_options, Options::Ssl))
+        {
+            throw std::runtime_error("sendfile isn't supported for SSL sockets");
+        }
+
+#ifdef __linux__
+        while(true)
+        {
+            ssize_t sent = sendfile(fd, file, &offset, size);
+            if(sent > 0)
+            {
+                return static_cast<size_t>(sent);
+            }
+            if(sent == 0)
+            {
+                throw std::runtime_error("unexpected end of file");
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+            if(errno != EINTR)
+            {
+                throw std::runtime_error(std::string("sendfile error: ") + strerror(errno));
+            }
+        }
+#else
+        throw std::runtime_error("sendfile isn't supported");
+#endif
+    }
+    catch(const std::runtime_error &err)
+    {
+        SetLastError(err.what());
+    }
+
+    return ERROR;
+}
+
 size_t SocketPool::Read(void *buffer, size_t size, size_t index)
 {
     ClearError();
@@ -587,7 +801,7 @@ size_t SocketPool::Read(void *buffer, size_t size, size_t index)
 
     try
     {
-        int fd = m_fds[index].fd;
+        int fd = (index < m_count) ? GetSlot(index).fd : (-1);
         if(fd == (-1))
         {
             SetLastError("wrong socket");
@@ -597,7 +811,7 @@ size_t SocketPool::Read(void *buffer, size_t size, size_t index)
         if(IsContains(m_options, Options::Ssl))
         {
 #ifdef WITH_OPENSSL
-            SSL *ssl = m_sslClient[index];
+            SSL *ssl = GetSlot(index).ssl;
             if(ssl == nullptr)
             {
                 SetLastError(ERR_error_string(ERR_get_error(), nullptr));
@@ -625,13 +839,18 @@ size_t SocketPool::Read(void *buffer, size_t size, size_t index)
             bool again = false;
             do
             {
+                again = false;
                 read = recv(fd, buffer, size, 0);
                 if (read < 0)
                 {
-                    if (errno == EWOULDBLOCK)
+                    if(errno == EINTR)
                     {
                         again = true;
                     }
+                    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        read = 0; // no more data for now
+                    }
                     else
                     {
                         throw std::runtime_error(std::string("socket read error: ") + strerror(errno));
@@ -657,37 +876,155 @@ size_t SocketPool::Read(void *buffer, size_t size, size_t index)
     return read;
 }
 
+void SocketPool::SetPollMode(PollMode mode)
+{
+#ifdef __linux__
+    m_pollMode = mode;
+#else
+    m_pollMode = PollMode::Poll;
+#endif
+}
+
+SocketPool::PollMode SocketPool::GetPollMode() const
+{
+    return m_pollMode;
+}
+
+bool SocketPool::IsEdgeTriggered() const
+{
+    return (m_pollMode == PollMode::EpollEdge);
+}
+
 void SocketPool::SetPollRead()
 {
+    m_pollEvents = POLLIN;
     for(size_t i = 0;i < m_count;i ++)
     {
-        m_fds[i].events = POLLIN;
+        PollModify(i, m_pollEvents);
     }
 }
 
 void SocketPool::SetPollWrite()
 {
+    m_pollEvents = POLLOUT;
     for(size_t i = 0;i < m_count;i ++)
     {
-        m_fds[i].events = POLLOUT;
+        PollModify(i, m_pollEvents);
     }
 }
 
 bool SocketPool::Poll()
 {
-    auto retval = poll(m_fds, m_count, POLL_TIMEOUT);
-    return (retval > 0);
+    for(auto index: m_ready)
+    {
+        GetSlot(index).revents = 0;
+    }
+    m_ready.clear();
+
+#ifdef __linux__
+    if(m_pollMode != PollMode::Poll)
+    {
+        if(m_epoll == (-1))
+        {
+            return false;
+        }
+
+        struct epoll_event events[MAX_POLL_EVENTS];
+        int count = epoll_wait(m_epoll, events, MAX_POLL_EVENTS, POLL_TIMEOUT);
+        for(int i = 0;i < count;i ++)
+        {
+            size_t index = static_cast<size_t>(events[i].data.u64);
+            if(index < m_count && GetSlot(index).fd != (-1))
+            {
+                // EPOLLIN/EPOLLOUT/EPOLLERR/EPOLLHUP have the same values as their poll() counterparts
+                GetSlot(index).revents = static_cast<short>(events[i].events);
+                m_ready.push_back(index);
+            }
+        }
+
+        return (m_ready.size() > 0);
+    }
+#endif
+
+    size_t count = m_count;
+    m_pollfds.resize(count);
+    for(size_t i = 0;i < count;i ++)
+    {
+        const Slot &slot = GetSlot(i);
+        m_pollfds[i].fd = slot.fd;
+        m_pollfds[i].events = slot.events;
+        m_pollfds[i].revents = 0;
+    }
+
+    auto retval = poll(m_pollfds.data(), count, POLL_TIMEOUT);
+    if(retval > 0)
+    {
+        for(size_t i = 0;i < count;i ++)
+        {
+            Slot &slot = GetSlot(i);
+            if(m_pollfds[i].revents != 0 && slot.fd == m_pollfds[i].fd && slot.fd != (-1))
+            {
+                slot.revents = m_pollfds[i].revents;
+                m_ready.push_back(i);
+            }
+        }
+    }
+
+    return (m_ready.size() > 0);
+}
+
+size_t SocketPool::GetReadyCount() const
+{
+    return m_ready.size();
+}
+
+size_t SocketPool::GetReadyIndex(size_t position) const
+{
+    return m_ready[position];
 }
 
 bool SocketPool::HasData(size_t index) const
 {
-    return (m_fds[index].revents == POLLIN);
+    return ((GetSlot(index).revents & POLLIN) == POLLIN);
+}
+
+bool SocketPool::CanWrite(size_t index) const
+{
+    return ((GetSlot(index).revents & POLLOUT) == POLLOUT);
+}
+
+bool SocketPool::SetPollEvents(size_t index, bool read, bool write)
+{
+    // a socket is polled for writing only while there is something queued for it
+    // and isn't polled for reading while the client doesn't take the responses
+    if(index >= m_count)
+    {
+        return false;
+    }
+
+    short events = 0;
+    if(read)
+    {
+        events |= m_pollEvents;
+    }
+    if(write)
+    {
+        events |= POLLOUT;
+    }
+
+    return PollModify(index, events);
 }
 
 bool SocketPool::IsPollError(size_t index) const
 {
-    auto ev = m_fds[index].revents;
-    return ev == POLLERR || ev == POLLHUP || ev == POLLNVAL;
+    auto ev = GetSlot(index).revents;
+    if((ev & (POLLERR | POLLNVAL)) != 0)
+    {
+        return true;
+    }
+
+    // the peer closed the connection and there is nothing left to read
+    return ((ev & POLLHUP) != 0 && (ev & POLLIN) == 0);
 }
 
 void SocketPool::SetPort(int port)
@@ -715,6 +1052,43 @@ size_t SocketPool::GetCount() const
     return m_count;
 }
 
+void SocketPool::SetMaxCount(size_t maxCount)
+{
+    // each slot holds a descriptor so it makes no sense to have more slots than the process can open
+    struct rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+    {
+        if(maxCount > limit.rlim_cur)
+        {
+            maxCount = limit.rlim_cur;
+        }
+    }
+
+    if(maxCount < 1)
+    {
+        maxCount = 1;
+    }
+
+    Lock lock(m_slotMutex);
+    if(maxCount < m_count)
+    {
+        maxCount = m_count;
+    }
+    m_maxCount = maxCount;
+    // the chunk table never reallocates after that so GetSlot() is safe without locking
+    m_slots.reserve((m_maxCount + SLOT_CHUNK_SIZE - 1) / SLOT_CHUNK_SIZE);
+}
+
+size_t SocketPool::GetMaxCount() const
+{
+    return m_maxCount;
+}
+
+size_t SocketPool::GetActiveCount() const
+{
+    return m_activeCount;
+}
+
 int SocketPool::GetConnectTimeout() const
 {
     return m_connectTimeout;
@@ -727,7 +1101,7 @@ void SocketPool::SetConnectTimeout(int timeout)
 
 std::string SocketPool::GetRemoteAddress(size_t index) const
 {
-    int fd = m_fds[index].fd;
+    int fd = (index < m_count) ? GetSlot(index).fd : (-1);
     if(fd == (-1))
     {
         return "";
@@ -749,7 +1123,8 @@ std::string SocketPool::ToString() const
     return std::string("SocketPool: " +
                        Service2String(m_service) + ", " +
                        Domain2String(m_domain) + ", "  +
-                       Type2String(m_type) +
+                       Type2String(m_type) + ", " +
+                       PollMode2String(m_pollMode) +
                        std::string(((m_options & Options::Ssl) == Options::Ssl) ? ", Ssl" : ""));
 }
 
@@ -786,6 +1161,9 @@ bool SocketPool::InitSSL()
         }
         if(m_service == Service::Server)
         {
+            // the writes are not blocking, a record can be partially sent and continued from a queued buffer
+            SSL_CTX_set_mode(m_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
             if (SSL_CTX_use_certificate_file(m_ctx, m_cert.c_str(), SSL_FILETYPE_PEM) <= 0)
             {
                 SetLastError(ERR_error_string(ERR_get_error(), nullptr));
@@ -850,7 +1228,7 @@ bool SocketPool::AcceptSsl(int fd, int index)
             {
                 isError = false;
                 isContinue = false;
-                m_sslClient[index] = ssl;
+                GetSlot(index).ssl = ssl;
             }
         }
     }
@@ -867,17 +1245,140 @@ bool SocketPool::AcceptSsl(int fd, int index)
 }
 #endif
 
-int SocketPool::FindEmpty()
+bool SocketPool::PollAdd(size_t index)
 {
-    for(int i = 1;i < m_count;i ++)
+#ifdef __linux__
+    if(m_pollMode != PollMode::Poll)
     {
-        if(m_fds[i].fd == (-1))
+        if(m_epoll == (-1))
+        {
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            if(m_epoll == (-1))
+            {
+                SetLastError(std::string("epoll create error: ") + strerror(errno), errno);
+                return false;
+            }
+        }
+
+        struct epoll_event event = {};
+        event.events = PollEvents(GetSlot(index).events);
+        event.data.u64 = index;
+        if(epoll_ctl(m_epoll, EPOLL_CTL_ADD, GetSlot(index).fd, &event) == ERROR)
         {
-            return i;
+            SetLastError(std::string("epoll add error: ") + strerror(errno), errno);
+            return false;
         }
     }
+#endif
+    return true;
+}
 
-    return ERROR;
+bool SocketPool::PollModify(size_t index, short events)
+{
+    if(GetSlot(index).fd == (-1))
+    {
+        return false;
+    }
+
+    GetSlot(index).events = events;
+#ifdef __linux__
+    if(m_pollMode != PollMode::Poll && m_epoll != (-1))
+    {
+        struct epoll_event event = {};
+        event.events = PollEvents(events);
+        event.data.u64 = index;
+        if(epoll_ctl(m_epoll, EPOLL_CTL_MOD, GetSlot(index).fd, &event) == ERROR)
+        {
+            SetLastError(std::string("epoll modify error: ") + strerror(errno), errno);
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+uint32_t SocketPool::PollEvents(short events) const
+{
+    uint32_t retval = 0;
+#ifdef __linux__
+    if((events & POLLIN) != 0)
+    {
+        retval |= EPOLLIN | EPOLLRDHUP;
+    }
+    if((events & POLLOUT) != 0)
+    {
+        retval |= EPOLLOUT;
+    }
+    if(m_pollMode == PollMode::EpollEdge)
+    {
+        retval |= EPOLLET;
+    }
+#endif
+    return retval;
+}
+
+bool SocketPool::WaitForWrite(int fd)
+{
+    // the socket is full, sleep until it takes data again instead of retrying
+    struct pollfd pfd = {};
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    while(true)
+    {
+        int retval = poll(&pfd, 1, POLL_TIMEOUT);
+        if(retval > 0)
+        {
+            if((pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+            {
+                throw std::runtime_error("socket write error: the connection is closed");
+            }
+            return true;
+        }
+        if(retval == ERROR && errno != EINTR)
+        {
+            throw std::runtime_error(std::string("socket poll error: ") + strerror(errno));
+        }
+    }
+}
+
+int SocketPool::FindEmpty()
+{
+    Lock lock(m_slotMutex);
+
+    if(!m_freeSlots.empty())
+    {
+        size_t index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_activeCount ++;
+        return static_cast<int>(index);
+    }
+
+    size_t index = m_count;
+    if(index >= m_maxCount)
+    {
+        return ERROR;
+    }
+
+    if(index / SLOT_CHUNK_SIZE >= m_slots.size())
+    {
+        m_slots.push_back(std::unique_ptr<Slot[]>(new Slot[SLOT_CHUNK_SIZE]));
+    }
+    m_count = index + 1;
+    m_activeCount ++;
+
+    return static_cast<int>(index);
+}
+
+void SocketPool::ReleaseSlot(size_t index)
+{
+    if(index == MAIN_SOCKET_INDEX)
+    {
+        return;
+    }
+
+    Lock lock(m_slotMutex);
+    m_freeSlots.push_back(index);
+    m_activeCount --;
 }
 
 void SocketPool::ParseAddress(const std::string &address)
@@ -960,6 +1461,23 @@ std::string SocketPool::Type2String(Type type)
     return "Undefined";
 }
 
+std::string SocketPool::PollMode2String(PollMode mode)
+{
+    switch(mode)
+    {
+        case PollMode::Poll:
+            return "Poll";
+        case PollMode::Epoll:
+            return "Epoll";
+        case PollMode::EpollEdge:
+            return "EpollEdge";
+        default:
+            break;
+    }
+
+    return "Undefined";
+}
+
 std::string SocketPool::Service2String(Service service)
 {
     switch(service)
@@ -25,26 +25,26 @@ bool ThreadWorker::Start()
     }
 
     ClearError();
+    Join(); // the previous run has finished but wasn't joined
     m_isRunning = true;
 
     if(pthread_create(&m_thread, nullptr, ThreadWorker::StartThread, this) != 0)
     {
+        m_isRunning = false;
         SetLastError("failed to starting a thread");
         return false;
     }
 
+    m_joinable = true;
     return true;
 }
 
 void ThreadWorker::Stop(bool wait)
 {
-    if(m_isRunning)
+    m_isRunning = false;
+    if(wait)
     {
-        m_isRunning = false;
-        if(wait)
-        {
-            pthread_join(m_thread, nullptr);
-        }
+        Join();
     }
 }
 
@@ -55,10 +55,7 @@ void ThreadWorker::StopNoWait()
 
 void ThreadWorker::Wait() const
 {
-    if(m_isRunning)
-    {
-        pthread_join(m_thread, nullptr);
-    }
+    Join();
 }
 
 void *ThreadWorker::StartThread(void *cls)
@@ -77,6 +74,21 @@ void *ThreadWorker::StartThread(void *cls)
     return res;
 }
 
+bool ThreadWorker::IsCurrent() const
+{
+    return m_joinable && pthread_equal(m_thread, pthread_self());
+}
+
+void ThreadWorker::Join() const
+{
+    // the thread could already finish by itself, it still has to be joined
+    if(m_joinable && !pthread_equal(m_thread, pthread_self()))
+    {
+        pthread_join(m_thread, nullptr);
+        m_joinable = false;
+    }
+}
+
 void ThreadWorker::SetStop()
 {
     m_isRunning = false;